@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ConfigStore.h>
+#include <timezone.h>
+
+// Runtime settings, kept in NVS and editable on /config.
+// X(id, NVS key, default, lower, upper)
+//
+//   timezone               index into TZ, the zone selected in timezone.h by default
+//   sampling, upload       [s] BME280 sampling and ThingSpeak upload periods
+//   block_off, block_on    [s] motion upload window after the sensor upload
+//   touch_press, _release  [%] below the touch pad baseline
+//   pir_debounce           [ms] shorter presences are not counted
+//   display_*              perceptual level 0-255
+//   night_start, _end      [h] local time
+//   idle_timeout           [min] without motion or touch, 0 = never dim
+//   blank_timeout          [min] without motion or touch, 0 = never off
+//   prewarm                [min] the display wakes before a usually busy hour
+//   motion_defer           [min] at most, motion reports wait for an idle hour
+//   gossip                 [s] between frames to the other clocks, 0 = off
+//   altitude               [m] of the clock, for the sea-level pressure
+
+#define TZ_LAST (int32_t)(sizeof(TZ) / sizeof(TZ[0]) - 1)
+
+#define CONFIG_KEYS(X)                               \
+    X(kTimezone, "timezone", TZ_DEFAULT, 0, TZ_LAST) \
+    X(kSamplingPeriod, "sampling", 1, 1, 60)         \
+    X(kUploadPeriod, "upload", 60, 30, 3600)         \
+    X(kBlockOff, "block_off", 15, 0, 3600)           \
+    X(kBlockOn, "block_on", 45, 0, 3600)             \
+    X(kTouchPress, "touch_press", 10, 2, 50)         \
+    X(kTouchRelease, "touch_release", 5, 1, 50)      \
+    X(kPirDebounce, "pir_debounce", 50, 0, 1000)     \
+    X(kDisplayDay, "display_day", 255, 0, 255)       \
+    X(kDisplayNight, "display_night", 96, 0, 255)    \
+    X(kDisplayIdle, "display_idle", 40, 0, 255)      \
+    X(kNightStart, "night_start", 22, 0, 23)         \
+    X(kNightEnd, "night_end", 7, 0, 23)              \
+    X(kIdleTimeout, "idle_timeout", 10, 0, 1440)     \
+    X(kBlankTimeout, "blank_timeout", 0, 0, 1440)    \
+    X(kPrewarm, "prewarm", 10, 0, 60)                \
+    X(kMotionDefer, "motion_defer", 180, 0, 1440)    \
+    X(kGossip, "gossip", 0, 0, 3600)                 \
+    X(kAltitude, "altitude", 0, -500, 5000)
+
+enum ConfigId : uint8_t {
+#define CONFIG_ID(id, name, value, lower, upper) id,
+    CONFIG_KEYS(CONFIG_ID)
+#undef CONFIG_ID
+    kConfigKeys,
+};
+
+static const ConfigKey_t CONFIG_TABLE[kConfigKeys] = {
+#define CONFIG_ENTRY(id, name, value, lower, upper) {name, value, lower, upper},
+    CONFIG_KEYS(CONFIG_ENTRY)
+#undef CONFIG_ENTRY
+};
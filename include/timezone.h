@@ -1,38 +1,55 @@
+#pragma once
+
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include <stdint.h>
+#define PROGMEM  // test/test_sim/ClockSim.cpp reads the defaults of config.h
+#endif
 
-static const char AUX_TIMEZONE[] PROGMEM = R"(
-{
-  "title": "TimeZone",
-  "uri": "/timezone",
-  "menu": true,
-  "element": [
-    {
-      "name": "caption",
-      "type": "ACText",
-      "value": "Sets the time zone to get the current local time.",
-      "style": "font-family:Arial;font-weight:bold;text-align:center;margin-bottom:10px;color:DarkSlateBlue"
-    },
-    {
-      "name": "timezone",
-      "type": "ACSelect",
-      "label": "Select TZ name",
-      "option": [],
-      "selected": 10
-    },
-    {
-      "name": "newline",
-      "type": "ACElement",
-      "value": "<br>"
-    },
-    {
-      "name": "start",
-      "type": "ACSubmit",
-      "value": "OK",
-      "uri": "/start"
-    }
-  ]
-}
-)";
+// The time zones offered on /timezone: name, NTP pool, hours east of UTC
+// and 1 for the one selected on the page. That one is also the kTimezone
+// default, TZ_DEFAULT.
+//
+// The aux page is built from this list by the preprocessor: the options
+// are one string literal in flash, so the page is not parsed from JSON
+// and no String is made per zone at boot.
+
+#define TIMEZONES(X)                                               \
+    X("Europe/London", "europe.pool.ntp.org", 0, 0)                \
+    X("Europe/Berlin", "europe.pool.ntp.org", 1, 0)                \
+    X("Europe/Helsinki", "europe.pool.ntp.org", 2, 0)              \
+    X("Europe/Moscow", "europe.pool.ntp.org", 3, 0)                \
+    X("Asia/Dubai", "asia.pool.ntp.org", 4, 0)                     \
+    X("Asia/Karachi", "asia.pool.ntp.org", 5, 0)                   \
+    X("Asia/Dhaka", "asia.pool.ntp.org", 6, 0)                     \
+    X("Asia/Jakarta", "asia.pool.ntp.org", 7, 0)                   \
+    X("Asia/Manila", "asia.pool.ntp.org", 8, 0)                    \
+    X("Asia/Tokyo", "asia.pool.ntp.org", 9, 1)                     \
+    X("Australia/Brisbane", "oceania.pool.ntp.org", 10, 0)         \
+    X("Pacific/Noumea", "oceania.pool.ntp.org", 11, 0)             \
+    X("Pacific/Auckland", "oceania.pool.ntp.org", 12, 0)           \
+    X("Atlantic/Azores", "europe.pool.ntp.org", -1, 0)             \
+    X("America/Noronha", "south-america.pool.ntp.org", -2, 0)      \
+    X("America/Araguaina", "south-america.pool.ntp.org", -3, 0)    \
+    X("America/Blanc-Sablon", "north-america.pool.ntp.org", -4, 0) \
+    X("America/New_York", "north-america.pool.ntp.org", -5, 0)     \
+    X("America/Chicago", "north-america.pool.ntp.org", -6, 0)      \
+    X("America/Denver", "north-america.pool.ntp.org", -7, 0)       \
+    X("America/Los_Angeles", "north-america.pool.ntp.org", -8, 0)  \
+    X("America/Anchorage", "north-america.pool.ntp.org", -9, 0)    \
+    X("Pacific/Honolulu", "north-america.pool.ntp.org", -10, 0)    \
+    X("Pacific/Samoa", "oceania.pool.ntp.org", -11, 0)
+
+#define TZ_ENTRY(zone, ntpServer, tzoff, selected) {zone, ntpServer, tzoff},
+#define TZ_SELECTED_0 ""
+#define TZ_SELECTED_1 " selected"
+#define TZ_OPTION(zone, ntpServer, tzoff, selected) "<option" TZ_SELECTED_##selected ">" zone "</option>"
+
+// AutoConnectSelect markup, the form posts the zone name as "timezone".
+static const char TZ_SELECT[] PROGMEM =
+    "<label for=\"timezone\">Select TZ name</label>"
+    "<select name=\"timezone\" id=\"timezone\">" TIMEZONES(TZ_OPTION) "</select>";
 
 typedef struct {
     const char* zone;
@@ -40,28 +57,20 @@ typedef struct {
     int8_t tzoff;
 } Timezone_t;
 
-static const Timezone_t TZ[] = {
-    {"Europe/London", "europe.pool.ntp.org", 0},
-    {"Europe/Berlin", "europe.pool.ntp.org", 1},
-    {"Europe/Helsinki", "europe.pool.ntp.org", 2},
-    {"Europe/Moscow", "europe.pool.ntp.org", 3},
-    {"Asia/Dubai", "asia.pool.ntp.org", 4},
-    {"Asia/Karachi", "asia.pool.ntp.org", 5},
-    {"Asia/Dhaka", "asia.pool.ntp.org", 6},
-    {"Asia/Jakarta", "asia.pool.ntp.org", 7},
-    {"Asia/Manila", "asia.pool.ntp.org", 8},
-    {"Asia/Tokyo", "asia.pool.ntp.org", 9},
-    {"Australia/Brisbane", "oceania.pool.ntp.org", 10},
-    {"Pacific/Noumea", "oceania.pool.ntp.org", 11},
-    {"Pacific/Auckland", "oceania.pool.ntp.org", 12},
-    {"Atlantic/Azores", "europe.pool.ntp.org", -1},
-    {"America/Noronha", "south-america.pool.ntp.org", -2},
-    {"America/Araguaina", "south-america.pool.ntp.org", -3},
-    {"America/Blanc-Sablon", "north-america.pool.ntp.org", -4},
-    {"America/New_York", "north-america.pool.ntp.org", -5},
-    {"America/Chicago", "north-america.pool.ntp.org", -6},
-    {"America/Denver", "north-america.pool.ntp.org", -7},
-    {"America/Los_Angeles", "north-america.pool.ntp.org", -8},
-    {"America/Anchorage", "north-america.pool.ntp.org", -9},
-    {"Pacific/Honolulu", "north-america.pool.ntp.org", -10},
-    {"Pacific/Samoa", "oceania.pool.ntp.org", -11}};
+static const Timezone_t TZ[] = {TIMEZONES(TZ_ENTRY)};
+
+#define TZ_FLAG(zone, ntpServer, tzoff, selected) selected,
+
+constexpr uint8_t TZ_FLAGS[] = {TIMEZONES(TZ_FLAG)};
+
+constexpr int32_t tzSelected(uint8_t n = 0) {
+    return n < sizeof(TZ_FLAGS) ? (TZ_FLAGS[n] ? n : tzSelected(n + 1)) : -1;
+}
+
+constexpr uint8_t tzSelectedCount(uint8_t n = 0) {
+    return n < sizeof(TZ_FLAGS) ? TZ_FLAGS[n] + tzSelectedCount(n + 1) : 0;
+}
+
+static_assert(tzSelectedCount() == 1, "select exactly one zone in TIMEZONES");
+
+#define TZ_DEFAULT tzSelected()
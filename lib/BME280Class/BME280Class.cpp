@@ -25,66 +25,37 @@ SOFTWARE.
 #include <BME280Class.h>
 #include <esp32-hal-log.h>
 
-BME280Class::BME280Class() {
+// Filter presets per scenario {enabled, lower, upper, median, maxRate, alpha}
+// The range is the BME280 operating range, maxRate is per sample at the
+// suggested rate of each scenario.
+static const FilterPreset_t FILTER_PRESET[][SensorFilter::kChannels] = {
+    // WEATHER_STATION, forced mode sampled at 1Hz by the clock
+    {{true, -40.0f, 85.0f, true, 0.5f, 0.2f},
+     {true, 0.0f, 100.0f, true, 2.0f, 0.2f},
+     {true, 300.0f, 1100.0f, true, 0.5f, 0.2f}},
+    // HUMIDITY_SENSING, 1Hz, pressure off
+    {{true, -40.0f, 85.0f, true, 0.5f, 0.2f},
+     {true, 0.0f, 100.0f, true, 2.0f, 0.2f},
+     {false, 300.0f, 1100.0f, false, 0.0f, 1.0f}},
+    // INDOOR_NAVIGATION, 25Hz, IIR x16 on the sensor
+    {{true, -40.0f, 85.0f, true, 0.1f, 1.0f},
+     {true, 0.0f, 100.0f, true, 0.5f, 1.0f},
+     {true, 300.0f, 1100.0f, true, 0.5f, 1.0f}},
+    // GAMING, 83Hz, IIR x16 on the sensor, humidity off
+    {{true, -40.0f, 85.0f, false, 0.0f, 1.0f},
+     {false, 0.0f, 100.0f, false, 0.0f, 1.0f},
+     {true, 300.0f, 1100.0f, false, 0.0f, 1.0f}},
+};
+
+BME280Class::BME280Class(uint8_t address) {
+    _bus       = nullptr;
+    _address   = address;
+    _present   = false;
     _sensor_ID = 0;
-    _bme       = new Adafruit_BME280();
 }
 
 BME280Class::~BME280Class() {}
 
-bool BME280Class::getTemperature(float &value) {
-    if (_bme->takeForcedMeasurement()) {
-        value = _bme->readTemperature();
-        log_d("Temperature = %2.1f*C", value);
-
-        return true;
-    }
-
-    return false;
-}
-
-bool BME280Class::getPressure(float &value) {
-    if (_bme->takeForcedMeasurement()) {
-        float pascals = _bme->readPressure();
-        log_d("Pressure = %4.1f(hPa)", pascals / 100.0f);
-
-        value = pascals / 100.0f;
-
-        return true;
-    }
-
-    return false;
-}
-
-bool BME280Class::getHumidity(float &value) {
-    if (_bme->takeForcedMeasurement()) {
-        value = _bme->readHumidity();
-        log_d("Humidity = %2.1f%%", value);
-
-        return true;
-    }
-
-    return false;
-}
-
-bool BME280Class::getAltitude(float &seaLevel) {
-    if (_bme->takeForcedMeasurement()) {
-        seaLevel = _bme->readAltitude(SENSORS_PRESSURE_SEALEVELHPA);
-        log_d("Altitude = %4.1f m", seaLevel);
-
-        return true;
-    }
-
-    return false;
-}
-
-uint32_t BME280Class::getSensorID(void) {
-    uint32_t id = _bme->sensorID();
-    log_d("Sensor ID = %d", id);
-
-    return id;
-}
-
 // See Also.
 // https://github.com/adafruit/Adafruit_BME280_Library/blob/master/examples/advancedsettings/advancedsettings.ino
 // weather monitoring
@@ -92,8 +63,8 @@ void BME280Class::initBME280WeatherStation(void) {
     log_i("-- Weather Station Scenario --");
     log_i("forced mode, 1x temperature / 1x humidity / 1x pressure oversampling");
     log_i("filter off");
-    // suggested rate is 1/60Hz (1m)
-    _bme->setSampling(Adafruit_BME280::MODE_FORCED,
+    // sampled at 1Hz by SensorBus
+    setSampling(Adafruit_BME280::MODE_FORCED,
                       Adafruit_BME280::SAMPLING_X1,  // temperature
                       Adafruit_BME280::SAMPLING_X1,  // pressure
                       Adafruit_BME280::SAMPLING_X1,  // humidity
@@ -106,7 +77,7 @@ void BME280Class::initBME280HumiditySensing(void) {
     log_i("forced mode, 1x temperature / 1x humidity / 0x pressure oversampling");
     log_i("= pressure off, filter off");
     // suggested rate is 1Hz (1s)
-    _bme->setSampling(Adafruit_BME280::MODE_FORCED,
+    setSampling(Adafruit_BME280::MODE_FORCED,
                       Adafruit_BME280::SAMPLING_X1,    // temperature
                       Adafruit_BME280::SAMPLING_NONE,  // pressure
                       Adafruit_BME280::SAMPLING_X1,    // humidity
@@ -119,7 +90,7 @@ void BME280Class::initBME280IndoorNavigation(void) {
     log_i("normal mode, 16x pressure / 2x temperature / 1x humidity oversampling");
     log_i("0.5ms standby period, filter 16x");
     // suggested rate is 25Hz
-    _bme->setSampling(Adafruit_BME280::MODE_NORMAL,
+    setSampling(Adafruit_BME280::MODE_NORMAL,
                       Adafruit_BME280::SAMPLING_X2,   // temperature
                       Adafruit_BME280::SAMPLING_X16,  // pressure
                       Adafruit_BME280::SAMPLING_X1,   // humidity
@@ -133,7 +104,7 @@ void BME280Class::initBME280Gaming(void) {
     log_i("normal mode, 4x pressure / 1x temperature / 0x humidity oversampling,");
     log_i("= humidity off, 0.5ms standby period, filter 16x");
     // Suggested rate is 83Hz
-    _bme->setSampling(Adafruit_BME280::MODE_NORMAL,
+    setSampling(Adafruit_BME280::MODE_NORMAL,
                       Adafruit_BME280::SAMPLING_X1,    // temperature
                       Adafruit_BME280::SAMPLING_X4,    // pressure
                       Adafruit_BME280::SAMPLING_NONE,  // humidity
@@ -141,36 +112,99 @@ void BME280Class::initBME280Gaming(void) {
                       Adafruit_BME280::STANDBY_MS_0_5);
 }
 
-void BME280Class::setup(int sdaPin, int sclPin, MODE mode) {
-    Wire.setPins(sdaPin, sclPin);
+// The bus (pins, clock) belongs to the caller, see SensorBus.
+bool BME280Class::setup(MODE mode, TwoWire &wire) {
+    _bus     = &wire;
+    _present = begin(_address, &wire);
 
-    if (!_bme->begin(BME280_ADDRESS_ALTERNATE)) {
-        log_e("Could not find a valid BME280 sensor, check wiring, address, sensor ID!");
-        log_e("SensorID was: 0x%x", _bme->sensorID());
+    if (!_present) {
+        log_e("Could not find a valid BME280 sensor at 0x%02x, check wiring, address, sensor ID!", _address);
+        log_e("SensorID was: 0x%x", sensorID());
         log_e("        ID of 0xFF probably means a bad address, a BMP 180 or BMP 085");
         log_e("   ID of 0x56-0x58 represents a BMP 280,");
         log_e("        ID of 0x60 represents a BME 280.");
         log_e("        ID of 0x61 represents a BME 680.");
-    } else {
-        log_d("ESP could find a BME280 sensor!");
-        log_d("SensorID was: 0x%x", _bme->sensorID());
-
-        switch (mode) {
-            case MODE::WEATHER_STATION:
-                initBME280WeatherStation();
-                break;
-            case MODE::HUMIDITY_SENSING:
-                initBME280HumiditySensing();
-                break;
-            case MODE::INDOOR_NAVIGATION:
-                initBME280IndoorNavigation();
-                break;
-            case MODE::GAMING:
-                initBME280Gaming();
-                break;
-            default:;
-        }
+        return false;
+    }
+    log_d("ESP could find a BME280 sensor at 0x%02x!", _address);
+    log_d("SensorID was: 0x%x", sensorID());
+
+    const bme280_calib_data &c = _bme280_calib;
+    _compensation.begin({c.dig_T1, c.dig_T2, c.dig_T3,
+                         c.dig_P1, c.dig_P2, c.dig_P3, c.dig_P4, c.dig_P5, c.dig_P6, c.dig_P7, c.dig_P8, c.dig_P9,
+                         c.dig_H1, c.dig_H2, c.dig_H3, c.dig_H4, c.dig_H5, c.dig_H6});
+
+    _filter.configure(FILTER_PRESET[static_cast<int>(mode)]);
+
+    switch (mode) {
+        case MODE::WEATHER_STATION:
+            initBME280WeatherStation();
+            break;
+        case MODE::HUMIDITY_SENSING:
+            initBME280HumiditySensing();
+            break;
+        case MODE::INDOOR_NAVIGATION:
+            initBME280IndoorNavigation();
+            break;
+        case MODE::GAMING:
+            initBME280Gaming();
+            break;
+        default:;
     }
+
+    return true;
+}
+
+// Writes ctrl_meas to start a forced measurement and returns without waiting
+// for it. In normal mode the sensor converts by itself and this is a no-op.
+bool BME280Class::startConversion(void) {
+    if (_measReg.mode != MODE_FORCED) {
+        return true;
+    }
+
+    _bus->beginTransmission(_address);
+    _bus->write((uint8_t)BME280_REGISTER_CONTROL);
+    _bus->write((uint8_t)_measReg.get());
+
+    return _bus->endTransmission() == 0;
+}
+
+// status.measuring (bit 3), also true when the sensor does not answer.
+bool BME280Class::isConverting(void) {
+    _bus->beginTransmission(_address);
+    _bus->write((uint8_t)BME280_REGISTER_STATUS);
+    if (_bus->endTransmission() != 0 || _bus->requestFrom(_address, (uint8_t)1) != 1) {
+        return true;
+    }
+
+    return (_bus->read() & 0x08) != 0;
+}
+
+// Maximum measurement time of the current oversampling [us], datasheet 9.1.
+uint32_t BME280Class::getConversionTime(void) {
+    static const uint8_t OVERSAMPLING[] = {0, 1, 2, 4, 8, 16, 16, 16};
+    uint32_t t = OVERSAMPLING[_measReg.osrs_t];
+    uint32_t p = OVERSAMPLING[_measReg.osrs_p];
+    uint32_t h = OVERSAMPLING[_humReg.osrs_h];
+
+    return 1250 + 2300 * t + (p ? 2300 * p + 575 : 0) + (h ? 2300 * h + 575 : 0);
+}
+
+// One burst read of press/temp/hum (0xF7..0xFE) instead of a transaction per
+// register, compensated with the calibration read by begin().
+bool BME280Class::readSample(float &temperature, float &humidity, float &pressure) {
+    uint8_t data[BME280_BURST];
+
+    _bus->beginTransmission(_address);
+    _bus->write((uint8_t)BME280_REGISTER_PRESSUREDATA);
+    if (_bus->endTransmission() != 0 || _bus->requestFrom(_address, (uint8_t)sizeof(data)) != sizeof(data)) {
+        return false;
+    }
+    for (uint8_t i = 0; i < sizeof(data); i++) {
+        data[i] = _bus->read();
+    }
+
+    return _compensation.compensate(data, temperature, humidity, pressure);
 }
 
 #if !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_BME280CLASS)
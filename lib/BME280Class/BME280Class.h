@@ -25,8 +25,10 @@ SOFTWARE.
 #pragma once
 
 #include <Adafruit_BME280.h>
+#include <BME280Compensation.h>
 #include <Adafruit_Sensor.h>
 #include <Arduino.h>
+#include <SensorFilter.h>
 #include <Wire.h>
 
 enum class MODE : int {
@@ -36,9 +38,13 @@ enum class MODE : int {
     GAMING,
 };
 
-class BME280Class {
+// One BME280 on an I2C bus, driven by SensorBus: a forced measurement is
+// split into startConversion(), isConverting() and readSample() so several
+// devices convert at once. There is no blocking read, the bus belongs to
+// SensorBus after its start().
+class BME280Class : public Adafruit_BME280 {
    public:
-    BME280Class();
+    BME280Class(uint8_t address = BME280_ADDRESS_ALTERNATE);
     ~BME280Class();
 
     void initBME280WeatherStation(void);
@@ -46,20 +52,24 @@ class BME280Class {
     void initBME280IndoorNavigation(void);
     void initBME280Gaming(void);
 
-    bool getTemperature(float &value);
-    bool getPressure(float &value);
-    bool getHumidity(float &value);
-    bool getAltitude(float &seaLevel);
-    uint32_t getSensorID(void);
-
-    void setup(int sdaPin, int sclPin, MODE mode);
+    bool setup(MODE mode, TwoWire &wire = Wire);
     void handle(void);
 
+    bool startConversion(void);
+    bool isConverting(void);
+    uint32_t getConversionTime(void);
+    bool readSample(float &temperature, float &humidity, float &pressure);
+
+    uint8_t getAddress(void) const { return _address; }
+    bool isPresent(void) const { return _present; }
+    SensorFilter &getFilter(void) { return _filter; }
+
    private:
-    Adafruit_BME280 *_bme;
-    Adafruit_Sensor *_pressur;
-    Adafruit_Sensor *_temperature;
-    Adafruit_Sensor *_humidity;
+    BME280Compensation _compensation;
+    SensorFilter _filter;
+    TwoWire *_bus;
+    uint8_t _address;
+    bool _present;
     uint32_t _sensor_ID;
 };
 
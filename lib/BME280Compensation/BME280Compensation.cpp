@@ -0,0 +1,94 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <BME280Compensation.h>
+#include <math.h>
+#include <string.h>
+
+BME280Compensation::BME280Compensation() {
+    memset(&_calib, 0, sizeof(_calib));
+    _fine = 0;
+}
+
+// A skipped measurement reads 0x80000 (0x8000 humidity). Without the
+// temperature nothing can be compensated.
+bool BME280Compensation::compensate(const uint8_t data[BME280_BURST], float &temperature, float &humidity, float &pressure) {
+    int32_t adcP = ((uint32_t)data[0] << 12) | ((uint32_t)data[1] << 4) | (data[2] >> 4);
+    int32_t adcT = ((uint32_t)data[3] << 12) | ((uint32_t)data[4] << 4) | (data[5] >> 4);
+    int32_t adcH = ((uint32_t)data[6] << 8) | data[7];
+
+    if (adcT == 0x80000) {
+        return false;
+    }
+    temperature = _temperature(adcT);
+    pressure    = adcP == 0x80000 ? NAN : _pressure(adcP) / 100.0f;
+    humidity    = adcH == 0x8000 ? NAN : _humidity(adcH);
+
+    return true;
+}
+
+// Compensation formulas of the datasheet (8.2, 32/64 bit integer versions).
+float BME280Compensation::_temperature(int32_t adc) {
+    int32_t var1 = ((((adc >> 3) - ((int32_t)_calib.dig_T1 << 1))) * ((int32_t)_calib.dig_T2)) >> 11;
+    int32_t var2 = (((((adc >> 4) - ((int32_t)_calib.dig_T1)) * ((adc >> 4) - ((int32_t)_calib.dig_T1))) >> 12) *
+                    ((int32_t)_calib.dig_T3)) >> 14;
+
+    _fine = var1 + var2;
+
+    return ((_fine * 5 + 128) >> 8) / 100.0f;
+}
+
+float BME280Compensation::_pressure(int32_t adc) const {
+    int64_t var1 = ((int64_t)_fine) - 128000;
+    int64_t var2 = var1 * var1 * (int64_t)_calib.dig_P6;
+    var2         = var2 + ((var1 * (int64_t)_calib.dig_P5) << 17);
+    var2         = var2 + (((int64_t)_calib.dig_P4) << 35);
+    var1         = ((var1 * var1 * (int64_t)_calib.dig_P3) >> 8) + ((var1 * (int64_t)_calib.dig_P2) << 12);
+    var1         = (((((int64_t)1) << 47) + var1)) * ((int64_t)_calib.dig_P1) >> 33;
+
+    if (var1 == 0) {
+        return 0;  // avoid a division by zero
+    }
+
+    int64_t p = 1048576 - adc;
+    p         = (((p << 31) - var2) * 3125) / var1;
+    var1      = (((int64_t)_calib.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+    var2      = (((int64_t)_calib.dig_P8) * p) >> 19;
+    p         = ((p + var1 + var2) >> 8) + (((int64_t)_calib.dig_P7) << 4);
+
+    return (float)p / 256.0f;  // [Pa]
+}
+
+float BME280Compensation::_humidity(int32_t adc) const {
+    int32_t v = _fine - 76800;
+
+    v = (((((adc << 14) - (((int32_t)_calib.dig_H4) << 20) - (((int32_t)_calib.dig_H5) * v)) + 16384) >> 15) *
+         (((((((v * ((int32_t)_calib.dig_H6)) >> 10) * (((v * ((int32_t)_calib.dig_H3)) >> 11) + 32768)) >> 10) + 2097152) *
+               ((int32_t)_calib.dig_H2) + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * ((int32_t)_calib.dig_H1)) >> 4);
+    v = v < 0 ? 0 : v;
+    v = v > 419430400 ? 419430400 : v;
+
+    return (v >> 12) / 1024.0f;
+}
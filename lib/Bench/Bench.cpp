@@ -0,0 +1,188 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <Bench.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+volatile bool Bench::_counting   = false;
+volatile uint32_t Bench::_allocs = 0;
+volatile uint32_t Bench::_bytes  = 0;
+
+Bench::Bench(Clock clock, Output output) : _clock(clock), _output(output), _count(0) {}
+
+bool Bench::add(const char *name, Function function, void *context) {
+    if (_count == BENCH_CASES) {
+        return false;
+    }
+
+    _case[_count]   = {function, context};
+    _result[_count] = {name, 0, 0, 0};
+    _count++;
+
+    return true;
+}
+
+// Runs the cases whose name contains the filter.
+void Bench::run(const char *filter) {
+    for (uint8_t i = 0; i < _count; i++) {
+        BenchResult_t &r = _result[i];
+        if (filter && strstr(r.name, filter) == nullptr) {
+            continue;
+        }
+
+        _case[i].function(_case[i].context);  // warm up, first time allocations
+
+        uint32_t ops = 1;
+        while (_batch(_case[i], ops) < BENCH_MIN_TIME && ops < (1UL << 30)) {
+            ops *= 2;
+        }
+
+        uint64_t best = UINT64_MAX;
+        for (uint8_t round = 0; round < BENCH_ROUNDS; round++) {
+            _allocs    = 0;
+            _bytes     = 0;
+            _counting  = true;
+            uint64_t t = _batch(_case[i], ops);
+            _counting  = false;
+            if (t < best) {
+                best = t;
+            }
+        }
+        r.ns     = (double)best / ops;
+        r.allocs = (double)_allocs / ops;
+        r.bytes  = (double)_bytes / ops;
+    }
+}
+
+uint64_t Bench::_batch(const Case_t &c, uint32_t ops) const {
+    uint64_t start = _clock();
+
+    for (uint32_t n = 0; n < ops; n++) {
+        c.function(c.context);
+    }
+
+    return _clock() - start;
+}
+
+// Takes recorded results instead of running, the names stay in the text.
+uint8_t Bench::load(char *text) {
+    BenchResult_t r;
+
+    _count = 0;
+    while (_count < BENCH_CASES && _parse(text, r)) {
+        _case[_count]     = {nullptr, nullptr};
+        _result[_count++] = r;
+    }
+
+    return _count;
+}
+
+void Bench::print(void) const {
+    char line[BENCH_LINE];
+
+    _output("# name                     ns/op  allocs/op   bytes/op");
+    for (uint8_t i = 0; i < _count; i++) {
+        const BenchResult_t &r = _result[i];
+        snprintf(line, sizeof(line), "%-20s %12.1f %10.2f %10.1f", r.name, r.ns, r.allocs, r.bytes);
+        _output(line);
+    }
+}
+
+// Returns the number of regressions. The baseline is cut into names.
+uint8_t Bench::compare(char *baseline, uint8_t tolerance) const {
+    BenchResult_t base[BENCH_CASES];
+    uint8_t bases       = 0;
+    uint8_t regressions = 0;
+    char line[BENCH_LINE];
+
+    while (bases < BENCH_CASES && _parse(baseline, base[bases])) {
+        bases++;
+    }
+
+    _output("# name                     ns/op   baseline  change  allocs/op  baseline");
+    for (uint8_t i = 0; i < _count; i++) {
+        const BenchResult_t &r = _result[i];
+        const BenchResult_t *b = nullptr;
+        for (uint8_t j = 0; j < bases && b == nullptr; j++) {
+            if (strcmp(base[j].name, r.name) == 0) {
+                b = &base[j];
+            }
+        }
+
+        if (b == nullptr) {
+            snprintf(line, sizeof(line), "%-20s %12.1f %10s %7s %10.2f %9s  new", r.name, r.ns, "-", "-", r.allocs, "-");
+            _output(line);
+            continue;
+        }
+
+        double change = b->ns > 0 ? (r.ns - b->ns) * 100.0 / b->ns : 0;
+        bool slower   = change > tolerance && r.ns - b->ns > BENCH_NOISE;
+        bool heavier  = r.allocs > b->allocs + 0.005 || r.bytes > b->bytes + 0.5;
+        regressions += slower || heavier;
+
+        snprintf(line, sizeof(line), "%-20s %12.1f %10.1f %+6.0f%% %10.2f %9.2f  %s", r.name, r.ns, b->ns, change,
+                 r.allocs, b->allocs, slower ? "SLOWER" : heavier ? "MORE HEAP" : "ok");
+        _output(line);
+    }
+
+    return regressions;
+}
+
+// The next result line of a text, false at the end.
+bool Bench::_parse(char *&text, BenchResult_t &result) {
+    while (*text) {
+        char *line = text;
+        char *end  = strchr(text, '\n');
+        text       = end ? end + 1 : text + strlen(text);
+        if (end) {
+            *end = '\0';
+        }
+
+        char *save;
+        char *name = strtok_r(line, " \t\r", &save);
+        if (name == nullptr || name[0] == '#') {
+            continue;
+        }
+        char *ns     = strtok_r(nullptr, " \t\r", &save);
+        char *allocs = strtok_r(nullptr, " \t\r", &save);
+        char *bytes  = strtok_r(nullptr, " \t\r", &save);
+        if (bytes == nullptr) {
+            continue;
+        }
+
+        result = {name, strtod(ns, nullptr), strtod(allocs, nullptr), strtod(bytes, nullptr)};
+        return true;
+    }
+
+    return false;
+}
+
+void Bench::allocated(size_t size) {
+    if (_counting) {
+        _allocs = _allocs + 1;
+        _bytes  = _bytes + size;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Micro benchmarks of the firmware's hot paths, on the host or the device.
+//
+// A case runs in batches, doubled until one takes BENCH_MIN_TIME, and the
+// fastest of BENCH_ROUNDS batches gives the time per op. The heap
+// allocations and bytes per op come from the allocator hooks of the
+// program, which call allocated() for every malloc or operator new.
+//
+// Results are printed one case a line, "<name> <ns/op> <allocs/op>
+// <bytes/op>", which is also the format of a baseline; '#' starts a
+// comment. compare() flags a case slower than its baseline by more than
+// the tolerance and BENCH_NOISE, or with more allocations per op.
+// No Arduino dependency, the caller provides the clock and the output.
+
+#define BENCH_CASES    24
+#define BENCH_ROUNDS   5
+#define BENCH_MIN_TIME 20000000ULL  // [ns] of one batch
+#define BENCH_NOISE    5.0          // [ns/op] smaller changes are not regressions
+#define BENCH_LINE     96           // [bytes] of an output line
+
+typedef struct {
+    const char *name;
+    double ns;      // per op
+    double allocs;  // per op
+    double bytes;   // per op
+} BenchResult_t;
+
+class Bench {
+   public:
+    typedef void (*Function)(void *context);
+    typedef uint64_t (*Clock)(void);           // [ns]
+    typedef void (*Output)(const char *line);  // without the newline
+
+    Bench(Clock clock, Output output);
+
+    bool add(const char *name, Function function, void *context = nullptr);
+    void run(const char *filter = nullptr);
+    uint8_t load(char *text);
+    void print(void) const;
+    uint8_t compare(char *baseline, uint8_t tolerance) const;
+
+    uint8_t count(void) const { return _count; }
+    const BenchResult_t &result(uint8_t index) const { return _result[index]; }
+
+    static void allocated(size_t size);
+
+   private:
+    typedef struct {
+        Function function;
+        void *context;
+    } Case_t;
+
+    uint64_t _batch(const Case_t &c, uint32_t ops) const;
+    static bool _parse(char *&text, BenchResult_t &result);
+
+    Clock _clock;
+    Output _output;
+    Case_t _case[BENCH_CASES];
+    BenchResult_t _result[BENCH_CASES];
+    uint8_t _count;
+
+    static volatile bool _counting;
+    static volatile uint32_t _allocs;
+    static volatile uint32_t _bytes;
+};
@@ -0,0 +1,203 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <BME280Compensation.h>
+#include <BenchCases.h>
+#include <ComfortMetrics.h>
+#include <DeferredLog.h>
+#include <Gossip.h>
+#include <LedMatrix.h>
+#include <Rollup.h>
+#include <SegmentFont.h>
+#include <SensorFilter.h>
+#include <TimeService.h>
+#include <TelemetryCodec.h>
+#include <Trace.h>
+#include <math.h>
+
+#define BENCH_RENDER 20000  // [us] the render clock period
+#define BENCH_EPOCH  1614801600
+
+static volatile uint32_t sink;  // keeps the results alive
+
+static TimeService clockService;
+static int64_t clockMonotonic = 0;
+
+static void clockTick(void *context) {
+    TimeSnapshot_t now;
+
+    clockMonotonic += BENCH_RENDER;
+    clockService.update(BENCH_EPOCH + clockMonotonic / 1000000, clockMonotonic);
+    clockService.read(now);
+    sink = now.clock;
+}
+
+static void envSegments(void *context) {
+    uint8_t segments[SEGMENT_DIGITS];
+
+    SegmentFont::format(2456, 2, 1, UNIT_CELSIUS, segments);
+    SegmentFont::format(4512, 2, 0, UNIT_PERCENT, segments);
+    SegmentFont::format(101325, 2, 0, UNIT_HECTOPASCAL, segments);
+    sink = segments[0];
+}
+
+static void segmentFormat(void *context) {
+    uint8_t segments[SEGMENT_DIGITS];
+
+    SegmentFont::format(2456, 2, 1, UNIT_CELSIUS, segments);
+    sink = segments[0];
+}
+
+// 10x5 pixels, scrolled one column a frame
+static uint8_t ledImage[2 + 10 * 5 * 3] = {10, 5};
+static int8_t ledOffset                  = 0;
+
+static void ledFrame(void *context) {
+    uint8_t rgb[LED_MATRIX_PIXELS * 3];
+
+    LedMatrix::frame(ledImage, ledOffset++, 0, rgb);
+    sink = rgb[0];
+}
+
+// The calibration and a burst of a BME280 at 23 degC, 1009 hPa and 44 %RH.
+static const BME280Calibration_t BME280_CALIB = {28485, 26735, 50,
+                                                 37882, -10590, 3024, 7256, -47, -7, 9900, -10230, 4285,
+                                                 75, 359, 0, 338, 0, 30};
+static const uint8_t BME280_DATA[BME280_BURST] = {0x4D, 0xB1, 0x00, 0x80, 0xB4, 0x00, 0x73, 0x85};
+static const FilterPreset_t BME280_PRESET[SensorFilter::kChannels] = {
+    {true, -40.0f, 85.0f, true, 0.5f, 0.2f},
+    {true, 0.0f, 100.0f, true, 2.0f, 0.2f},
+    {true, 300.0f, 1100.0f, true, 0.5f, 0.2f},
+};
+static BME280Compensation bme280;
+static SensorFilter bme280Filter;
+
+static void bme280Read(void *context) {
+    float temperature, humidity, pressure;
+
+    bme280.compensate(BME280_DATA, temperature, humidity, pressure);
+    bme280Filter.update(temperature, humidity, pressure);
+    sink = (uint32_t)pressure;
+}
+
+static Gossip gossipSender;
+static Gossip gossipReceiver;
+static uint32_t gossipNow = 0;
+
+static void gossipFrame(void *context) {
+    static const TelemetrySample_t SAMPLE = {BENCH_EPOCH, 2456, 4512, 101325, 0};
+    uint8_t frame[GOSSIP_FRAME];
+
+    size_t length = gossipSender.announce(SAMPLE, kGossipValid, BENCH_EPOCH, frame, sizeof(frame));
+    sink          = gossipReceiver.receive(frame, length, BENCH_EPOCH, gossipNow++);
+}
+
+// A frame of 16 minutes, as /history and the fleet upload send them
+static TelemetrySample_t telemetryFrame[16];
+
+static void telemetryEncode(void *context) {
+    uint8_t frame[TELEMETRY_HEADER_SIZE + 16 * TELEMETRY_RECORD_MAX + TELEMETRY_CRC_SIZE];
+
+    sink = TelemetryCodec::encode(telemetryFrame, 16, frame, sizeof(frame));
+}
+
+// A sample a second: a minute closes every 60th op, an hour every 3600th.
+static Rollup rollup;
+static uint32_t rollupTime = BENCH_EPOCH;
+
+static void rollupAdd(void *context) {
+    TelemetrySample_t sample = {rollupTime++, 2250, 4510, 100830, 1};
+
+    rollup.add(sample);
+}
+
+static Trace tracer;
+static uint32_t tracerNow = 0;
+
+static void traceEvent(void *context) {
+    tracer.record('X', "bench", tracerNow, TRACE_MIN_SPAN, 1, "loopTask");
+    tracerNow += TRACE_MIN_SPAN;
+}
+
+static DeferredLog logger;
+static uint32_t loggerNow = 0;
+
+static void dlogRecord(void *context) {
+    logger.record(loggerNow, 1, 'I', "motion report #%u: %llu us, attempt %u, HTTP %d", loggerNow, (uint64_t)loggerNow * 1000, 1u, 200);
+    loggerNow++;
+}
+
+static TelemetrySample_t comfortSample = {BENCH_EPOCH, 2650, 6180, 100830, 0};
+static ComfortSample_t comfort;
+
+static void comfortDerive(void *context) {
+    ComfortMetrics::derive(comfortSample, 40, comfort);
+    sink                      = comfort.dewPoint + comfort.heatIndex + comfort.seaLevelPressure;
+    comfortSample.temperature = 2650 + (sink & 0x3FF);  // off the table knots
+}
+
+// The same formulas in float with expf() and logf(), what derive() saves
+static void comfortLibm(void *context) {
+    float t     = comfortSample.temperature / 100.0f;
+    float rh    = comfortSample.humidity / 100.0f;
+    float gamma = logf(rh / 100.0f) + 17.62f * t / (243.12f + t);
+    float e     = 6.112f * expf(17.62f * t / (243.12f + t)) * rh;  // [Pa]
+    float f     = t * 1.8f + 32.0f;
+    float hi    = -42.379f + 2.04901523f * f + 10.14333127f * rh - 0.22475541f * f * rh -
+               6.83783e-3f * f * f - 5.481717e-2f * rh * rh + 1.22874e-3f * f * f * rh +
+               8.5282e-4f * f * rh * rh - 1.99e-6f * f * f * rh * rh;
+    float slp = comfortSample.pressure * expf(40.0f / (29.263f * (t + 273.15f + 0.0065f * 40.0f / 2)));
+
+    sink                      = (uint32_t)(243.12f * gamma / (17.62f - gamma) * 100) + (uint32_t)(e * 2.167f / (t + 273.15f)) +
+           (uint32_t)hi + (uint32_t)slp;
+    comfortSample.temperature = 2650 + (sink & 0x3FF);
+}
+
+void addHotPaths(Bench &bench) {
+    static const uint8_t KEY[GOSSIP_KEY] = {0};
+
+    for (size_t i = 2; i < sizeof(ledImage); i++) {
+        ledImage[i] = i;
+    }
+    for (uint8_t i = 0; i < 16; i++) {
+        telemetryFrame[i] = {BENCH_EPOCH + i * 60u, (int16_t)(2200 + i * 3), (uint16_t)(4500 - i * 7), 100800u + i, (uint16_t)(i % 3 ? 0 : 20)};
+    }
+    bme280.begin(BME280_CALIB);
+    bme280Filter.configure(BME280_PRESET);
+    gossipSender.begin(KEY, 1, 1000);
+    gossipReceiver.begin(KEY, 2, 1000);
+
+    bench.add("clock_tick", clockTick);
+    bench.add("env_segments", envSegments);
+    bench.add("segment_format", segmentFormat);
+    bench.add("led_frame", ledFrame);
+    bench.add("bme280_read", bme280Read);
+    bench.add("gossip_frame", gossipFrame);
+    bench.add("telemetry_encode", telemetryEncode);
+    bench.add("rollup_add", rollupAdd);
+    bench.add("trace_event", traceEvent);
+    bench.add("dlog_record", dlogRecord);
+    bench.add("comfort_derive", comfortDerive);
+    bench.add("comfort_libm", comfortLibm);
+}
@@ -0,0 +1,49 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Bench.h>
+
+// The hot paths of the firmware that build without Arduino, the same on
+// the host and on the device:
+//
+//   clock_tick        TimeService::update() and read() of one render tick
+//   env_segments      SegmentFont::format() of the three environment pages
+//   segment_format    one of them, the temperature page
+//   led_frame         LedMatrix::frame() of a scrolling image
+//   bme280_read       compensation and filter of a recorded burst, the
+//                     bus mocked by the bytes it returned
+//   gossip_frame      a signed frame announced and verified
+//   telemetry_encode  TelemetryCodec::encode() of a frame of 16 minutes,
+//                     test_telemetry compares it with the text lines
+//   rollup_add        Rollup::add() of a sample a second, with the
+//                     buckets it closes on the way
+//   trace_event       Trace::record() of one event, what TRACE_x() adds
+//                     to the clock and task lookups on the device
+//   dlog_record       DeferredLog::record() of the motion report line,
+//                     what dlog_i() adds to the same lookups
+//   comfort_derive    ComfortMetrics::derive() of one sample, and
+//   comfort_libm      the same formulas in float with expf() and logf()
+void addHotPaths(Bench &bench);
@@ -0,0 +1,85 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <ChunkedWriter.h>
+
+ChunkedWriter::ChunkedWriter(WebServer &server) : _server(server) {
+    _length  = 0;
+    _written = 0;
+    _started = false;
+}
+
+ChunkedWriter::~ChunkedWriter() { end(); }
+
+void ChunkedWriter::begin(int code, const char *contentType) {
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(code, contentType, "");
+    _started = true;
+}
+
+void ChunkedWriter::end(void) {
+    if (!_started) {
+        return;
+    }
+    flush();
+    _server.sendContent("");  // last chunk
+    _started = false;
+}
+
+size_t ChunkedWriter::write(uint8_t c) {
+    if (_length == sizeof(_buffer)) {
+        flush();
+    }
+    _buffer[_length++] = c;
+    _written++;
+
+    return 1;
+}
+
+size_t ChunkedWriter::write(const uint8_t *buffer, size_t size) {
+    size_t remain = size;
+
+    while (remain) {
+        if (_length == sizeof(_buffer)) {
+            flush();
+        }
+        size_t n = sizeof(_buffer) - _length;
+        n        = (remain < n) ? remain : n;
+        memcpy(&_buffer[_length], buffer, n);
+        _length += n;
+        buffer += n;
+        remain -= n;
+    }
+    _written += size;
+
+    return size;
+}
+
+void ChunkedWriter::flush(void) {
+    if (_length == 0) {
+        return;
+    }
+    _server.sendContent_P(_buffer, _length);
+    _length = 0;
+}
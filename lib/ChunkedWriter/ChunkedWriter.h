@@ -0,0 +1,55 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+#define CHUNKED_WRITER_BUFFER 512
+
+// Print adapter that streams a response with chunked transfer encoding.
+// Output is collected in a fixed buffer and sent one chunk per buffer, so
+// a handler never builds the whole response in a String.
+class ChunkedWriter : public Print {
+   public:
+    ChunkedWriter(WebServer &server);
+    ~ChunkedWriter();
+
+    void begin(int code, const char *contentType);
+    void end(void);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    void flush(void);
+
+    size_t getWritten(void) const { return _written; }
+
+   private:
+    WebServer &_server;
+    char _buffer[CHUNKED_WRITER_BUFFER];
+    size_t _length;
+    size_t _written;
+    bool _started;
+};
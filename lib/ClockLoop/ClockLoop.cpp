@@ -0,0 +1,171 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include <ClockLoop.h>
+
+ClockLoop::ClockLoop(MotionLedger &ledger, UploadScheduler &scheduler, Connectivity &link,
+                     DisplayIntensity &intensity, OccupancyModel &occupancy, TimeService &time)
+    : _ledger(ledger), _scheduler(scheduler), _link(link), _intensity(intensity), _occupancy(occupancy), _time(time) {
+    _debounce     = 0;
+    _prewarm      = 0;
+    _defer        = 0;
+    _rise         = {0, false};
+    _motionSentAt = 0;
+}
+
+// debounce [ms], prewarm and motionDefer [min]
+void ClockLoop::configure(uint32_t debounce, uint32_t prewarm, uint32_t motionDefer) {
+    _debounce = debounce * 1000ULL;
+    _prewarm  = prewarm * 60;
+    _defer    = motionDefer * 60 * 1000;
+}
+
+// The ledger gets the times of the interrupt, so a loop() held up by an
+// upload is late with the accounting but not wrong.
+ClockLoop::Motion ClockLoop::edge(const MotionEdge_t &edge) {
+    if (edge.level) {
+        _rise = edge;
+        return kQuiet;
+    }
+    if (_rise.level) {
+        _rise.level = false;
+        if (edge.time - _rise.time < _debounce) {
+            return kGlitch;
+        }
+        _ledger.detected(_rise.time);
+        presence(true);
+    }
+    _ledger.released(edge.time);
+    presence(false);
+
+    return kReleased;
+}
+
+// A rise still held at now [us] is a presence once it outlasts the
+// debounce time; true when it was counted.
+bool ClockLoop::settle(uint64_t now) {
+    if (!_rise.level || now - _rise.time < _debounce) {
+        return false;
+    }
+    _ledger.detected(_rise.time);
+    presence(true);
+    _rise.level = false;
+
+    return true;
+}
+
+// The model counts whole minutes, the loop() time of an edge is precise
+// enough for it.
+void ClockLoop::presence(bool detecting) {
+    uint32_t week;
+
+    if (weekTime(week)) {
+        _occupancy.presence(detecting, week);
+    }
+}
+
+// Seconds into the local week, false while the clock is not set.
+bool ClockLoop::weekTime(uint32_t &week) const {
+    TimeSnapshot_t now;
+
+    _time.read(now);
+    if (now.utc < TIME_SERVICE_VALID) {
+        return false;
+    }
+    week = OccupancyModel::weekTime(now.local.tm_wday, now.local.tm_hour, now.local.tm_min, now.local.tm_sec);
+
+    return true;
+}
+
+// Closes the hours of the occupancy model and wakes the display prewarm
+// minutes before an hour people usually come; the idle timeout dims it
+// again if nobody does.
+bool ClockLoop::occupancy(uint32_t now) {
+    uint32_t week;
+
+    if (!weekTime(week)) {
+        return false;
+    }
+
+    uint32_t hours = _occupancy.getHours();
+    _occupancy.update(week);
+
+    uint8_t next = OccupancyModel::slot(week + _prewarm);
+    if (_prewarm && next != OccupancyModel::slot(week) && _occupancy.isExpected(next)) {
+        _intensity.activity(now);
+    }
+
+    return _occupancy.getHours() != hours && _occupancy.getHours() % OCCUPANCY_SAVE == 0;
+}
+
+// Motion reports wait for an hour the model expects nobody in, at most
+// motion_defer after the last one. ThingSpeak then gets fewer, longer
+// reports, and the radio stays quiet while people are around.
+bool ClockLoop::holdMotion(uint32_t now) const {
+    uint32_t week;
+
+    if (_defer == 0 || !weekTime(week)) {
+        return false;
+    }
+
+    return !_occupancy.isIdle(OccupancyModel::slot(week)) && now - _motionSentAt < _defer;
+}
+
+// The sensor upload of the period. One that cannot go is skipped, the
+// next period brings the next one (or expedite() after a reconnect).
+ClockLoop::Upload ClockLoop::pollSensor(uint32_t now, bool busy) {
+    if (!_scheduler.pollSensor(now)) {
+        return kNotDue;
+    }
+
+    return busy || !_link.canAttempt(now) ? kHeld : kSend;
+}
+
+bool ClockLoop::pollMotion(uint32_t now, bool busy) const {
+    return _ledger.hasPending() && !busy && _link.canAttempt(now) && !holdMotion(now) && _scheduler.pollMotion(now);
+}
+
+void ClockLoop::motionSent(uint32_t now) {
+    _scheduler.motionSent();
+    _motionSentAt = now;
+}
+
+// ntp: the wall clock was set since boot. sensor and upload are up to the
+// caller (a sample was valid, an upload was acknowledged).
+OtaProbe::Verdict ClockLoop::probe(uint32_t now, bool sensor, bool upload) const {
+    return OtaProbe::judge(_link.getTime(Connectivity::kOnline, now), _time.getSteppedAt() != 0, sensor, upload);
+}
+
+// Runs on the render clock, the writer of the time service. Auto dimming
+// knows no hour while the clock is not set.
+uint8_t ClockLoop::render(uint32_t now, time_t utc, int64_t monotonic) {
+    TimeSnapshot_t snapshot;
+
+    _time.update(utc, monotonic);
+    _time.read(snapshot);
+    int8_t hour = snapshot.utc >= TIME_SERVICE_VALID ? snapshot.local.tm_hour : -1;
+
+    return _intensity.update(now, hour);
+}
@@ -0,0 +1,106 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <Connectivity.h>
+#include <DisplayIntensity.h>
+#include <MotionInput.h>
+#include <MotionLedger.h>
+#include <OccupancyModel.h>
+#include <OtaProbe.h>
+#include <TimeService.h>
+#include <UploadScheduler.h>
+#include <stdint.h>
+
+// The decisions of the clock's loop() and render clock, on the objects
+// src/main.cpp owns: the PIR debounce, the occupancy model, when the
+// uploads go and what the display shows. test/test_sim/ClockSim.cpp runs
+// the same code in virtual time, so what the simulator reports is what the
+// device does.
+//
+// The caller does the I/O (reading MotionInput, ThingSpeak, NVS, logging)
+// and gives the clocks: now in ms (millis()), edge and debounce times in us
+// (esp_timer_get_time()). The settings are those of include/config.h in
+// their units there; 0 for prewarm or motionDefer turns that use of the
+// occupancy model off.
+// This file has no Arduino dependency and builds on the host as it is.
+
+#define OCCUPANCY_SAVE 6  // [h] between saves of the occupancy model to NVS
+
+class ClockLoop {
+   public:
+    enum Motion : uint8_t {
+        kQuiet = 0,  // a rise, held back until it outlasts the debounce time
+        kGlitch,     // a presence shorter than the debounce time, not counted
+        kReleased,   // the ledger has the presence, held rise included
+    };
+
+    enum Upload : uint8_t {
+        kNotDue = 0,
+        kHeld,  // due, but an OTA update or the link holds it until the next period
+        kSend,
+    };
+
+    ClockLoop(MotionLedger &ledger, UploadScheduler &scheduler, Connectivity &link, DisplayIntensity &intensity,
+              OccupancyModel &occupancy, TimeService &time);
+
+    void configure(uint32_t debounce, uint32_t prewarm, uint32_t motionDefer);
+
+    // handleMotion()
+    Motion edge(const MotionEdge_t &edge);
+    bool settle(uint64_t now);
+    const MotionEdge_t &getRise(void) const { return _rise; }
+
+    // handleOccupancy(), true when the model is due for a save
+    bool occupancy(uint32_t now);
+    bool holdMotion(uint32_t now) const;
+    bool weekTime(uint32_t &week) const;
+
+    // loop()
+    Upload pollSensor(uint32_t now, bool busy);
+    bool pollMotion(uint32_t now, bool busy) const;
+    void motionSent(uint32_t now);
+    OtaProbe::Verdict probe(uint32_t now, bool sensor, bool upload) const;
+
+    // renderDisplay(), the level of the display
+    uint8_t render(uint32_t now, time_t utc, int64_t monotonic);
+
+   private:
+    void presence(bool detecting);
+
+    MotionLedger &_ledger;
+    UploadScheduler &_scheduler;
+    Connectivity &_link;
+    DisplayIntensity &_intensity;
+    OccupancyModel &_occupancy;
+    TimeService &_time;
+
+    uint64_t _debounce;  // [us]
+    uint32_t _prewarm;   // [s]
+    uint32_t _defer;     // [ms]
+    MotionEdge_t _rise;
+    uint32_t _motionSentAt;  // [ms]
+};
@@ -0,0 +1,197 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <ComfortMetrics.h>
+
+// Compile-time tables: the values are computed by constexpr functions,
+// one call per index of a generated index pack, and end up in flash.
+template <int... I>
+struct Indices {};
+template <int N, int... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I>
+struct MakeIndices<0, I...> {
+    typedef Indices<I...> type;
+};
+
+constexpr double square(double x) { return x * x; }
+
+constexpr double series(double x, int n, double term) { return n > 16 ? term : term + series(x, n + 1, term * x / n); }
+
+constexpr double exponential(double x) { return (x > 0.25 || x < -0.25) ? square(exponential(x / 2)) : series(x, 1, 1.0); }
+
+// Saturation vapour pressure [0.01 Pa] every half degree of the range.
+#define ES_STEP  50  // [0.01 degC]
+#define ES_COUNT ((COMFORT_MAX_TEMPERATURE - COMFORT_MIN_TEMPERATURE) / ES_STEP + 1)
+
+constexpr uint32_t magnus(double t) { return (uint32_t)(61120.0 * exponential(17.62 * t / (243.12 + t)) + 0.5); }
+
+typedef struct {
+    uint32_t value[ES_COUNT];
+} SaturationTable_t;
+
+template <int... I>
+constexpr SaturationTable_t saturationTable(Indices<I...>) {
+    return SaturationTable_t{{magnus((COMFORT_MIN_TEMPERATURE + I * ES_STEP) / 100.0)...}};
+}
+
+static constexpr SaturationTable_t ES = saturationTable(MakeIndices<ES_COUNT>::type());
+
+// exp(x) in Q24 every 1/256 from -1/8 to 1, x of the sea-level reduction.
+#define EXP_SHIFT 16  // step of x in Q24, 1/256
+#define EXP_MIN   (-(1 << 21))
+#define EXP_COUNT ((((1 << 24) - EXP_MIN) >> EXP_SHIFT) + 1)
+
+typedef struct {
+    uint32_t value[EXP_COUNT];
+} ExpTable_t;
+
+template <int... I>
+constexpr ExpTable_t expTable(Indices<I...>) {
+    return ExpTable_t{{(uint32_t)(exponential((EXP_MIN + (I << EXP_SHIFT)) / 16777216.0) * (1 << 24) + 0.5)...}};
+}
+
+static constexpr ExpTable_t EXP = expTable(MakeIndices<EXP_COUNT>::type());
+
+static int32_t clamp(int32_t value, int32_t lower, int32_t upper) {
+    return value < lower ? lower : (value > upper ? upper : value);
+}
+
+static uint32_t isqrt(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit  = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+void ComfortMetrics::derive(const TelemetrySample_t &sample, int16_t altitude, ComfortSample_t &comfort) {
+    uint32_t e = _vapour(sample.temperature, sample.humidity);
+
+    comfort.dewPoint         = _dewPoint(e);
+    comfort.absoluteHumidity = _density(e, sample.temperature);
+    comfort.heatIndex        = heatIndex(sample.temperature, sample.humidity);
+    comfort.seaLevelPressure = seaLevel(sample.pressure, sample.temperature, altitude);
+}
+
+uint32_t ComfortMetrics::saturation(int32_t temperature) {
+    int32_t t     = clamp(temperature, COMFORT_MIN_TEMPERATURE, COMFORT_MAX_TEMPERATURE) - COMFORT_MIN_TEMPERATURE;
+    int32_t i     = t / ES_STEP;
+    int32_t frac  = t % ES_STEP;
+    uint32_t base = ES.value[i];
+
+    return frac ? base + (uint32_t)((uint64_t)(ES.value[i + 1] - base) * frac / ES_STEP) : base;
+}
+
+// The partial pressure of the water vapour [0.01 Pa].
+uint32_t ComfortMetrics::_vapour(int32_t temperature, uint32_t humidity) {
+    return (uint32_t)((uint64_t)saturation(temperature) * (humidity < 10000 ? humidity : 10000) / 10000);
+}
+
+int16_t ComfortMetrics::dewPoint(int32_t temperature, uint32_t humidity) {
+    return _dewPoint(_vapour(temperature, humidity));
+}
+
+uint16_t ComfortMetrics::absoluteHumidity(int32_t temperature, uint32_t humidity) {
+    return _density(_vapour(temperature, humidity), temperature);
+}
+
+// The temperature whose saturation pressure is the vapour pressure, the
+// bottom of the range for dry air.
+int16_t ComfortMetrics::_dewPoint(uint32_t e) {
+    int32_t lower = 0;
+    int32_t upper = ES_COUNT - 1;
+
+    if (e <= ES.value[0]) {
+        return COMFORT_MIN_TEMPERATURE;
+    }
+    while (upper - lower > 1) {  // ES[lower] < e <= ES[upper]
+        int32_t middle = (lower + upper) / 2;
+        if (ES.value[middle] < e) {
+            lower = middle;
+        } else {
+            upper = middle;
+        }
+    }
+    uint32_t step = ES.value[upper] - ES.value[lower];
+
+    return (int16_t)(COMFORT_MIN_TEMPERATURE + lower * ES_STEP + (int32_t)(((uint64_t)(e - ES.value[lower]) * ES_STEP + step / 2) / step));
+}
+
+// rho = e / (Rw T) with Rw = 461.5 J/(kg K).
+uint16_t ComfortMetrics::_density(uint32_t e, int32_t temperature) {
+    int32_t kelvin = clamp(temperature, COMFORT_MIN_TEMPERATURE, COMFORT_MAX_TEMPERATURE) + 27315;  // [0.01 K]
+
+    return (uint16_t)(((uint64_t)e * 216679 / 1000 + kelvin / 2) / kelvin);
+}
+
+// NOAA: Steadman's simple formula, the Rothfusz regression with its two
+// adjustments where the result is 80 degF or more. Computed in 0.01 degF.
+int16_t ComfortMetrics::heatIndex(int32_t temperature, uint32_t humidity) {
+    int64_t t  = clamp(temperature, COMFORT_MIN_TEMPERATURE, COMFORT_MAX_TEMPERATURE) * 9 / 5 + 3200;
+    int64_t r  = humidity < 10000 ? humidity : 10000;
+    int64_t hi = (t + 6100 + (t - 6800) * 12 / 10 + r * 94 / 1000) / 2;
+
+    if (hi + t >= 2 * 8000) {
+        int64_t t2 = t * t / 100;
+        int64_t r2 = r * r / 100;
+        int64_t a  = -423790000000LL + 204901523LL * t + 1014333127LL * r - 22475541LL * t * r / 100 - 683783LL * t2 -
+                    5481717LL * r2 + 122874LL * t2 * r / 100 + 85282LL * t * r2 / 100 - 199LL * t2 * r2 / 100;  // x 1e8
+        hi = a / 100000000;
+
+        if (r < 1300 && 8000 <= t && t <= 11200) {
+            int64_t d = t < 9500 ? 9500 - t : t - 9500;
+            hi -= (1300 - r) / 4 * isqrt(((uint64_t)(1700 - d) << 32) / 1700) >> 16;  // sqrt in Q16
+        } else if (r > 8500 && 8000 <= t && t <= 8700) {
+            hi += (r - 8500) * (8700 - t) / 5000;
+        }
+    }
+
+    return (int16_t)clamp((int32_t)((hi - 3200) * 5 / 9), INT16_MIN, INT16_MAX);
+}
+
+// Hypsometric reduction through a column at the station temperature plus
+// half the standard lapse: p0 = p exp(g h / (Rd Tm)).
+uint32_t ComfortMetrics::seaLevel(uint32_t pressure, int32_t temperature, int16_t altitude) {
+    int32_t h      = clamp(altitude, COMFORT_MIN_ALTITUDE, COMFORT_MAX_ALTITUDE);
+    int32_t kelvin = (clamp(temperature, COMFORT_MIN_TEMPERATURE, COMFORT_MAX_TEMPERATURE) + 27315) * 40 + h * 13;  // [0.01/40 K]
+    int32_t x      = (int32_t)((int64_t)h * 57316339 * 40 / kelvin) - EXP_MIN;  // Q24, g / Rd = 0.0341632 K/m
+    int32_t i      = x >> EXP_SHIFT;
+    int32_t frac   = x & ((1 << EXP_SHIFT) - 1);
+    int64_t factor = EXP.value[i] + (((int64_t)EXP.value[i + 1] - EXP.value[i]) * frac >> EXP_SHIFT);
+
+    return (uint32_t)(((uint64_t)pressure * factor + (1 << 23)) >> 24);
+}
@@ -0,0 +1,67 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <TelemetryCodec.h>
+#include <stdint.h>
+
+// Dew point, absolute humidity, heat index and sea-level pressure of one
+// sample, in the fixed-point units of TelemetrySample_t.
+//
+// The formulas need exp() and log(), soft float on every sample. Instead
+// the saturation vapour pressure over water (Magnus, WMO coefficients) and
+// exp() are tables made by the compiler and interpolated linearly; the
+// dew point is the saturation curve read backwards. The heat index is the
+// NOAA regression in 64-bit integers.
+// test_comfort checks them against the formulas in double precision.
+// No Arduino dependency.
+
+#define COMFORT_MIN_TEMPERATURE (-4000)  // [0.01 degC] table range, the
+#define COMFORT_MAX_TEMPERATURE 8500     // BME280 operating range
+#define COMFORT_MIN_ALTITUDE    (-500)   // [m]
+#define COMFORT_MAX_ALTITUDE    5000
+
+typedef struct {
+    int16_t dewPoint;           // [0.01 degC]
+    uint16_t absoluteHumidity;  // [0.01 g/m3]
+    int16_t heatIndex;          // [0.01 degC]
+    uint32_t seaLevelPressure;  // [Pa]
+} ComfortSample_t;
+
+class ComfortMetrics {
+   public:
+    static void derive(const TelemetrySample_t &sample, int16_t altitude, ComfortSample_t &comfort);
+
+    static uint32_t saturation(int32_t temperature);  // [0.01 Pa]
+    static int16_t dewPoint(int32_t temperature, uint32_t humidity);
+    static uint16_t absoluteHumidity(int32_t temperature, uint32_t humidity);
+    static int16_t heatIndex(int32_t temperature, uint32_t humidity);
+    static uint32_t seaLevel(uint32_t pressure, int32_t temperature, int16_t altitude);
+
+   private:
+    static uint32_t _vapour(int32_t temperature, uint32_t humidity);
+    static int16_t _dewPoint(uint32_t vapour);
+    static uint16_t _density(uint32_t vapour, int32_t temperature);
+};
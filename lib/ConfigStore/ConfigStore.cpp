@@ -0,0 +1,146 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <ConfigStore.h>
+#include <string.h>
+
+ConfigStore::ConfigStore(const ConfigKey_t *keys, uint8_t count) : _changed(0) {
+    _keys      = keys;
+    _count     = count < CONFIG_MAX_KEYS ? count : CONFIG_MAX_KEYS;
+    _backend   = NULL;
+    _dirty     = 0;
+    _observers = 0;
+    _writes    = 0;
+    _failures  = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        _value[i]     = _keys[i].value;
+        _stored[i]    = _keys[i].value;
+        _changedAt[i] = 0;
+    }
+}
+
+// Loads every key, a missing or out of range value falls back to the default.
+void ConfigStore::begin(ConfigBackend &backend) {
+    _backend = &backend;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        int32_t value;
+
+        if (_backend->read(_keys[i].name, value) && _keys[i].lower <= value && value <= _keys[i].upper) {
+            _value[i]  = value;
+            _stored[i] = value;
+        } else {
+            _value[i]  = _keys[i].value;
+            _stored[i] = _keys[i].value;  // the default needs no write
+        }
+    }
+}
+
+// false when value is out of range, the key keeps its value then.
+bool ConfigStore::set(uint8_t key, int32_t value, uint32_t now) {
+    if (_count <= key || value < _keys[key].lower || _keys[key].upper < value) {
+        return false;
+    }
+    if (_value[key] == value) {
+        return true;
+    }
+
+    _value[key]     = value;
+    _changedAt[key] = now;
+    _changed.fetch_or(1UL << key);
+
+    return true;
+}
+
+void ConfigStore::reset(uint8_t key, uint32_t now) {
+    if (key < _count) {
+        set(key, _keys[key].value, now);
+    }
+}
+
+// key is an index into the table or CONFIG_ANY.
+bool ConfigStore::observe(uint8_t key, ConfigObserver observer) {
+    if (_observers == CONFIG_MAX_OBSERVERS) {
+        return false;
+    }
+
+    _observer[_observers].key      = key;
+    _observer[_observers].observer = observer;
+    _observers++;
+
+    return true;
+}
+
+// Calls the observers of changed keys and writes the keys that have been
+// quiet for CONFIG_COALESCE (all of them with force).
+void ConfigStore::poll(uint32_t now, bool force) {
+    uint32_t changed = _changed.exchange(0);
+
+    for (uint8_t i = 0; changed != 0; i++, changed >>= 1) {
+        if ((changed & 1) == 0) {
+            continue;
+        }
+        _dirty |= 1UL << i;
+        for (uint8_t n = 0; n < _observers; n++) {
+            if (_observer[n].key == i || _observer[n].key == CONFIG_ANY) {
+                _observer[n].observer(i, _value[i]);
+            }
+        }
+    }
+
+    if (_dirty == 0 || _backend == NULL) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if ((_dirty & (1UL << i)) == 0 || (!force && now - _changedAt[i] < CONFIG_COALESCE)) {
+            continue;
+        }
+        _dirty &= ~(1UL << i);
+
+        int32_t value = _value[i];
+        if (value == _stored[i]) {
+            continue;  // changed back before it was written
+        }
+        if (_backend->write(_keys[i].name, value)) {
+            _stored[i] = value;
+            _writes++;
+        } else {
+            _failures++;
+            _dirty |= 1UL << i;  // retried after CONFIG_COALESCE
+            _changedAt[i] = now;
+        }
+    }
+}
+
+int8_t ConfigStore::find(const char *name) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (strcmp(_keys[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
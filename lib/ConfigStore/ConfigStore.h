@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Runtime settings with persistent storage.
+//
+// Keys are declared at compile time as a table of names, defaults and
+// ranges (see include/config.h), values are 32-bit integers. Reads come
+// from a RAM cache. set() can be called from any task, the change is
+// applied by poll() in the owner's task: observers are called there, and
+// a key is written to storage once it has stayed unchanged for
+// CONFIG_COALESCE, so dragging a slider costs one flash write.
+// No Arduino dependency, storage is behind ConfigBackend.
+
+#define CONFIG_MAX_KEYS      32
+#define CONFIG_MAX_OBSERVERS 8
+#define CONFIG_COALESCE      5000  // [ms]
+#define CONFIG_ANY           0xFF
+
+typedef struct {
+    const char *name;  // storage key, at most 15 characters for NVS
+    int32_t value;     // default
+    int32_t lower;
+    int32_t upper;
+} ConfigKey_t;
+
+class ConfigBackend {
+   public:
+    virtual ~ConfigBackend() {}
+
+    virtual bool read(const char *name, int32_t &value) = 0;
+    virtual bool write(const char *name, int32_t value)  = 0;
+};
+
+typedef void (*ConfigObserver)(uint8_t key, int32_t value);
+
+class ConfigStore {
+   public:
+    ConfigStore(const ConfigKey_t *keys, uint8_t count);
+
+    void begin(ConfigBackend &backend);
+
+    int32_t get(uint8_t key) const { return _value[key]; }
+    bool set(uint8_t key, int32_t value, uint32_t now);
+    void reset(uint8_t key, uint32_t now);
+
+    bool observe(uint8_t key, ConfigObserver observer);
+    void poll(uint32_t now, bool force = false);
+
+    int8_t find(const char *name) const;
+    const ConfigKey_t &key(uint8_t key) const { return _keys[key]; }
+    uint8_t count(void) const { return _count; }
+
+    uint32_t getWrites(void) const { return _writes; }
+    uint32_t getFailures(void) const { return _failures; }
+
+   private:
+    const ConfigKey_t *_keys;
+    uint8_t _count;
+    ConfigBackend *_backend;
+
+    volatile int32_t _value[CONFIG_MAX_KEYS];
+    int32_t _stored[CONFIG_MAX_KEYS];
+    volatile uint32_t _changedAt[CONFIG_MAX_KEYS];
+    std::atomic<uint32_t> _changed;  // observers not called yet
+    uint32_t _dirty;                 // not written yet
+
+    struct {
+        uint8_t key;
+        ConfigObserver observer;
+    } _observer[CONFIG_MAX_OBSERVERS];
+    uint8_t _observers;
+
+    uint32_t _writes;
+    uint32_t _failures;
+};
@@ -0,0 +1,251 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <Connectivity.h>
+#include <string.h>
+
+Connectivity::Connectivity() {
+    _backoffMin       = CONNECTIVITY_BACKOFF_MIN;
+    _backoffMax       = CONNECTIVITY_BACKOFF_MAX;
+    _associateTimeout = CONNECTIVITY_ASSOCIATE;
+    _observer         = nullptr;
+    _seed             = 1;
+
+    begin(1, 0);
+}
+
+void Connectivity::configure(uint32_t backoffMin, uint32_t backoffMax, uint32_t associateTimeout) {
+    _backoffMin       = backoffMin;
+    _backoffMax       = backoffMax < backoffMin ? backoffMin : backoffMax;
+    _associateTimeout = associateTimeout;
+}
+
+// Starts down with an association due at once; a link the driver already
+// has is picked up by the first link().
+void Connectivity::begin(uint32_t seed, uint32_t now) {
+    _seed         = seed ? seed : 1;
+    _state        = kDown;
+    _since        = now;
+    _accounted    = now;
+    _associateAt  = now;
+    _retryAt      = now;
+    _linkFailures = 0;
+    _failures     = 0;
+    _associations = 0;
+    _attempts     = 0;
+    _failed       = 0;
+    _transitions  = 0;
+    _active       = 0;
+    memset(_time, 0, sizeof(_time));
+}
+
+void Connectivity::link(bool associated, bool ip, uint32_t now) {
+    account(now);
+
+    if (ip) {
+        if (_state == kDown || _state == kAssociating) {
+            _linkFailures = 0;
+            _failures     = 0;
+            _retryAt      = now;
+            enter(kIp, now);
+        }
+        return;
+    }
+
+    switch (_state) {
+        case kDown:
+            if (associated) {  // joined without being asked
+                enter(kAssociating, now);
+            }
+            break;
+        case kAssociating:
+            break;  // poll() times the join
+        default:
+            if (associated) {  // the address went, DHCP is at it again
+                enter(kAssociating, now);
+            } else {  // the AP went; it may be a reboot, try once at once
+                _associateAt = now;
+                enter(kDown, now);
+            }
+            break;
+    }
+}
+
+Connectivity::Action Connectivity::poll(uint32_t now) {
+    account(now);
+
+    if (_state == kAssociating && now - _since >= _associateTimeout) {
+        if (_linkFailures < UINT8_MAX) {
+            _linkFailures++;
+        }
+        _associateAt = now + backoff(_linkFailures);
+        enter(kDown, now);
+        return kAbandon;
+    }
+
+    if (_state == kDown && (int32_t)(now - _associateAt) >= 0) {
+        _associations++;
+        enter(kAssociating, now);
+        return kAssociate;
+    }
+
+    return kNone;
+}
+
+// A manual retry: forgets both backoffs, the caller starts the join.
+void Connectivity::reconnect(uint32_t now) {
+    account(now);
+
+    _linkFailures = 0;
+    _failures     = 0;
+    _retryAt      = now;
+    _associations++;
+    enter(kAssociating, now);
+}
+
+bool Connectivity::canAttempt(uint32_t now) const {
+    if (_state != kIp && _state != kOnline && _state != kDegraded) {
+        return false;
+    }
+
+    return (int32_t)(now - _retryAt) >= 0;
+}
+
+// An attempt from start to now. One that ends after the link went only
+// counts, link() has already moved the state.
+void Connectivity::attempted(Outcome outcome, uint32_t start, uint32_t now) {
+    account(now);
+
+    _attempts++;
+    _active += now - start;
+    if (outcome == kFailed) {
+        _failed++;
+    }
+
+    if (_state != kIp && _state != kOnline && _state != kDegraded) {
+        return;
+    }
+
+    if (outcome == kFailed) {
+        if (_failures < UINT8_MAX) {
+            _failures++;
+        }
+        _retryAt = now + backoff(_failures);
+        enter(kDegraded, now);
+    } else {
+        _failures = 0;
+        _retryAt  = now;
+        enter(kOnline, now);
+    }
+}
+
+const char *Connectivity::name(State state) {
+    static const char *NAMES[kStates] = {"down", "associating", "ip", "online", "degraded"};
+
+    return state < kStates ? NAMES[state] : "unknown";
+}
+
+// Until the next upload may be tried, or the next association when down.
+uint32_t Connectivity::getWait(uint32_t now) const {
+    int32_t wait = 0;
+
+    if (_state == kDown) {
+        wait = (int32_t)(_associateAt - now);
+    } else if (_state != kAssociating) {
+        wait = (int32_t)(_retryAt - now);
+    }
+
+    return wait > 0 ? wait : 0;
+}
+
+uint64_t Connectivity::getTime(State state, uint32_t now) const {
+    uint64_t time = _time[state];
+
+    if (state == _state) {
+        time += now - _accounted;
+    }
+
+    return time;
+}
+
+float Connectivity::getCharge(uint32_t now) const {
+    static const float CURRENT[kStates] = {
+        CONNECTIVITY_IDLE_MA,
+        CONNECTIVITY_SCAN_MA,
+        CONNECTIVITY_LINK_MA,
+        CONNECTIVITY_LINK_MA,
+        CONNECTIVITY_LINK_MA,
+    };
+    double charge = (double)_active * (CONNECTIVITY_ACTIVE_MA - CONNECTIVITY_LINK_MA);
+
+    for (uint8_t s = 0; s < kStates; s++) {
+        charge += (double)getTime((State)s, now) * CURRENT[s];
+    }
+
+    return charge / 3600000.0;  // mA ms to mAh
+}
+
+void Connectivity::enter(State state, uint32_t now) {
+    State previous = _state;
+
+    _since = now;
+    if (state == previous) {
+        return;
+    }
+
+    _state = state;
+    _transitions++;
+    if (_observer) {
+        _observer(state, previous);
+    }
+}
+
+void Connectivity::account(uint32_t now) {
+    _time[_state] += now - _accounted;
+    _accounted = now;
+}
+
+// Doubles from backoffMin per failure up to backoffMax, then keeps the
+// one half and draws the other half at random.
+uint32_t Connectivity::backoff(uint8_t failures) {
+    uint32_t delay = _backoffMin;
+
+    for (uint8_t n = 1; n < failures && delay < _backoffMax; n++) {
+        delay *= 2;
+    }
+    if (delay > _backoffMax) {
+        delay = _backoffMax;
+    }
+
+    return delay / 2 + draw() % (delay / 2 + 1);
+}
+
+// xorshift32
+uint32_t Connectivity::draw(void) {
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+
+    return _seed;
+}
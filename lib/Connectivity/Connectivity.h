@@ -0,0 +1,133 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Link and upload state of the clock, driven by a millisecond clock from
+// outside (millis() on the device, virtual time in the simulator).
+//
+//   kDown        no association; the next one is tried after a backoff
+//   kAssociating the driver is joining the AP or waiting for DHCP
+//   kIp          an address, nothing known about the internet yet
+//   kOnline      the last upload reached the server
+//   kDegraded    an address, but the last upload did not get through
+//                (DNS, TCP or TLS failed or timed out)
+//
+// Failed associations and failed uploads back off exponentially from
+// backoffMin to backoffMax, each delay with "equal jitter" (a random half
+// of it added to the other half) so a room of clocks does not retry in
+// step. A new address clears the upload backoff: it is the one moment a
+// retry is most likely to work.
+//
+// The time in each state, the upload attempts and a charge estimate from
+// the CONNECTIVITY_*_MA figures are accounted. The observer is called on
+// every state change, in the caller's task.
+// No Arduino dependency, the caller polls the driver and does the I/O.
+
+#define CONNECTIVITY_BACKOFF_MIN 15000   // [ms]
+#define CONNECTIVITY_BACKOFF_MAX 120000  // [ms]
+#define CONNECTIVITY_ASSOCIATE   15000   // [ms] to join and get an address
+#define CONNECTIVITY_IDLE_MA     0.0f    // [mA] radio off between associations
+#define CONNECTIVITY_SCAN_MA     110.0f  // [mA] scanning and joining
+#define CONNECTIVITY_LINK_MA     20.0f   // [mA] associated, modem sleep
+#define CONNECTIVITY_ACTIVE_MA   130.0f  // [mA] over an upload attempt
+
+class Connectivity {
+   public:
+    enum State {
+        kDown = 0,
+        kAssociating,
+        kIp,
+        kOnline,
+        kDegraded,
+        kStates,
+    };
+
+    enum Action {
+        kNone = 0,
+        kAssociate,  // start joining the AP
+        kAbandon,    // the join took too long, stop it
+    };
+
+    enum Outcome {
+        kSucceeded = 0,
+        kRejected,  // the server answered with an error
+        kFailed,    // the server was not reached
+    };
+
+    typedef void (*Observer)(State state, State previous);
+
+    Connectivity();
+
+    void configure(uint32_t backoffMin, uint32_t backoffMax, uint32_t associateTimeout);
+    void begin(uint32_t seed, uint32_t now);
+    void onChange(Observer observer) { _observer = observer; }
+
+    void link(bool associated, bool ip, uint32_t now);
+    Action poll(uint32_t now);
+    void reconnect(uint32_t now);
+
+    bool canAttempt(uint32_t now) const;
+    void attempted(Outcome outcome, uint32_t start, uint32_t now);
+
+    State getState(void) const { return _state; }
+    static const char *name(State state);
+    uint32_t getWait(uint32_t now) const;
+    uint8_t getFailures(void) const { return _failures; }
+    uint32_t getAssociations(void) const { return _associations; }
+    uint32_t getAttempts(void) const { return _attempts; }
+    uint32_t getFailed(void) const { return _failed; }
+    uint32_t getTransitions(void) const { return _transitions; }
+    uint64_t getTime(State state, uint32_t now) const;
+    float getCharge(uint32_t now) const;
+
+   private:
+    void enter(State state, uint32_t now);
+    void account(uint32_t now);
+    uint32_t backoff(uint8_t failures);
+    uint32_t draw(void);
+
+    uint32_t _backoffMin;
+    uint32_t _backoffMax;
+    uint32_t _associateTimeout;
+    Observer _observer;
+    uint32_t _seed;
+
+    State _state;
+    uint32_t _since;      // entered the state
+    uint32_t _accounted;  // time accounted up to
+    uint32_t _associateAt;
+    uint32_t _retryAt;
+    uint8_t _linkFailures;  // in a row
+    uint8_t _failures;      // uploads, in a row
+
+    uint32_t _associations;
+    uint32_t _attempts;
+    uint32_t _failed;
+    uint32_t _transitions;
+    uint64_t _time[kStates];  // [ms]
+    uint64_t _active;         // [ms] in upload attempts
+};
@@ -0,0 +1,148 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Per-core rings of records for many producers and any number of readers,
+// as DeferredLog and Trace keep them.
+//
+// Producers on a core reserve a slot with a CAS on its head, fill the
+// record in place and publish it with the slot's sequence number, so tasks
+// and ISRs may write at any time. The rings overwrite their oldest
+// records; every reader keeps its own cursor and counts what it missed.
+// No Arduino dependency, the caller says which core it is on.
+
+template <typename T, uint16_t RECORDS, uint8_t CORES>
+class CoreRing {
+    static_assert((RECORDS & (RECORDS - 1)) == 0, "RECORDS must be a power of two");
+
+   public:
+    typedef uint32_t Cursor;
+
+    CoreRing() {
+        for (uint8_t c = 0; c < CORES; c++) {
+            _ring[c].head = 0;
+            for (uint16_t i = 0; i < RECORDS; i++) {
+                _ring[c].slot[i].seq = 0;
+            }
+        }
+        _lost = 0;
+    }
+
+    // The record to fill, then publish() it with the same ticket.
+    T &reserve(uint8_t core, Cursor &ticket) {
+        Ring_t &ring = _ring[core];
+
+        ticket = ring.head.load(std::memory_order_relaxed);
+        while (!ring.head.compare_exchange_weak(ticket, ticket + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        }
+
+        Slot_t &slot = ring.slot[ticket & (RECORDS - 1)];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        return slot.record;
+    }
+
+    void publish(uint8_t core, Cursor ticket) {
+        _ring[core].slot[ticket & (RECORDS - 1)].seq.store(ticket + 1, std::memory_order_release);
+    }
+
+    Cursor oldest(uint8_t core) const {
+        uint32_t head = _ring[core].head.load(std::memory_order_acquire);
+
+        return head > RECORDS ? head - RECORDS : 0;
+    }
+
+    Cursor head(uint8_t core) const { return _ring[core].head.load(std::memory_order_acquire); }
+
+    // Next record of core after cursor. False at the end, and at a record
+    // that is still being written; a record overwritten under the reader
+    // is skipped and counted as lost.
+    bool read(uint8_t core, Cursor &cursor, T &record) {
+        Ring_t &ring = _ring[core];
+
+        while (true) {
+            uint32_t head = ring.head.load(std::memory_order_acquire);
+            if (cursor == head) {
+                return false;
+            }
+            if (head - cursor > RECORDS) {
+                _lost.fetch_add(head - cursor - RECORDS, std::memory_order_relaxed);
+                cursor = head - RECORDS;
+            }
+
+            Slot_t &slot = ring.slot[cursor & (RECORDS - 1)];
+            uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != cursor + 1) {
+                if ((int32_t)(seq - (cursor + 1)) < 0) {
+                    return false;  // reserved, not written yet
+                }
+                _lost.fetch_add(1, std::memory_order_relaxed);
+                cursor++;
+                continue;
+            }
+
+            record = slot.record;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == seq) {
+                cursor++;
+                return true;
+            }
+            _lost.fetch_add(1, std::memory_order_relaxed);
+            cursor++;
+        }
+    }
+
+    uint32_t getRecords(void) const {
+        uint32_t records = 0;
+
+        for (uint8_t c = 0; c < CORES; c++) {
+            records += _ring[c].head.load(std::memory_order_relaxed);
+        }
+
+        return records;
+    }
+
+    uint32_t getLost(void) const { return _lost.load(std::memory_order_relaxed); }
+
+   private:
+    typedef struct {
+        std::atomic<uint32_t> seq;  // cursor + 1 once the record is complete
+        T record;
+    } Slot_t;
+
+    typedef struct {
+        std::atomic<uint32_t> head;
+        Slot_t slot[RECORDS];
+    } Ring_t;
+
+    Ring_t _ring[CORES];
+    std::atomic<uint32_t> _lost;
+};
@@ -0,0 +1,155 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <DeferredLog.h>
+#include <stdio.h>
+
+void DeferredLog::_commit(uint32_t time, uint8_t core, char level, const char *format, const uint32_t *arg, uint8_t words) {
+    Cursor ticket;
+    LogRecord_t &record = _rings.reserve(core, ticket);
+
+    record.time   = time;
+    record.format = format;
+    record.level  = level;
+    record.core   = core;
+    record.words  = words;
+    memcpy(record.arg, arg, words * sizeof(uint32_t));
+
+    _rings.publish(core, ticket);
+}
+
+// The earliest next record of all cores, cursors has one per core.
+bool DeferredLog::read(Cursor *cursors, LogRecord_t &record) {
+    LogRecord_t candidate;
+    int8_t first = -1;
+
+    for (uint8_t c = 0; c < DEFERRED_LOG_CORES; c++) {
+        if (!read(c, cursors[c], candidate)) {
+            continue;
+        }
+        cursors[c]--;  // peeked, lost records before it stay skipped
+        if (first < 0 || (int32_t)(candidate.time - record.time) < 0) {
+            record = candidate;
+            first  = c;
+        }
+    }
+    if (first < 0) {
+        return false;
+    }
+    cursors[first]++;
+
+    return true;
+}
+
+// printf() of the record, one conversion at a time with the argument type
+// the conversion asks for. Missing arguments print as '?'.
+size_t DeferredLog::format(const LogRecord_t &record, char *buffer, size_t size) {
+    const char *p = record.format;
+    uint8_t word  = 0;
+    size_t n      = 0;
+
+    while (*p && n + 1 < size) {
+        if (*p != '%') {
+            buffer[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            buffer[n++] = '%';
+            p += 2;
+            continue;
+        }
+
+        char spec[16];
+        uint8_t s = 0;
+        uint8_t l = 0;  // number of 'l'
+
+        spec[s++] = *p++;
+        while (*p && strchr("-+ #0123456789.hlz", *p) && s < sizeof(spec) - 2) {
+            l += *p == 'l';
+            spec[s++] = *p++;
+        }
+        char conversion = *p;
+        if (conversion == '\0') {
+            break;
+        }
+        spec[s++] = *p++;
+        spec[s]   = '\0';
+
+        uint8_t need = (l >= 2 && strchr("diuxXo", conversion)) ? 2 : 1;
+        if (word + need > record.words) {
+            buffer[n++] = '?';
+            continue;
+        }
+
+        const uint32_t *a = &record.arg[word];
+        int written       = 0;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                written = need == 2 ? snprintf(&buffer[n], size - n, spec, (long long)((uint64_t)a[1] << 32 | a[0]))
+                                    : snprintf(&buffer[n], size - n, spec, (int32_t)a[0]);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                written = need == 2 ? snprintf(&buffer[n], size - n, spec, (unsigned long long)((uint64_t)a[1] << 32 | a[0]))
+                                    : snprintf(&buffer[n], size - n, spec, a[0]);
+                break;
+            case 'c':
+                written = snprintf(&buffer[n], size - n, spec, (int)a[0]);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                float f;
+                memcpy(&f, a, sizeof(f));
+                written = snprintf(&buffer[n], size - n, spec, (double)f);
+                break;
+            }
+            case 's':
+                written = snprintf(&buffer[n], size - n, spec, (const char *)(uintptr_t)a[0]);
+                break;
+            case 'p':
+                written = snprintf(&buffer[n], size - n, spec, (void *)(uintptr_t)a[0]);
+                break;
+            default:
+                break;
+        }
+        word += need;
+        if (written > 0) {
+            n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+        }
+    }
+    buffer[n] = '\0';
+
+    return n;
+}
+
+#if defined(ARDUINO) && !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_DEFERREDLOG)
+DeferredLog deferredLog;
+#endif
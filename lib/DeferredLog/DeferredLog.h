@@ -0,0 +1,151 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <CoreRing.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <type_traits>
+
+// Deferred logging: dlog_x() stores the address of the format string and
+// the raw arguments, the text is made later by whoever reads the records
+// (LogDrain to Serial, /log over HTTP, or tools/log_decode.py on a binary
+// dump with the firmware ELF). A record costs a compare-and-swap and a
+// copy of a few words instead of a vsnprintf() and a wait on the UART.
+//
+// The records are kept in a CoreRing, one ring per core, so tasks and ISRs
+// may log at any time. The rings overwrite their oldest records, and
+// every reader keeps its own cursor.
+//
+// The arguments are kept as 32-bit words: integers as they are (64-bit
+// ones in two words), floating point as float. %s must be given a string
+// that outlives the record, a literal or a static table entry.
+// The class has no Arduino dependency; the host bench records with it. On
+// the device the dlog_x() macros record with esp_timer_get_time() and the
+// core.
+
+#define DEFERRED_LOG_RECORDS 64  // per core, power of two
+#define DEFERRED_LOG_WORDS   6
+#define DEFERRED_LOG_CORES   2  // portNUM_PROCESSORS
+#define DEFERRED_LOG_MAGIC   0x474F4C44  // "DLOG"
+
+typedef struct {
+    uint32_t time;       // [us] low 32 bits of esp_timer_get_time()
+    const char *format;  // the ID, its address in the firmware
+    char level;          // 'E', 'W', 'I', 'D', 'V'
+    uint8_t core;
+    uint8_t words;
+    uint8_t reserved;
+    uint32_t arg[DEFERRED_LOG_WORDS];
+} LogRecord_t;
+
+class DeferredLog {
+   public:
+    typedef uint32_t Cursor;
+
+    template <typename... Args>
+    void record(uint32_t time, uint8_t core, char level, const char *format, Args... args) {
+        uint32_t arg[DEFERRED_LOG_WORDS];
+        uint8_t words = 0;
+
+        _pack(arg, words, args...);
+        _commit(time, core, level, format, arg, words);
+    }
+
+    Cursor oldest(uint8_t core) const { return _rings.oldest(core); }
+    bool read(uint8_t core, Cursor &cursor, LogRecord_t &record) { return _rings.read(core, cursor, record); }
+    bool read(Cursor *cursors, LogRecord_t &record);
+    static size_t format(const LogRecord_t &record, char *buffer, size_t size);
+
+    uint32_t getRecords(void) const { return _rings.getRecords(); }
+    uint32_t getLost(void) const { return _rings.getLost(); }
+
+   private:
+    void _commit(uint32_t time, uint8_t core, char level, const char *format, const uint32_t *arg, uint8_t words);
+
+    static void _pack(uint32_t *, uint8_t &) {}
+
+    template <typename T, typename... Args>
+    static void _pack(uint32_t *arg, uint8_t &words, T value, Args... args) {
+        _put(arg, words, value);
+        _pack(arg, words, args...);
+    }
+
+    template <typename T>
+    static typename std::enable_if<(std::is_integral<T>::value || std::is_enum<T>::value) && sizeof(T) <= 4>::type _put(uint32_t *arg, uint8_t &words, T value) {
+        if (words < DEFERRED_LOG_WORDS) {
+            arg[words++] = (uint32_t)value;
+        }
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 8>::type _put(uint32_t *arg, uint8_t &words, T value) {
+        if (words + 1 < DEFERRED_LOG_WORDS) {
+            arg[words++] = (uint32_t)((uint64_t)value);
+            arg[words++] = (uint32_t)((uint64_t)value >> 32);
+        }
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type _put(uint32_t *arg, uint8_t &words, T value) {
+        float f = (float)value;
+        if (words < DEFERRED_LOG_WORDS) {
+            memcpy(&arg[words++], &f, sizeof(f));
+        }
+    }
+
+    static void _put(uint32_t *arg, uint8_t &words, const void *value) {
+        if (words < DEFERRED_LOG_WORDS) {
+            arg[words++] = (uint32_t)(uintptr_t)value;
+        }
+    }
+
+    CoreRing<LogRecord_t, DEFERRED_LOG_RECORDS, DEFERRED_LOG_CORES> _rings;
+};
+
+#if defined(ARDUINO) && !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_DEFERREDLOG)
+#include <Arduino.h>
+#include <esp32-hal-log.h>
+
+extern DeferredLog deferredLog;
+
+static_assert(DEFERRED_LOG_CORES == portNUM_PROCESSORS, "DEFERRED_LOG_CORES is not the number of cores");
+
+#define DLOG_RECORD(level, format, ...) deferredLog.record((uint32_t)esp_timer_get_time(), xPortGetCoreID(), level, format, ##__VA_ARGS__)
+
+// Compiled in and out with the same CORE_DEBUG_LEVEL as log_x().
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+#define dlog_i(format, ...) DLOG_RECORD('I', format, ##__VA_ARGS__)
+#else
+#define dlog_i(format, ...)
+#endif
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+#define dlog_d(format, ...) DLOG_RECORD('D', format, ##__VA_ARGS__)
+#else
+#define dlog_d(format, ...)
+#endif
+#endif
@@ -0,0 +1,43 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <DimmableDisplay.h>
+
+#define TM1637_DISPLAY_CONTROL 0x80
+
+DimmableDisplay::DimmableDisplay(uint8_t pinClk, uint8_t pinDIO) : TM1637Display(pinClk, pinDIO) {
+    _brightness = 7;
+    _on         = true;
+}
+
+// Display control command only, the segments stay as they are.
+void DimmableDisplay::setLevel(uint8_t brightness, bool on) {
+    _brightness = brightness & 0x07;
+    _on         = on;
+    setBrightness(_brightness, _on);
+
+    start();
+    writeByte(TM1637_DISPLAY_CONTROL | (_on ? 0x08 : 0x00) | _brightness);
+    stop();
+}
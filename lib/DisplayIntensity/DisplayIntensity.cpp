@@ -0,0 +1,178 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <DisplayIntensity.h>
+
+// PWM value for each perceptual level, the inverse of CIE 1976 L*.
+const uint8_t DisplayIntensity::GAMMA[256] = {
+      0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,
+      2,   2,   2,   2,   2,   2,   2,   3,   3,   3,   3,   3,   3,   3,   3,   4,
+      4,   4,   4,   4,   4,   5,   5,   5,   5,   5,   6,   6,   6,   6,   6,   7,
+      7,   7,   7,   8,   8,   8,   8,   9,   9,   9,  10,  10,  10,  10,  11,  11,
+     11,  12,  12,  12,  13,  13,  13,  14,  14,  15,  15,  15,  16,  16,  17,  17,
+     17,  18,  18,  19,  19,  20,  20,  21,  21,  22,  22,  23,  23,  24,  24,  25,
+     25,  26,  26,  27,  28,  28,  29,  29,  30,  31,  31,  32,  32,  33,  34,  34,
+     35,  36,  37,  37,  38,  39,  39,  40,  41,  42,  43,  43,  44,  45,  46,  47,
+     47,  48,  49,  50,  51,  52,  53,  54,  54,  55,  56,  57,  58,  59,  60,  61,
+     62,  63,  64,  65,  66,  67,  68,  70,  71,  72,  73,  74,  75,  76,  77,  79,
+     80,  81,  82,  83,  85,  86,  87,  88,  90,  91,  92,  94,  95,  96,  98,  99,
+    100, 102, 103, 105, 106, 108, 109, 110, 112, 113, 115, 116, 118, 120, 121, 123,
+    124, 126, 128, 129, 131, 132, 134, 136, 138, 139, 141, 143, 145, 146, 148, 150,
+    152, 154, 155, 157, 159, 161, 163, 165, 167, 169, 171, 173, 175, 177, 179, 181,
+    183, 185, 187, 189, 191, 193, 196, 198, 200, 202, 204, 207, 209, 211, 214, 216,
+    218, 220, 223, 225, 228, 230, 232, 235, 237, 240, 242, 245, 247, 250, 252, 255,
+};
+
+// TM1637 pulse widths are 1/16, 2/16, 4/16, 10/16 ... 14/16.
+// Their CIE L* relative to the brightest one, on the 0-255 scale.
+const uint8_t DisplayIntensity::TM1637_DUTY[DISPLAY_TM1637_LEVELS]      = {1, 2, 4, 10, 11, 12, 13, 14};
+const uint8_t DisplayIntensity::TM1637_LIGHTNESS[DISPLAY_TM1637_LEVELS] = {82, 114, 154, 224, 232, 240, 248, 255};
+
+DisplayFade::DisplayFade(uint8_t level) {
+    _from     = level;
+    _to       = level;
+    _start    = 0;
+    _duration = 0;
+}
+
+void DisplayFade::start(uint8_t to, uint32_t duration, uint32_t now) {
+    _from     = value(now);
+    _to       = to;
+    _start    = now;
+    _duration = duration;
+}
+
+uint8_t DisplayFade::value(uint32_t now) const {
+    uint32_t elapsed = now - _start;
+
+    if (elapsed >= _duration) {
+        return _to;
+    }
+
+    return _from + ((int32_t)_to - _from) * (int32_t)elapsed / (int32_t)_duration;
+}
+
+DisplayIntensity::DisplayIntensity() : _ambient(255), _scene(255) {
+    configure(255, 255, 255, 0, 0, 0, 0, 0);
+    _detecting    = false;
+    _lastActivity = 0;
+    _level        = 255;
+}
+
+void DisplayIntensity::configure(uint8_t day, uint8_t night, uint8_t idle, uint8_t nightStart, uint8_t nightEnd, uint32_t idleTimeout, uint32_t blankTimeout, uint32_t fade) {
+    _day          = day;
+    _night        = night;
+    _idle         = idle;
+    _nightStart   = nightStart;
+    _nightEnd     = nightEnd;
+    _idleTimeout  = idleTimeout;
+    _blankTimeout = blankTimeout;
+    _fade         = fade;
+}
+
+void DisplayIntensity::motion(bool detecting, uint32_t now) {
+    _detecting    = detecting;
+    _lastActivity = now;
+}
+
+void DisplayIntensity::activity(uint32_t now) {
+    _lastActivity = now;
+}
+
+void DisplayIntensity::setScene(uint8_t level, uint32_t duration, uint32_t now) {
+    _scene.start(level, duration, now);
+}
+
+bool DisplayIntensity::isIdle(uint32_t now) const {
+    return _idleTimeout != 0 && !_detecting && now - _lastActivity >= _idleTimeout;
+}
+
+bool DisplayIntensity::isBlank(uint32_t now) const {
+    return _blankTimeout != 0 && !_detecting && now - _lastActivity >= _blankTimeout;
+}
+
+// hour < 0 while the time is not known, the day level applies then.
+uint8_t DisplayIntensity::_target(uint32_t now, int8_t hour) const {
+    uint8_t target = _day;
+
+    if (0 <= hour && _nightStart != _nightEnd) {
+        bool night = _nightStart < _nightEnd ? (_nightStart <= hour && hour < _nightEnd)
+                                             : (_nightStart <= hour || hour < _nightEnd);
+        if (night) {
+            target = _night;
+        }
+    }
+    if (isIdle(now) && _idle < target) {
+        target = _idle;
+    }
+    if (isBlank(now)) {
+        target = 0;
+    }
+
+    return target;
+}
+
+uint8_t DisplayIntensity::update(uint32_t now, int8_t hour) {
+    uint8_t target = _target(now, hour);
+
+    if (target != _ambient.target()) {
+        // waking up is immediate, dimming is gradual
+        _ambient.start(target, target > _ambient.value(now) ? 0 : _fade, now);
+    }
+    _level = (uint16_t)_ambient.value(now) * _scene.value(now) / 255;
+
+    return _level;
+}
+
+// Nearest TM1637 duty level, false when the display should be off.
+bool DisplayIntensity::tm1637(uint8_t level, uint8_t &brightness) {
+    if (level < TM1637_LIGHTNESS[0] / 2) {
+        brightness = 0;
+        return false;
+    }
+
+    brightness = 0;
+    for (uint8_t i = 1; i < DISPLAY_TM1637_LEVELS; i++) {
+        if (level >= (TM1637_LIGHTNESS[i - 1] + TM1637_LIGHTNESS[i]) / 2) {
+            brightness = i;
+        }
+    }
+
+    return true;
+}
+
+// Estimates from typical module figures, good for comparing settings.
+float DisplayIntensity::tm1637Current(uint8_t level, uint8_t segments) {
+    uint8_t brightness;
+
+    if (!tm1637(level, brightness)) {
+        return DISPLAY_TM1637_IDLE;
+    }
+
+    return DISPLAY_TM1637_IDLE + DISPLAY_TM1637_MA * segments * TM1637_DUTY[brightness] / 14.0f;
+}
+
+float DisplayIntensity::ws2812Current(uint8_t scale, uint16_t rgbSum, uint8_t pixels) {
+    return DISPLAY_WS2812_IDLE * pixels + DISPLAY_WS2812_MA * rgbSum / 255.0f * scale / 255.0f;
+}
@@ -0,0 +1,106 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Display intensity on a perceptual scale (0 = off, 255 = full, steps look
+// even to the eye), mapped to the TM1637's 8 duty levels and to WS2812 PWM
+// by lookup tables.
+//
+// The level is the ambient target (day, night, dimmed when nobody has been
+// around for a while, or off after a longer while) times a scene level the caller fades for its
+// own effects. Both fade linearly in perceptual space on the caller's
+// render clock, nothing here blocks.
+// No Arduino dependency, the caller provides the clock and the hour.
+
+#define DISPLAY_TM1637_LEVELS 8
+#define DISPLAY_TM1637_MA     3.0f   // [mA] per lit segment at full duty
+#define DISPLAY_TM1637_IDLE   1.0f   // [mA] controller
+#define DISPLAY_WS2812_MA     20.0f  // [mA] per colour channel at full PWM
+#define DISPLAY_WS2812_IDLE   1.0f   // [mA] per pixel
+
+class DisplayFade {
+   public:
+    DisplayFade(uint8_t level = 0);
+
+    void start(uint8_t to, uint32_t duration, uint32_t now);
+    uint8_t value(uint32_t now) const;
+    uint8_t target(void) const { return _to; }
+    bool isDone(uint32_t now) const { return now - _start >= _duration; }
+
+   private:
+    uint8_t _from;
+    uint8_t _to;
+    uint32_t _start;
+    uint32_t _duration;
+};
+
+class DisplayIntensity {
+   public:
+    DisplayIntensity();
+
+    void configure(uint8_t day, uint8_t night, uint8_t idle, uint8_t nightStart, uint8_t nightEnd, uint32_t idleTimeout, uint32_t blankTimeout, uint32_t fade);
+
+    void motion(bool detecting, uint32_t now);
+    void activity(uint32_t now);
+
+    void setScene(uint8_t level, uint32_t duration, uint32_t now);
+    bool isSceneDone(uint32_t now) const { return _scene.isDone(now); }
+
+    uint8_t update(uint32_t now, int8_t hour);
+    uint8_t getLevel(void) const { return _level; }
+    bool isIdle(uint32_t now) const;
+    bool isBlank(uint32_t now) const;
+
+    static bool tm1637(uint8_t level, uint8_t &brightness);
+    static uint8_t ws2812(uint8_t level) { return GAMMA[level]; }
+
+    static float tm1637Current(uint8_t level, uint8_t segments);
+    static float ws2812Current(uint8_t scale, uint16_t rgbSum, uint8_t pixels);
+
+   private:
+    uint8_t _target(uint32_t now, int8_t hour) const;
+
+    static const uint8_t GAMMA[256];
+    static const uint8_t TM1637_LIGHTNESS[DISPLAY_TM1637_LEVELS];
+    static const uint8_t TM1637_DUTY[DISPLAY_TM1637_LEVELS];
+
+    uint8_t _day;
+    uint8_t _night;
+    uint8_t _idle;
+    uint8_t _nightStart;
+    uint8_t _nightEnd;
+    uint32_t _idleTimeout;
+    uint32_t _blankTimeout;
+    uint32_t _fade;
+
+    bool _detecting;
+    uint32_t _lastActivity;
+
+    DisplayFade _ambient;
+    DisplayFade _scene;
+    uint8_t _level;
+};
@@ -0,0 +1,253 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <Gossip.h>
+#include <string.h>
+
+static void put16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, v & 0xFFFF);
+    put16(p + 2, v >> 16);
+}
+
+static uint16_t get16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static uint32_t get32(const uint8_t *p) { return get16(p) | (uint32_t)get16(p + 2) << 16; }
+
+static uint64_t get64(const uint8_t *p) { return get32(p) | (uint64_t)get32(p + 4) << 32; }
+
+Gossip::Gossip() {
+    memset(_key, 0, sizeof(_key));
+    begin(_key, 0, 30000);
+}
+
+void Gossip::begin(const uint8_t *key, uint32_t node, uint32_t timeout) {
+    memcpy(_key, key, sizeof(_key));
+    _node    = node;
+    _timeout = timeout;
+    _seq     = 0;
+    _count   = 0;
+    _evicted = 0;
+    memset(_results, 0, sizeof(_results));
+}
+
+// A signed frame of our sample, clock is the UNIX time.
+size_t Gossip::announce(const TelemetrySample_t &sample, uint8_t flags, uint32_t clock, uint8_t *buffer, size_t size) {
+    GossipFrame_t frame;
+
+    frame.node   = _node;
+    frame.sent   = clock;
+    frame.seq    = _seq++;
+    frame.flags  = flags;
+    frame.sample = sample;
+
+    return encode(frame, buffer, size);
+}
+
+Gossip::Result Gossip::receive(const uint8_t *buffer, size_t length, uint32_t clock, uint32_t now) {
+    GossipFrame_t frame;
+    Result result;
+
+    if (length != GOSSIP_FRAME || buffer[0] != GOSSIP_MAGIC || buffer[1] != GOSSIP_VERSION) {
+        result = kMalformed;
+    } else if (!decode(buffer, length, frame)) {
+        result = kForged;
+    } else if (frame.node == _node) {
+        result = kOwn;
+    } else {
+        result = accept(frame, clock, now);
+    }
+    _results[result]++;
+
+    return result;
+}
+
+Gossip::Result Gossip::accept(const GossipFrame_t &frame, uint32_t clock, uint32_t now) {
+    if (frame.sent < GOSSIP_VALID ||
+        (clock >= GOSSIP_VALID && (frame.sent + GOSSIP_SKEW < clock || clock + GOSSIP_SKEW < frame.sent))) {
+        return kReplayed;
+    }
+
+    GossipPeer_t *slot = nullptr;
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_peer[i].frame.node == frame.node) {
+            slot = &_peer[i];
+            break;
+        }
+    }
+
+    if (slot) {
+        const GossipFrame_t &last = slot->frame;
+        if (frame.sent < last.sent || (frame.sent == last.sent && (int16_t)(frame.seq - last.seq) <= 0)) {
+            return kReplayed;
+        }
+    } else {
+        evict(now);
+        if (_count == GOSSIP_PEERS) {
+            return kFull;
+        }
+        slot = &_peer[_count++];
+    }
+
+    slot->frame  = frame;
+    slot->seenAt = now;
+
+    return kAccepted;
+}
+
+// Drops the neighbours not heard for the timeout, the table stays packed.
+void Gossip::evict(uint32_t now) {
+    uint8_t kept = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        if (isLive(_peer[i], now)) {
+            _peer[kept++] = _peer[i];
+        } else {
+            _evicted++;
+        }
+    }
+    _count = kept;
+}
+
+// The node id of the uploader, 0 when no clock can be.
+uint32_t Gossip::leader(bool candidate, uint32_t now) const {
+    uint32_t leader = candidate ? _node : 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        const GossipPeer_t &p = _peer[i];
+        if ((p.frame.flags & kGossipCandidate) && isLive(p, now) && (leader == 0 || p.frame.node < leader)) {
+            leader = p.frame.node;
+        }
+    }
+
+    return leader;
+}
+
+size_t Gossip::encode(const GossipFrame_t &frame, uint8_t *buffer, size_t size) const {
+    if (size < GOSSIP_FRAME) {
+        return 0;
+    }
+
+    buffer[0] = GOSSIP_MAGIC;
+    buffer[1] = GOSSIP_VERSION;
+    buffer[2] = frame.flags;
+    buffer[3] = 0;
+    put32(&buffer[4], frame.node);
+    put32(&buffer[8], frame.sent);
+    put16(&buffer[12], frame.seq);
+    put32(&buffer[14], frame.sample.time);
+    put16(&buffer[18], (uint16_t)frame.sample.temperature);
+    put16(&buffer[20], frame.sample.humidity);
+    put32(&buffer[22], frame.sample.pressure);
+    put16(&buffer[26], frame.sample.motion);
+
+    uint64_t tag = siphash(_key, buffer, GOSSIP_FRAME - 8);
+    put32(&buffer[28], (uint32_t)tag);
+    put32(&buffer[32], (uint32_t)(tag >> 32));
+
+    return GOSSIP_FRAME;
+}
+
+// The tag is compared in constant time.
+bool Gossip::decode(const uint8_t *buffer, size_t length, GossipFrame_t &frame) const {
+    if (length != GOSSIP_FRAME) {
+        return false;
+    }
+
+    uint64_t diff = siphash(_key, buffer, GOSSIP_FRAME - 8) ^ get64(&buffer[28]);
+    if (diff != 0) {
+        return false;
+    }
+
+    frame.flags              = buffer[2];
+    frame.node               = get32(&buffer[4]);
+    frame.sent               = get32(&buffer[8]);
+    frame.seq                = get16(&buffer[12]);
+    frame.sample.time        = get32(&buffer[14]);
+    frame.sample.temperature = (int16_t)get16(&buffer[18]);
+    frame.sample.humidity    = get16(&buffer[20]);
+    frame.sample.pressure    = get32(&buffer[22]);
+    frame.sample.motion      = get16(&buffer[26]);
+
+    return true;
+}
+
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND                                                   \
+    do {                                                           \
+        v0 += v1;                                                  \
+        v1 = ROTL(v1, 13);                                         \
+        v1 ^= v0;                                                  \
+        v0 = ROTL(v0, 32);                                         \
+        v2 += v3;                                                  \
+        v3 = ROTL(v3, 16);                                         \
+        v3 ^= v2;                                                  \
+        v0 += v3;                                                  \
+        v3 = ROTL(v3, 21);                                         \
+        v3 ^= v0;                                                  \
+        v2 += v1;                                                  \
+        v1 = ROTL(v1, 17);                                         \
+        v1 ^= v2;                                                  \
+        v2 = ROTL(v2, 32);                                         \
+    } while (0)
+
+// SipHash-2-4 (Aumasson, Bernstein), a keyed hash made for short messages.
+uint64_t Gossip::siphash(const uint8_t *key, const uint8_t *data, size_t length) {
+    uint64_t k0 = get64(key);
+    uint64_t k1 = get64(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    size_t end  = length - length % 8;
+
+    for (size_t i = 0; i < end; i += 8) {
+        uint64_t m = get64(&data[i]);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t)length << 56;
+    for (size_t i = end; i < length; i++) {
+        b |= (uint64_t)data[i] << (8 * (i - end));
+    }
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xFF;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
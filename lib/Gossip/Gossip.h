@@ -0,0 +1,122 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <TelemetryCodec.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sensor gossip between the clocks of one LAN.
+//
+// Every clock multicasts its latest sample in a frame signed with the key
+// the fleet shares, and keeps the frames of its neighbours in a bounded
+// table. A neighbour that has not been heard for the timeout is evicted.
+// Of the clocks that can reach ThingSpeak (kGossipCandidate), the one with
+// the lowest node id uploads for everybody; when it goes quiet it is
+// evicted and the next one takes over.
+//
+// Frame, 36 bytes, little endian:
+//
+//   magic(0xC6) version(1) flags(1) reserved(1) node(4) sent(4) seq(2)
+//   time(4) temperature(2) humidity(2) pressure(4) motion(2)
+//   tag(8, SipHash-2-4 of the bytes before it)
+//
+// A frame must be newer (sent, then seq) than the last one of its node and,
+// when the receiver's clock is set, sent within GOSSIP_SKEW of it, so a
+// recorded frame cannot be played back later.
+// No Arduino dependency, the caller does the I/O and the locking.
+
+#define GOSSIP_MAGIC   0xC6
+#define GOSSIP_VERSION 1
+#define GOSSIP_FRAME   36
+#define GOSSIP_KEY     16   // [bytes]
+#define GOSSIP_PEERS   16
+#define GOSSIP_SKEW    120  // [s]
+#define GOSSIP_VALID   1600000000
+
+enum : uint8_t {
+    kGossipCandidate = 0x01,  // reaches ThingSpeak, may be the uploader
+    kGossipValid     = 0x02,  // the sample is a reading
+};
+
+typedef struct {
+    uint32_t node;
+    uint32_t sent;  // UNIX time [s]
+    uint16_t seq;
+    uint8_t flags;
+    TelemetrySample_t sample;
+} GossipFrame_t;
+
+typedef struct {
+    GossipFrame_t frame;
+    uint32_t seenAt;  // [ms]
+} GossipPeer_t;
+
+class Gossip {
+   public:
+    enum Result {
+        kAccepted = 0,
+        kMalformed,
+        kForged,
+        kReplayed,
+        kOwn,   // our own frame, looped back
+        kFull,  // no room for a new node
+        kResults,
+    };
+
+    Gossip();
+
+    void begin(const uint8_t *key, uint32_t node, uint32_t timeout);
+    void setTimeout(uint32_t timeout) { _timeout = timeout; }
+
+    size_t announce(const TelemetrySample_t &sample, uint8_t flags, uint32_t clock, uint8_t *buffer, size_t size);
+    Result receive(const uint8_t *buffer, size_t length, uint32_t clock, uint32_t now);
+    void evict(uint32_t now);
+
+    uint32_t leader(bool candidate, uint32_t now) const;
+    uint32_t getNode(void) const { return _node; }
+    uint8_t count(void) const { return _count; }
+    const GossipPeer_t &peer(uint8_t index) const { return _peer[index]; }
+    uint32_t getCount(Result result) const { return _results[result]; }
+    uint32_t getEvicted(void) const { return _evicted; }
+
+    size_t encode(const GossipFrame_t &frame, uint8_t *buffer, size_t size) const;
+    bool decode(const uint8_t *buffer, size_t length, GossipFrame_t &frame) const;
+    static uint64_t siphash(const uint8_t *key, const uint8_t *data, size_t length);
+
+   private:
+    Result accept(const GossipFrame_t &frame, uint32_t clock, uint32_t now);
+    bool isLive(const GossipPeer_t &peer, uint32_t now) const { return now - peer.seenAt <= _timeout; }
+
+    uint8_t _key[GOSSIP_KEY];
+    uint32_t _node;
+    uint32_t _timeout;  // [ms]
+    uint16_t _seq;
+
+    GossipPeer_t _peer[GOSSIP_PEERS];
+    uint8_t _count;
+    uint32_t _results[kResults];
+    uint32_t _evicted;
+};
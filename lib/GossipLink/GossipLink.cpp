@@ -0,0 +1,127 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <ESPmDNS.h>
+#include <GossipLink.h>
+#include <esp32-hal-log.h>
+
+GossipLink::GossipLink() : _mutex(NULL), _port(GOSSIP_PORT), _sent(0), _running(false) {}
+
+// Needs the station address and a running MDNS responder.
+bool GossipLink::begin(const uint8_t *key, uint32_t node, uint32_t timeout) {
+    if (_running) {
+        return true;
+    }
+
+    if (_mutex == NULL) {
+        _mutex = xSemaphoreCreateMutex();
+    }
+    _gossip.begin(key, node, timeout);
+
+    int found = MDNS.queryService(GOSSIP_SERVICE, "udp");
+    if (found > 0 && MDNS.port(0) != 0) {
+        _port = MDNS.port(0);
+    }
+    log_i("gossip: %d clocks found, node %08x on port %u", found < 0 ? 0 : found, node, _port);
+
+    if (!_udp.listenMulticast(GOSSIP_GROUP, _port)) {
+        log_e("gossip: cannot join the multicast group");
+        return false;
+    }
+    _udp.onPacket([this](AsyncUDPPacket &packet) { received(packet); });
+    MDNS.addService(GOSSIP_SERVICE, "udp", _port);
+
+    _running = true;
+
+    return true;
+}
+
+void GossipLink::setTimeout(uint32_t timeout) {
+    if (!_running) {
+        return;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _gossip.setTimeout(timeout);
+    xSemaphoreGive(_mutex);
+}
+
+bool GossipLink::announce(const TelemetrySample_t &sample, uint8_t flags) {
+    uint8_t frame[GOSSIP_FRAME];
+
+    if (!_running) {
+        return false;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    size_t length = _gossip.announce(sample, flags, time(NULL), frame, sizeof(frame));
+    xSemaphoreGive(_mutex);
+
+    if (_udp.writeTo(frame, length, GOSSIP_GROUP, _port) != length) {
+        return false;
+    }
+    _sent++;
+
+    return true;
+}
+
+uint32_t GossipLink::leader(bool candidate) {
+    if (!_running) {
+        return 0;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    uint32_t node = _gossip.leader(candidate, millis());
+    xSemaphoreGive(_mutex);
+
+    return node;
+}
+
+// A copy of the live neighbours, so nothing is held during an upload.
+uint8_t GossipLink::peers(GossipPeer_t *peers, uint8_t capacity) {
+    if (!_running) {
+        return 0;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _gossip.evict(millis());
+    uint8_t count = min(_gossip.count(), capacity);
+    for (uint8_t i = 0; i < count; i++) {
+        peers[i] = _gossip.peer(i);
+    }
+    xSemaphoreGive(_mutex);
+
+    return count;
+}
+
+// AsyncUDP task
+void GossipLink::received(AsyncUDPPacket &packet) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Gossip::Result result = _gossip.receive(packet.data(), packet.length(), time(NULL), millis());
+    xSemaphoreGive(_mutex);
+
+    if (result != Gossip::kAccepted && result != Gossip::kOwn) {
+        log_d("gossip: frame from %s dropped (%d)", packet.remoteIP().toString().c_str(), result);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <Gossip.h>
+
+// Gossip over UDP multicast on the station interface. Frames are taken in
+// by the AsyncUDP task, the table is shared with loop() under a mutex.
+// The port is advertised over mDNS next to the web server, and a clock
+// that finds a neighbour on another port joins it there.
+
+#define GOSSIP_GROUP   IPAddress(239, 255, 42, 42)
+#define GOSSIP_PORT    4242
+#define GOSSIP_SERVICE "clock-gossip"
+
+class GossipLink {
+   public:
+    GossipLink();
+
+    bool begin(const uint8_t *key, uint32_t node, uint32_t timeout);
+    bool isRunning(void) const { return _running; }
+    void setTimeout(uint32_t timeout);
+
+    bool announce(const TelemetrySample_t &sample, uint8_t flags);
+    uint32_t leader(bool candidate);
+    uint8_t peers(GossipPeer_t *peers, uint8_t capacity);
+
+    uint32_t getNode(void) const { return _gossip.getNode(); }
+    uint16_t getPort(void) const { return _port; }
+    uint32_t getSent(void) const { return _sent; }
+    uint32_t getCount(Gossip::Result result) const { return _gossip.getCount(result); }
+    uint32_t getEvicted(void) const { return _gossip.getEvicted(); }
+
+   private:
+    void received(AsyncUDPPacket &packet);
+
+    AsyncUDP _udp;
+    Gossip _gossip;
+    SemaphoreHandle_t _mutex;
+    uint16_t _port;
+    uint32_t _sent;
+    bool _running;
+};
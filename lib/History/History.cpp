@@ -0,0 +1,155 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <History.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *CONTENT_TYPE[] = {"text/csv", "application/json", "application/octet-stream"};
+static const char *NAME[]         = {"csv", "json", "bin"};
+
+History::History() { clear(); }
+
+void History::clear(void) {
+    _head  = 0;
+    _count = 0;
+}
+
+bool History::append(const TelemetrySample_t &sample) {
+    if (_count && sample.time <= get(_count - 1).time) {
+        return false;
+    }
+
+    _ring[_head] = sample;
+    _head        = (_head + 1) % HISTORY_DEPTH;
+    if (_count < HISTORY_DEPTH) {
+        _count++;
+    }
+
+    return true;
+}
+
+const TelemetrySample_t &History::get(uint16_t index) const {
+    return _ring[(_head + HISTORY_DEPTH - _count + index) % HISTORY_DEPTH];
+}
+
+uint16_t History::lowerBound(uint32_t time) const {
+    uint16_t lower = 0;
+    uint16_t upper = _count;
+
+    while (lower < upper) {
+        uint16_t middle = lower + (upper - lower) / 2;
+        if (get(middle).time < time) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
+    }
+
+    return lower;
+}
+
+HistoryExport::HistoryExport(const History &history, Format format, uint32_t from, uint32_t to)
+    : _history(history), _format(format), _next(from), _to(to), _records(0), _started(false), _done(false) {}
+
+bool HistoryExport::parse(const char *name, Format &format) {
+    for (uint8_t f = kCsv; f <= kBin; f++) {
+        if (strcmp(name, NAME[f]) == 0) {
+            format = static_cast<Format>(f);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char *HistoryExport::contentType(Format format) { return CONTENT_TYPE[format]; }
+
+// The next batch, 0 at the end. The buffer takes at least one record,
+// HISTORY_RECORD bytes.
+size_t HistoryExport::next(uint8_t *buffer, size_t size) {
+    char *text = (char *)buffer;
+    size_t n   = 0;
+
+    if (_done) {
+        return 0;
+    }
+    if (!_started) {
+        _started = true;
+        if (_format == kCsv) {
+            n = snprintf(text, size, "time,temperature,humidity,pressure,motion\n");
+        } else if (_format == kJson) {
+            text[n++] = '[';
+        }
+    }
+
+    uint16_t i = _history.lowerBound(_next);
+    if (_format == kBin) {
+        TelemetrySample_t batch[HISTORY_FRAME];
+        uint8_t count = 0;
+        while (i < _history.count() && _history.get(i).time <= _to && count < HISTORY_FRAME &&
+               TelemetryCodec::maxFrameSize(count + 1) <= size) {
+            batch[count++] = _history.get(i++);
+        }
+        if (count) {
+            n        = TelemetryCodec::encode(batch, count, buffer, size);
+            _next    = batch[count - 1].time + 1;
+            _records += count;
+        }
+    } else {
+        while (i < _history.count() && _history.get(i).time <= _to && n + HISTORY_RECORD + 1 <= size) {
+            const TelemetrySample_t &s = _history.get(i++);
+            n += _text(s, &text[n], size - n);
+            _next = s.time + 1;
+            _records++;
+        }
+    }
+
+    if (i == _history.count() || _to < _history.get(i).time) {
+        _done = true;
+        if (_format == kJson) {
+            text[n++] = ']';
+        }
+    }
+
+    return n;
+}
+
+// Hundredths as fixed point, printf of a float costs more than the record.
+size_t HistoryExport::_text(const TelemetrySample_t &s, char *buffer, size_t size) {
+    const char *sign = s.temperature < 0 ? "-" : "";
+    int32_t t        = s.temperature < 0 ? -s.temperature : s.temperature;
+    int n;
+
+    if (_format == kCsv) {
+        n = snprintf(buffer, size, "%u,%s%d.%02d,%u.%02u,%u.%02u,%u\n", s.time, sign, t / 100, t % 100,
+                     s.humidity / 100, s.humidity % 100, s.pressure / 100, s.pressure % 100, s.motion);
+    } else {
+        n = snprintf(buffer, size, "%s{\"t\":%u,\"temp\":%s%d.%02d,\"humid\":%u.%02u,\"press\":%u.%02u,\"occ\":%u}",
+                     _records ? "," : "", s.time, sign, t / 100, t % 100,
+                     s.humidity / 100, s.humidity % 100, s.pressure / 100, s.pressure % 100, s.motion);
+    }
+
+    return n < 0 ? 0 : (size_t)n;
+}
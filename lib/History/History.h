@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <TelemetryCodec.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Recent 1-minute samples in RAM, for export over the LAN.
+//
+// A ring of fixed-size records in time order; a sample not newer than the
+// last one is not taken, so a range is found by binary search. The
+// exporter formats a range as CSV, JSON or TelemetryCodec frames, one
+// batch of whole records per call into the caller's buffer. It keeps the
+// time it got to instead of an index, so the ring may move on between
+// calls and the caller only locks around each one.
+// No Arduino dependency.
+
+#define HISTORY_DEPTH  1440  // 24 hours of minutes
+#define HISTORY_RECORD 96    // [bytes] longest text record
+#define HISTORY_FRAME  16    // records per binary frame
+
+class History {
+   public:
+    History();
+
+    bool append(const TelemetrySample_t &sample);
+    void clear(void);
+
+    uint16_t count(void) const { return _count; }
+    const TelemetrySample_t &get(uint16_t index) const;  // 0 is the oldest
+    uint16_t lowerBound(uint32_t time) const;           // first at or after time
+
+   private:
+    TelemetrySample_t _ring[HISTORY_DEPTH];
+    uint16_t _head;  // next to write
+    uint16_t _count;
+};
+
+class HistoryExport {
+   public:
+    enum Format : uint8_t {
+        kCsv = 0,
+        kJson,
+        kBin,
+    };
+
+    HistoryExport(const History &history, Format format, uint32_t from, uint32_t to);
+
+    size_t next(uint8_t *buffer, size_t size);
+    uint32_t getRecords(void) const { return _records; }
+
+    static bool parse(const char *name, Format &format);
+    static const char *contentType(Format format);
+
+   private:
+    size_t _text(const TelemetrySample_t &sample, char *buffer, size_t size);
+
+    const History &_history;
+    Format _format;
+    uint32_t _next;  // time of the next record
+    uint32_t _to;
+    uint32_t _records;
+    bool _started;
+    bool _done;
+};
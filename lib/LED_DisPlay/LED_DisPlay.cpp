@@ -1,9 +1,12 @@
 #include <LED_DisPlay.h>
+#include <Trace.h>
 
 LED_DisPlay::LED_DisPlay() {
 }
 
 LED_DisPlay::~LED_DisPlay() {
+    requestStop();
+    join();
 }
 
 void LED_DisPlay::begin(uint8_t LEDNumbre) {
@@ -21,9 +24,10 @@ void LED_DisPlay::run(void *data) {
     FastLED.show();
     FastLED.setBrightness(20);
 
-    while (1) {
+    while (!isStopRequested()) {
         xSemaphoreTake(_xSemaphore, portMAX_DELAY);
         if (_mode == kAnmiation_run) {
+            TRACE_SCOPE("led_frame");  // with its wait, under _xSemaphore
             if ((_am_mode & kMoveRight) || (_am_mode & kMoveLeft)) {
                 if (_am_mode & kMoveRight) {
                     _count_x++;
@@ -46,33 +50,18 @@ void LED_DisPlay::run(void *data) {
             }
             _displaybuff(_am_buffptr, _count_x, _count_y);
             FastLED.show();
-            delay(_am_speed);
+            wait(_am_speed);
         } else if (_mode == kAnmiation_frush) {
             _mode = kAnmiation_stop;
             FastLED.show();
         }
         xSemaphoreGive(_xSemaphore);
-        delay(10);
+        wait(10);
     }
 }
 
 void LED_DisPlay::_displaybuff(uint8_t *buffptr, int8_t offsetx, int8_t offsety) {
-    uint16_t xsize = 0, ysize = 0;
-    xsize = buffptr[0];
-    ysize = buffptr[1];
-
-    offsetx = offsetx % xsize;
-    offsety = offsety % ysize;
-
-    int8_t setdatax = (offsetx < 0) ? (-offsetx) : (xsize - offsetx);
-    int8_t setdatay = (offsety < 0) ? (-offsety) : (ysize - offsety);
-    for (int x = 0; x < 5; x++) {
-        for (int y = 0; y < 5; y++) {
-            _ledbuff[x + y * 5].raw[1] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 0];
-            _ledbuff[x + y * 5].raw[0] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 1];
-            _ledbuff[x + y * 5].raw[2] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 2];
-        }
-    }
+    LedMatrix::frame(buffptr, offsetx, offsety, _ledbuff[0].raw);
     FastLED.setBrightness(Brightness);
 }
 
@@ -91,38 +80,41 @@ void LED_DisPlay::animation(uint8_t *buffptr, uint8_t amspeed, uint8_t ammode, i
 }
 
 void LED_DisPlay::displaybuff(uint8_t *buffptr, int8_t offsetx, int8_t offsety) {
-    uint16_t xsize = 0, ysize = 0;
-    xsize = buffptr[0];
-    ysize = buffptr[1];
-
-    offsetx = offsetx % xsize;
-    offsety = offsety % ysize;
-
-    int8_t setdatax = (offsetx < 0) ? (-offsetx) : (xsize - offsetx);
-    int8_t setdatay = (offsety < 0) ? (-offsety) : (ysize - offsety);
     xSemaphoreTake(_xSemaphore, portMAX_DELAY);
-
-    for (int x = 0; x < 5; x++) {
-        for (int y = 0; y < 5; y++) {
-            _ledbuff[x + y * 5].raw[1] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 0];
-            _ledbuff[x + y * 5].raw[0] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 1];
-            _ledbuff[x + y * 5].raw[2] = buffptr[2 + ((setdatax + x) % xsize + ((setdatay + y) % ysize) * xsize) * 3 + 2];
-        }
-    }
-
+    LedMatrix::frame(buffptr, offsetx, offsety, _ledbuff[0].raw);
     _mode = kAnmiation_frush;
-
     xSemaphoreGive(_xSemaphore);
     FastLED.setBrightness(Brightness);
 }
 
+// brightness is in percent of what looks fully bright
 void LED_DisPlay::setBrightness(uint8_t brightness) {
     xSemaphoreTake(_xSemaphore, portMAX_DELAY);
     brightness = (brightness > 100) ? 100 : brightness;
-    brightness = (40 * brightness / 100);
+    _level     = 255 * brightness / 100;
+    _applyBrightness();
+    xSemaphoreGive(_xSemaphore);
+}
+
+// Auto dimming on top of setBrightness(), 0-255 perceptual
+void LED_DisPlay::setDimming(uint8_t level) {
+    xSemaphoreTake(_xSemaphore, portMAX_DELAY);
+    _dimming = level;
+    _applyBrightness();
+    xSemaphoreGive(_xSemaphore);
+}
+
+// The pixels keep their old brightness until the next show(), so a
+// change asks run() for one unless an animation shows every frame anyway.
+void LED_DisPlay::_applyBrightness(void) {
+    uint8_t level      = (uint16_t)_level * _dimming / 255;
+    uint8_t brightness = LED_MAX_BRIGHTNESS * DisplayIntensity::ws2812(level) / 255;
+
+    if (brightness != Brightness && _mode != kAnmiation_run) {
+        _mode = kAnmiation_frush;
+    }
     Brightness = brightness;
     FastLED.setBrightness(Brightness);
-    xSemaphoreGive(_xSemaphore);
 }
 
 void LED_DisPlay::drawpix(uint8_t xpos, uint8_t ypos, CRGB Color) {
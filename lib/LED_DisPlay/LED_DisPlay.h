@@ -1,7 +1,9 @@
 #ifndef _LED_DISPLAY_H_
 #define _LED_DISPLAY_H_
 
+#include <DisplayIntensity.h>
 #include <FastLED.h>
+#include <LedMatrix.h>
 #include <Task.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -9,6 +11,8 @@
 #define NUM_LEDS 25
 #define DATA_PIN 27
 
+#define LED_MAX_BRIGHTNESS 40  // FastLED scale at 100 %
+
 class LED_DisPlay : public Task {
    private:
     CRGB _ledbuff[NUM_LEDS];
@@ -23,6 +27,9 @@ class LED_DisPlay : public Task {
 
     SemaphoreHandle_t _xSemaphore = NULL;
 
+    uint8_t _level   = 255;  // perceptual, from setBrightness()
+    uint8_t _dimming = 255;  // perceptual, from setDimming()
+
    public:
     enum {
         kStatic = 0,
@@ -52,6 +59,7 @@ class LED_DisPlay : public Task {
     void MoveDisPlayBuff(int8_t offsetx = 0, int8_t offsety = 0);
 
     void setBrightness(uint8_t brightness);
+    void setDimming(uint8_t level);
     void drawpix(uint8_t xpos, uint8_t ypos, CRGB Color);
     void drawpix(uint8_t Number, CRGB Color);
     void fillpix(CRGB Color);
@@ -59,6 +67,7 @@ class LED_DisPlay : public Task {
 
    private:
     void _displaybuff(uint8_t *buffptr, int8_t offsetx = 0, int8_t offsety = 0);
+    void _applyBrightness(void);
 };
 
 #endif
@@ -0,0 +1,73 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <LatencyHistogram.h>
+
+LatencyHistogram::LatencyHistogram() { clear(); }
+
+void LatencyHistogram::clear(void) {
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        _bucket[i] = 0;
+    }
+    _count = 0;
+    _sum   = 0;
+    _max   = 0;
+}
+
+void LatencyHistogram::record(uint32_t us, uint32_t times) {
+    uint8_t index = (us < 2) ? 0 : 31 - __builtin_clz(us);
+    if (LATENCY_BUCKETS - 1 < index) {
+        index = LATENCY_BUCKETS - 1;
+    }
+
+    _bucket[index] += times;
+    _count += times;
+    _sum += (uint64_t)us * times;
+    if (_max < us) {
+        _max = us;
+    }
+}
+
+// UINT32_MAX stands for +Inf
+uint32_t LatencyHistogram::upper(uint8_t index) {
+    return (index < LATENCY_BUCKETS - 1) ? (2UL << index) : UINT32_MAX;
+}
+
+// Returns the upper bound of the bucket holding the p-th percentile.
+uint32_t LatencyHistogram::percentile(float p) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    uint32_t rank = (uint32_t)(p / 100.0f * _count);
+    uint32_t sum  = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        sum += _bucket[i];
+        if (rank < sum) {
+            return upper(i);
+        }
+    }
+
+    return _max;
+}
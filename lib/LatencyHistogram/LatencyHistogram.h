@@ -0,0 +1,56 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Log2 bucketed latency histogram.
+// Bucket i counts durations below 2^(i+1) us, the last bucket is +Inf.
+// record() is O(1) and the whole histogram is a fixed array.
+
+#define LATENCY_BUCKETS 21  // 2us .. 1.05s, +Inf
+
+class LatencyHistogram {
+   public:
+    LatencyHistogram();
+
+    void record(uint32_t us, uint32_t times = 1);
+    void clear(void);
+
+    uint32_t getCount(void) const { return _count; }
+    uint64_t getSum(void) const { return _sum; }
+    uint32_t getMax(void) const { return _max; }
+    uint32_t getBucket(uint8_t index) const { return _bucket[index]; }
+
+    uint32_t percentile(float p) const;
+
+    static uint32_t upper(uint8_t index);
+
+   private:
+    uint32_t _bucket[LATENCY_BUCKETS];
+    uint32_t _count;
+    uint64_t _sum;
+    uint32_t _max;
+};
@@ -0,0 +1,51 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <LedMatrix.h>
+
+void LedMatrix::frame(const uint8_t *image, int8_t offsetx, int8_t offsety, uint8_t *rgb) {
+    uint16_t xsize = image[0];
+    uint16_t ysize = image[1];
+    uint16_t column[LED_MATRIX_SIZE];
+
+    offsetx = offsetx % xsize;
+    offsety = offsety % ysize;
+
+    int8_t setdatax = (offsetx < 0) ? (-offsetx) : (xsize - offsetx);
+    int8_t setdatay = (offsety < 0) ? (-offsety) : (ysize - offsety);
+    for (int x = 0; x < LED_MATRIX_SIZE; x++) {
+        column[x] = ((setdatax + x) % xsize) * 3;
+    }
+
+    for (int y = 0; y < LED_MATRIX_SIZE; y++) {
+        const uint8_t *row = &image[2 + ((setdatay + y) % ysize) * xsize * 3];
+        for (int x = 0; x < LED_MATRIX_SIZE; x++) {
+            const uint8_t *grb = &row[column[x]];
+            rgb[0]             = grb[1];
+            rgb[1]             = grb[0];
+            rgb[2]             = grb[2];
+            rgb += 3;
+        }
+    }
+}
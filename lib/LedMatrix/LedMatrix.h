@@ -0,0 +1,43 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// The 5x5 LED matrix of the ATOM as a window on a larger image.
+//
+// An image is width, height, then one GRB triple per pixel row by row.
+// frame() copies the window at an offset into RGB triples in the order of
+// the LEDs, the image repeats beyond its edges. The column of every LED
+// is worked out once per frame instead of once per byte.
+// No Arduino dependency.
+
+#define LED_MATRIX_SIZE   5
+#define LED_MATRIX_PIXELS (LED_MATRIX_SIZE * LED_MATRIX_SIZE)
+
+class LedMatrix {
+   public:
+    static void frame(const uint8_t *image, int8_t offsetx, int8_t offsety, uint8_t *rgb);
+};
@@ -0,0 +1,63 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <LogDrain.h>
+
+LogDrain::LogDrain(DeferredLog &log, Print &out) : Task("LOG_DRAIN", 3072, 1), _log(log), _out(out) {
+    for (uint8_t c = 0; c < DEFERRED_LOG_CORES; c++) {
+        _cursor[c] = 0;
+    }
+    _lines = 0;
+}
+
+LogDrain::~LogDrain() {
+    requestStop();
+    join();
+}
+
+void LogDrain::run(void *data) {
+    data = nullptr;
+
+    LogRecord_t record;
+    char line[LOG_DRAIN_LINE];
+
+    while (!isStopRequested()) {
+        while (_log.read(_cursor, record)) {
+            print(record, line, sizeof(line));
+            _out.println(line);
+            _lines++;
+        }
+        wait(LOG_DRAIN_PERIOD);
+    }
+}
+
+// The log_x() layout, with the time of the record: "[   12.345678][D][c1] ..."
+size_t LogDrain::print(const LogRecord_t &record, char *buffer, size_t size) {
+    int n = snprintf(buffer, size, "[%5u.%06u][%c][c%u] ", record.time / 1000000, record.time % 1000000, record.level, record.core);
+    if (n < 0 || (size_t)n >= size) {
+        return size - 1;
+    }
+
+    return n + DeferredLog::format(record, &buffer[n], size - n);
+}
@@ -0,0 +1,52 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <DeferredLog.h>
+#include <Task.h>
+
+// Prints the DeferredLog records to a stream from a low priority task,
+// in time order across the cores.
+
+#define LOG_DRAIN_PERIOD 100  // [ms]
+#define LOG_DRAIN_LINE   160  // [bytes] longer lines are cut
+
+class LogDrain : public Task {
+   public:
+    LogDrain(DeferredLog &log, Print &out);
+    ~LogDrain();
+
+    void run(void *data);
+    uint32_t getLines(void) const { return _lines; }
+
+    static size_t print(const LogRecord_t &record, char *buffer, size_t size);
+
+   private:
+    DeferredLog &_log;
+    Print &_out;
+    DeferredLog::Cursor _cursor[DEFERRED_LOG_CORES];
+    uint32_t _lines;
+};
@@ -0,0 +1,53 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <MotionInput.h>
+
+MotionInput::MotionInput() {
+    _head     = 0;
+    _overruns = 0;
+    _level    = false;
+}
+
+// Returns the next edge after cursor and advances it, false when there is none.
+bool MotionInput::read(Cursor &cursor, MotionEdge_t &edge) {
+    while (true) {
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (cursor == head) {
+            return false;
+        }
+        if (head - cursor > MOTION_INPUT_EDGES) {
+            _overruns.fetch_add(head - cursor - MOTION_INPUT_EDGES, std::memory_order_relaxed);
+            cursor = head - MOTION_INPUT_EDGES;
+        }
+
+        edge = _ring[cursor & (MOTION_INPUT_EDGES - 1)];
+
+        // The slot may have been written again while it was copied.
+        if (_head.load(std::memory_order_acquire) - cursor <= MOTION_INPUT_EDGES) {
+            cursor++;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// PIR edges from the GPIO interrupt, with the time the interrupt saw them.
+//
+// The ISR is the only writer. Every consumer keeps its own cursor and reads
+// the same edges at its own pace, so the render clock can wake the display
+// while loop() is still busy with an upload and does the accounting later.
+// A consumer more than MOTION_INPUT_EDGES behind loses the oldest edges,
+// which is counted.
+// No Arduino dependency; edge() is inline so that it lands in the caller's
+// IRAM_ATTR handler.
+
+#define MOTION_INPUT_EDGES 16  // power of two
+
+typedef struct {
+    uint64_t time;  // [us] esp_timer_get_time() in the ISR
+    bool level;
+} MotionEdge_t;
+
+class MotionInput {
+   public:
+    typedef uint32_t Cursor;
+
+    MotionInput();
+
+    // Producer, the same level twice (contact bounce around the ISR) is one edge.
+    void edge(bool level, uint64_t time) {
+        if (level == _level) {
+            return;
+        }
+        _level = level;
+
+        uint32_t head      = _head.load(std::memory_order_relaxed);
+        MotionEdge_t &slot = _ring[head & (MOTION_INPUT_EDGES - 1)];
+        slot.time          = time;
+        slot.level         = level;
+        _head.store(head + 1, std::memory_order_release);
+    }
+
+    bool read(Cursor &cursor, MotionEdge_t &edge);
+    bool getLevel(void) const { return _level; }
+    uint32_t getEdges(void) const { return _head.load(std::memory_order_acquire); }
+    uint32_t getOverruns(void) const { return _overruns.load(std::memory_order_relaxed); }
+
+   private:
+    MotionEdge_t _ring[MOTION_INPUT_EDGES];
+    std::atomic<uint32_t> _head;
+    std::atomic<uint32_t> _overruns;
+    volatile bool _level;
+};
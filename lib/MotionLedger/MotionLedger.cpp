@@ -0,0 +1,133 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <MotionLedger.h>
+
+MotionLedger::MotionLedger() { begin(0, 0); }
+
+void MotionLedger::begin(uint32_t seq, uint64_t now) {
+    _head            = 0;
+    _count           = 0;
+    _seq             = seq;
+    _detecting       = false;
+    _detectedAt      = 0;
+    _intervalStart   = now;
+    _accumulated     = 0;
+    _total           = 0;
+    _acknowledged    = 0;
+    _retransmissions = 0;
+}
+
+void MotionLedger::detected(uint64_t now) {
+    if (_detecting) {
+        return;
+    }
+    _detecting  = true;
+    _detectedAt = now;
+}
+
+void MotionLedger::released(uint64_t now) {
+    if (!_detecting) {
+        return;
+    }
+    _accumulated += now - _detectedAt;
+    _detecting = false;
+}
+
+// Moves the time accumulated since the last cut into a report.
+// Returns true when a report is waiting to be sent.
+bool MotionLedger::cut(uint64_t now) {
+    if (_detecting) {
+        _accumulated += now - _detectedAt;
+        _detectedAt = now;  // the rest of this presence goes to the next interval
+    }
+
+    if (_accumulated != 0) {
+        if (_count != 0 && (_at(_count - 1).attempts == 0 || _count == MOTION_LEDGER_DEPTH)) {
+            MotionReport_t &tail = _at(_count - 1);
+            tail.end             = now;
+            tail.occupied += _accumulated;
+        } else {
+            MotionReport_t &report = _at(_count++);
+            report.seq             = _seq++;
+            report.start           = _intervalStart;
+            report.end             = now;
+            report.occupied        = _accumulated;
+            report.attempts        = 0;
+        }
+        _total += _accumulated;
+        _accumulated   = 0;
+        _intervalStart = now;
+    }
+
+    return _count != 0;
+}
+
+// The oldest report not acknowledged yet.
+bool MotionLedger::peek(MotionReport_t &report) const {
+    if (_count == 0) {
+        return false;
+    }
+    report = _at(0);
+
+    return true;
+}
+
+void MotionLedger::sent(uint32_t seq, bool acknowledged) {
+    if (_count == 0 || _at(0).seq != seq) {
+        return;
+    }
+
+    MotionReport_t &head = _at(0);
+    if (head.attempts != 0) {
+        _retransmissions++;
+    }
+    head.attempts++;
+
+    if (acknowledged) {
+        _acknowledged += head.occupied;
+        _head = (_head + 1) % MOTION_LEDGER_DEPTH;
+        _count--;
+    }
+}
+
+bool MotionLedger::hasPending(void) const {
+    return _count != 0 || _accumulated != 0 || _detecting;
+}
+
+// Everything recorded so far, including a presence in progress.
+uint64_t MotionLedger::getTotal(uint64_t now) const {
+    return _total + _accumulated + (_detecting ? now - _detectedAt : 0);
+}
+
+// Occupancy time in the reports cut but not acknowledged yet.
+uint64_t MotionLedger::getQueued(void) const {
+    uint64_t queued = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        queued += _at(i).occupied;
+    }
+
+    return queued;
+}
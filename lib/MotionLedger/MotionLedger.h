@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Occupancy time accounting with acknowledged reports.
+//
+// PIR presence is accumulated in 64-bit microseconds. cut() closes the
+// accumulated time (including a presence still in progress) into a report
+// with a sequence number. Reports stay queued until the sink acknowledges
+// them. A failed report is retransmitted unchanged with the same sequence
+// number, so the sink can drop duplicates. Time cut while the newest report
+// has never been sent is merged into it, so the queue stays short however
+// long the sink is unreachable, and no time is ever dropped.
+
+#define MOTION_LEDGER_DEPTH 8
+
+typedef struct {
+    uint32_t seq;
+    uint64_t start;     // [us] monotonic clock
+    uint64_t end;       // [us]
+    uint64_t occupied;  // [us]
+    uint16_t attempts;
+} MotionReport_t;
+
+class MotionLedger {
+   public:
+    MotionLedger();
+
+    void begin(uint32_t seq, uint64_t now);
+
+    void detected(uint64_t now);
+    void released(uint64_t now);
+    bool isDetecting(void) const { return _detecting; }
+
+    bool cut(uint64_t now);
+    bool peek(MotionReport_t &report) const;
+    void sent(uint32_t seq, bool acknowledged);
+
+    bool hasPending(void) const;
+
+    uint64_t getTotal(uint64_t now) const;
+    uint64_t getAcknowledged(void) const { return _acknowledged; }
+    uint64_t getQueued(void) const;
+    uint32_t getRetransmissions(void) const { return _retransmissions; }
+    uint8_t getDepth(void) const { return _count; }
+
+   private:
+    MotionReport_t &_at(uint8_t index) { return _report[(_head + index) % MOTION_LEDGER_DEPTH]; }
+    const MotionReport_t &_at(uint8_t index) const { return _report[(_head + index) % MOTION_LEDGER_DEPTH]; }
+
+    MotionReport_t _report[MOTION_LEDGER_DEPTH];
+    uint8_t _head;
+    uint8_t _count;
+    uint32_t _seq;
+
+    bool _detecting;
+    uint64_t _detectedAt;
+    uint64_t _intervalStart;
+    uint64_t _accumulated;  // [us] not cut yet
+
+    uint64_t _total;  // [us] cut into reports
+    uint64_t _acknowledged;
+    uint32_t _retransmissions;
+};
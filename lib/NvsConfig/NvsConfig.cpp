@@ -0,0 +1,63 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <NvsConfig.h>
+
+NvsConfig::NvsConfig(const char *name) {
+    _name = name;
+    _open = false;
+}
+
+NvsConfig::~NvsConfig() {
+    if (_open) {
+        _prefs.end();
+    }
+}
+
+bool NvsConfig::begin(void) {
+    if (!_open) {
+        _open = _prefs.begin(_name, false);
+    }
+
+    return _open;
+}
+
+// Preferences of this core has no isKey(), a missing key returns the
+// default given to getInt(). No value can match two different defaults.
+bool NvsConfig::read(const char *name, int32_t &value) {
+    if (!_open) {
+        return false;
+    }
+
+    value = _prefs.getInt(name, INT32_MIN);
+    if (value == INT32_MIN && _prefs.getInt(name, INT32_MAX) != INT32_MIN) {
+        return false;
+    }
+
+    return true;
+}
+
+bool NvsConfig::write(const char *name, int32_t value) {
+    return _open && _prefs.putInt(name, value) == sizeof(value);
+}
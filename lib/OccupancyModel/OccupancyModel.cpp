@@ -0,0 +1,167 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <OccupancyModel.h>
+#include <string.h>
+
+OccupancyModel::OccupancyModel() {
+    _expected = OCCUPANCY_EXPECTED;
+    _idle     = OCCUPANCY_IDLE;
+
+    clear();
+}
+
+void OccupancyModel::configure(uint16_t expected, uint16_t idle) {
+    _expected = expected;
+    _idle     = idle;
+}
+
+void OccupancyModel::clear(void) {
+    memset(_level, 0, sizeof(_level));
+    memset(_weeks, 0, sizeof(_weeks));
+    _hours     = 0;
+    _start     = 0;
+    _whole     = false;
+    _started   = false;
+    _minutes   = 0;
+    _detecting = false;
+    _since     = 0;
+}
+
+uint32_t OccupancyModel::weekTime(uint8_t wday, uint8_t hour, uint8_t minute, uint8_t second) {
+    return ((wday * 24 + hour) * 60 + minute) * 60 + second;
+}
+
+// Call at least once a minute with the clock.
+void OccupancyModel::update(uint32_t week) {
+    week %= OCCUPANCY_WEEK;
+    uint32_t start = week - week % 3600;
+
+    if (_started && start == _start) {
+        return;
+    }
+
+    if (_started) {
+        if (_detecting) {
+            mark(_since, _start + 3599);
+        }
+        // Only the hour right after a whole one is a proper successor.
+        if (_whole && start == (_start + 3600) % OCCUPANCY_WEEK && week - start < 60) {
+            fold();
+        }
+    }
+
+    _started = true;
+    _start   = start;
+    _whole   = week - start < 60;
+    _minutes = 0;
+    _since   = week;
+}
+
+void OccupancyModel::presence(bool detecting, uint32_t week) {
+    update(week);
+    week %= OCCUPANCY_WEEK;
+
+    if (detecting && !_detecting) {
+        _since = week;
+        mark(week, week);
+    } else if (!detecting && _detecting) {
+        mark(_since, week);
+    }
+    _detecting = detecting;
+}
+
+bool OccupancyModel::isExpected(uint8_t slot) const {
+    return _weeks[slot] != 0 && _level[slot] >= _expected;
+}
+
+// Nothing is held back for an hour the model knows nothing about.
+bool OccupancyModel::isIdle(uint8_t slot) const {
+    return _weeks[slot] == 0 || _level[slot] < _idle;
+}
+
+// magic(2) version(1) decay(1) level[168] (little endian) weeks[168]
+size_t OccupancyModel::save(uint8_t *buffer, size_t size) const {
+    if (size < OCCUPANCY_BLOB) {
+        return 0;
+    }
+
+    size_t pos    = 0;
+    buffer[pos++] = OCCUPANCY_MAGIC & 0xFF;
+    buffer[pos++] = OCCUPANCY_MAGIC >> 8;
+    buffer[pos++] = OCCUPANCY_VERSION;
+    buffer[pos++] = OCCUPANCY_DECAY;
+    for (uint8_t s = 0; s < OCCUPANCY_SLOTS; s++) {
+        buffer[pos++] = _level[s] & 0xFF;
+        buffer[pos++] = _level[s] >> 8;
+    }
+    memcpy(&buffer[pos], _weeks, sizeof(_weeks));
+
+    return pos + sizeof(_weeks);
+}
+
+bool OccupancyModel::load(const uint8_t *buffer, size_t size) {
+    if (size != OCCUPANCY_BLOB || (buffer[0] | buffer[1] << 8) != OCCUPANCY_MAGIC ||
+        buffer[2] != OCCUPANCY_VERSION || buffer[3] != OCCUPANCY_DECAY) {
+        return false;
+    }
+
+    size_t pos = 4;
+    for (uint8_t s = 0; s < OCCUPANCY_SLOTS; s++, pos += 2) {
+        _level[s] = buffer[pos] | buffer[pos + 1] << 8;
+    }
+    memcpy(_weeks, &buffer[pos], sizeof(_weeks));
+
+    return true;
+}
+
+// Minutes of the current hour from..to, both inclusive.
+void OccupancyModel::mark(uint32_t from, uint32_t to) {
+    if (from < _start) {
+        from = _start;
+    }
+    if (to < from || _start + 3600 <= from) {
+        return;
+    }
+
+    uint8_t first = (from - _start) / 60;
+    uint8_t last  = (to - _start) / 60;
+    if (59 < last) {
+        last = 59;
+    }
+    uint64_t bits = (1ULL << (last - first + 1)) - 1;  // 60 bits at most
+
+    _minutes |= bits << first;
+}
+
+void OccupancyModel::fold(void) {
+    uint8_t slot  = _start / 3600;
+    int32_t share = __builtin_popcountll(_minutes) * 65535 / 60;
+
+    if (_weeks[slot] < (1 << OCCUPANCY_DECAY)) {
+        _weeks[slot]++;
+    }
+    _level[slot] = _level[slot] + (share - _level[slot]) / _weeks[slot];
+    _hours++;
+}
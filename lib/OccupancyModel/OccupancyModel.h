@@ -0,0 +1,93 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What a usual week looks like in front of the clock: one level per hour
+// of the week, the share of its minutes with somebody present.
+//
+// Presence edges mark the minutes of the current hour in a bitmap, so an
+// edge costs O(1) whatever its length. When the hour is over its share is
+// folded into the hour's level as an exponential average: every week
+// counts alike until a slot has 2^OCCUPANCY_DECAY of them, then a new week
+// weighs 1/2^OCCUPANCY_DECAY. An hour that was not seen from its first
+// minute to its end (boot, clock steps) is left out.
+//
+// A slot at or above the expected level is an hour people usually come;
+// one below the idle level, or without data, is an hour nobody is waited
+// for. The caller gives the time as seconds into the local week (Sunday
+// 00:00 is 0), see weekTime().
+// No Arduino dependency; save() and load() give the caller a blob for NVS.
+
+#define OCCUPANCY_SLOTS    168    // hours of a week
+#define OCCUPANCY_DECAY    2      // the level follows about the last 4 weeks
+#define OCCUPANCY_EXPECTED 16384  // [1/65536] a quarter of the minutes
+#define OCCUPANCY_IDLE     6554   // [1/65536] a tenth of the minutes
+#define OCCUPANCY_WEEK     (7 * 24 * 3600)
+#define OCCUPANCY_MAGIC    0x4F43
+#define OCCUPANCY_VERSION  1
+#define OCCUPANCY_BLOB     (4 + 3 * OCCUPANCY_SLOTS)  // [bytes] save()
+
+class OccupancyModel {
+   public:
+    OccupancyModel();
+
+    void configure(uint16_t expected, uint16_t idle);
+    void clear(void);
+
+    void update(uint32_t week);
+    void presence(bool detecting, uint32_t week);
+
+    static uint32_t weekTime(uint8_t wday, uint8_t hour, uint8_t minute, uint8_t second);
+    static uint8_t slot(uint32_t week) { return week % OCCUPANCY_WEEK / 3600; }
+
+    uint16_t getLevel(uint8_t slot) const { return _level[slot]; }
+    uint8_t getWeeks(uint8_t slot) const { return _weeks[slot]; }
+    bool isExpected(uint8_t slot) const;
+    bool isIdle(uint8_t slot) const;
+    uint32_t getHours(void) const { return _hours; }  // folded since clear()
+
+    size_t save(uint8_t *buffer, size_t size) const;
+    bool load(const uint8_t *buffer, size_t size);
+
+   private:
+    void mark(uint32_t from, uint32_t to);
+    void fold(void);
+
+    uint16_t _level[OCCUPANCY_SLOTS];  // [1/65536]
+    uint8_t _weeks[OCCUPANCY_SLOTS];   // folded, up to 2^OCCUPANCY_DECAY
+    uint16_t _expected;
+    uint16_t _idle;
+    uint32_t _hours;
+
+    uint32_t _start;     // of the current hour, week time
+    bool _whole;         // seen from its first minute
+    bool _started;       // the clock has been given
+    uint64_t _minutes;   // occupied minutes of the current hour
+    bool _detecting;
+    uint32_t _since;     // presence marked up to
+};
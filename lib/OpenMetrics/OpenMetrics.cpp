@@ -0,0 +1,96 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <OpenMetrics.h>
+
+OpenMetrics::OpenMetrics(Print &out, const char *prefix) : _out(out) {
+    _prefix = prefix;
+}
+
+// Names, help texts and labels go to the output as they are, only the
+// value is formatted, so no line is cut at a buffer size.
+void OpenMetrics::family(const char *name, const char *type, const char *help, const char *unit) {
+    _descriptor("TYPE", name, type);
+    _descriptor("HELP", name, help);
+    if (unit != nullptr) {
+        _descriptor("UNIT", name, unit);
+    }
+}
+
+void OpenMetrics::sample(const char *name, double value, const char *labels, const char *suffix) {
+    char buffer[24];  // " -1.234567891e+308\n"
+
+    _out.print(_prefix);
+    _out.print(name);
+    if (suffix != nullptr) {
+        _out.print(suffix);
+    }
+    if (labels != nullptr) {
+        _out.print("{");
+        _out.print(labels);
+        _out.print("}");
+    }
+    snprintf(buffer, sizeof(buffer), " %.10g\n", value);
+    _out.print(buffer);
+}
+
+void OpenMetrics::gauge(const char *name, const char *help, double value, const char *unit) {
+    family(name, "gauge", help, unit);
+    sample(name, value);
+}
+
+void OpenMetrics::counter(const char *name, const char *help, double value) {
+    family(name, "counter", help);
+    sample(name, value, nullptr, "_total");
+}
+
+// name must end with _seconds
+void OpenMetrics::histogram(const char *name, const char *help, const LatencyHistogram &latency) {
+    char labels[24];
+    uint32_t cumulative = 0;
+
+    family(name, "histogram", help, "seconds");
+    for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+        cumulative += latency.getBucket(i);
+        snprintf(labels, sizeof(labels), "le=\"%g\"", LatencyHistogram::upper(i) / 1000000.0);
+        sample(name, cumulative, labels, "_bucket");
+    }
+    sample(name, latency.getCount(), "le=\"+Inf\"", "_bucket");
+    sample(name, latency.getCount(), nullptr, "_count");
+    sample(name, latency.getSum() / 1000000.0, nullptr, "_sum");
+}
+
+// # <keyword> <prefix><name> <text>
+void OpenMetrics::_descriptor(const char *keyword, const char *name, const char *text) {
+    _out.print("# ");
+    _out.print(keyword);
+    _out.print(" ");
+    _out.print(_prefix);
+    _out.print(name);
+    _out.print(" ");
+    _out.print(text);
+    _out.print("\n");
+}
+
+void OpenMetrics::end(void) { _out.print("# EOF\n"); }
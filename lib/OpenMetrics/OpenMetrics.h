@@ -0,0 +1,49 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <LatencyHistogram.h>
+
+// OpenMetrics text exposition written straight to a Print.
+// https://github.com/OpenObservability/OpenMetrics/blob/main/specification/OpenMetrics.md
+class OpenMetrics {
+   public:
+    OpenMetrics(Print &out, const char *prefix);
+
+    void family(const char *name, const char *type, const char *help, const char *unit = nullptr);
+    void sample(const char *name, double value, const char *labels = nullptr, const char *suffix = nullptr);
+
+    void gauge(const char *name, const char *help, double value, const char *unit = nullptr);
+    void counter(const char *name, const char *help, double value);
+    void histogram(const char *name, const char *help, const LatencyHistogram &latency);
+    void end(void);
+
+   private:
+    void _descriptor(const char *keyword, const char *name, const char *text);
+
+    Print &_out;
+    const char *_prefix;
+};
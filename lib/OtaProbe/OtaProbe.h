@@ -0,0 +1,52 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+// Health probe of a new OTA image: the image is kept once the clock is
+// set, the sensor reads and an upload got through.
+//
+// The deadline counts only the time the clock was online (the last upload
+// reached the server, Connectivity::kOnline). Without the access point or
+// the server, a healthy image cannot pass, so an outage after the reboot
+// extends the deadline instead of throwing the image away. An image that
+// crashes is caught by the boot counter of OtaUpdater. A server that
+// answers with an error counts as online: the image got that far.
+// This file has no Arduino dependency and builds on the host as it is.
+
+#define OTA_PROBE_TIMEOUT 300000  // [ms] online after boot
+
+class OtaProbe {
+   public:
+    enum Verdict : uint8_t {
+        kPending = 0,
+        kPassed,
+        kFailed,
+    };
+
+    static Verdict judge(uint64_t online, bool ntp, bool sensor, bool upload);
+};
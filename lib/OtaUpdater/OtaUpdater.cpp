@@ -0,0 +1,288 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <HTTPClient.h>
+#include <OtaUpdater.h>
+#include <Preferences.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+static bool parseDigest(const String &hex, uint8_t *digest) {
+    if (hex.length() != 64) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < 32; i++) {
+        char byte[3] = {hex[i * 2], hex[i * 2 + 1], 0};
+        char *end;
+
+        digest[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+OtaUpdater::OtaUpdater() : Task("OTA_UPDATER", 8192, 1) {
+    memset(_digest, 0, sizeof(_digest));
+    _state     = kIdle;
+    _error     = "";
+    _size      = 0;
+    _written   = 0;
+    _startedAt = 0;
+    _elapsed   = 0;
+    _pending   = false;
+}
+
+OtaUpdater::~OtaUpdater() {
+    requestStop();
+    join();
+}
+
+// Starts a download, false when one is running or sha256 is not 64 hex digits.
+bool OtaUpdater::begin(const String &url, const String &sha256) {
+    if (isBusy() || !parseDigest(sha256, _digest)) {
+        return false;
+    }
+
+    join();  // the previous run() has returned already
+
+    _url     = url;
+    _error   = "";
+    _size    = 0;
+    _written = 0;
+    _elapsed = 0;
+    _state   = kDownloading;
+    start();
+
+    return true;
+}
+
+void OtaUpdater::run(void *data) {
+    data = nullptr;
+
+    log_i("OTA from %s", _url.c_str());
+    if (!_download()) {
+        return;
+    }
+
+    log_i("OTA done: %u bytes in %u ms, %u bytes/s", _written, _elapsed, getThroughput());
+    _state = kRebooting;
+    wait(1000);  // lets the HTTP status reach the client
+    ESP.restart();
+}
+
+bool OtaUpdater::_download(void) {
+    HTTPClient http;
+
+    if (!http.begin(_url)) {
+        _fail("bad URL");
+        return false;
+    }
+
+    int code = http.GET();
+    if (code != HTTP_CODE_OK) {
+        http.end();
+        _fail("HTTP error");
+        return false;
+    }
+
+    int length = http.getSize();
+    if (length <= 0) {
+        http.end();
+        _fail("no Content-Length");
+        return false;
+    }
+    _size = length;
+
+    if (!Update.begin(_size)) {
+        http.end();
+        _fail(Update.errorString());
+        return false;
+    }
+
+    WiFiClient *stream = http.getStreamPtr();
+    uint8_t buffer[OTA_CHUNK_SIZE];
+    mbedtls_sha256_context sha;
+    const char *error = NULL;
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+
+    _startedAt        = millis();
+    uint32_t lastData = _startedAt;
+    while (_written < _size) {
+        if (isStopRequested()) {
+            error = "aborted";
+            break;
+        }
+
+        size_t available = stream->available();
+        if (available == 0) {
+            if (!http.connected()) {
+                error = "connection closed";
+                break;
+            }
+            if (millis() - lastData > OTA_READ_TIMEOUT) {
+                error = "read timeout";
+                break;
+            }
+            wait(1);
+            continue;
+        }
+
+        size_t n = stream->readBytes(buffer, available < sizeof(buffer) ? available : sizeof(buffer));
+        mbedtls_sha256_update_ret(&sha, buffer, n);
+        if (Update.write(buffer, n) != n) {
+            error = Update.errorString();
+            break;
+        }
+        _written += n;
+        lastData = millis();
+    }
+    _elapsed = millis() - _startedAt;
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    http.end();
+
+    if (error == NULL && memcmp(digest, _digest, sizeof(digest)) != 0) {
+        error = "SHA-256 mismatch";
+    }
+    if (error != NULL) {
+        Update.abort();
+        _fail(error);
+        return false;
+    }
+
+    // Update.end() makes the new image the boot partition.
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    if (!Update.end()) {
+        _fail(Update.errorString());
+        return false;
+    }
+
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.putBool("pending", true);
+    prefs.putUChar("boots", 0);
+    prefs.putString("label", partition->label);
+    prefs.end();
+
+    return true;
+}
+
+void OtaUpdater::_fail(const char *error) {
+    log_e("OTA failed: %s", error);
+    _error = error;
+    _state = kFailed;
+}
+
+uint32_t OtaUpdater::getThroughput(void) const {
+    uint32_t elapsed = _state == kDownloading ? millis() - _startedAt : _elapsed;
+
+    return elapsed ? (uint64_t)_written * 1000 / elapsed : 0;
+}
+
+// Call early in setup(). Counts the boots of an image that has not passed
+// the health probe yet and rolls back after OTA_MAX_BOOTS.
+void OtaUpdater::checkBoot(void) {
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+
+    _pending = prefs.getBool("pending", false);
+    if (!_pending) {
+        prefs.end();
+        return;
+    }
+
+    // Booted something else than the new image, e.g. it was erased.
+    if (prefs.getString("label") != esp_ota_get_running_partition()->label) {
+        prefs.putBool("pending", false);
+        prefs.end();
+        _pending = false;
+        return;
+    }
+
+    uint8_t boots = prefs.getUChar("boots", 0) + 1;
+    prefs.putUChar("boots", boots);
+    prefs.end();
+
+    log_i("OTA image not confirmed yet, boot %u of %u", boots, OTA_MAX_BOOTS);
+    if (boots > OTA_MAX_BOOTS) {
+        _rollback("too many boots");
+    }
+}
+
+// Call periodically while isPending() with the verdict of the health
+// probe (ClockLoop::probe()). The image is kept once it passed, and rolled
+// back when it has not within OTA_PROBE_TIMEOUT online.
+void OtaUpdater::probe(OtaProbe::Verdict verdict) {
+    if (!_pending) {
+        return;
+    }
+
+    switch (verdict) {
+        case OtaProbe::kPassed:
+            _markValid();
+            break;
+        case OtaProbe::kFailed:
+            _rollback("health probe timed out");
+            break;
+        default:
+            break;
+    }
+}
+
+void OtaUpdater::_markValid(void) {
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.putBool("pending", false);
+    prefs.end();
+
+    _pending = false;
+    log_i("OTA image confirmed");
+}
+
+void OtaUpdater::_rollback(const char *reason) {
+    const esp_partition_t *previous = esp_ota_get_next_update_partition(NULL);
+
+    log_e("OTA rollback to %s: %s", previous ? previous->label : "?", reason);
+
+    Preferences prefs;
+    prefs.begin(OTA_NAMESPACE, false);
+    prefs.putBool("pending", false);
+    prefs.end();
+    _pending = false;
+
+    if (previous == NULL || esp_ota_set_boot_partition(previous) != ESP_OK) {
+        log_e("OTA rollback failed, keeping this image");
+        return;
+    }
+    ESP.restart();
+}
@@ -0,0 +1,92 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <OtaProbe.h>
+#include <Task.h>
+
+// Over-the-air update over HTTP, with manual A/B rollback.
+//
+// The image is streamed into the inactive app partition from a background
+// task and hashed on the way with SHA-256. Only an image whose digest
+// matches the expected one is made the boot partition.
+//
+// The new image boots "pending" (a flag in NVS). It has OTA_PROBE_TIMEOUT
+// online to pass the caller's health probe (see OtaProbe), and
+// OTA_MAX_BOOTS attempts to get that far, otherwise the previous partition
+// is booted again. The core has
+// no bootloader rollback (CONFIG_APP_ROLLBACK_ENABLE), so this is done with
+// esp_ota_set_boot_partition().
+
+#define OTA_CHUNK_SIZE    1460    // [bytes] one TCP segment
+#define OTA_READ_TIMEOUT  10000   // [ms] without data
+#define OTA_MAX_BOOTS     3
+#define OTA_NAMESPACE     "ota"
+
+class OtaUpdater : public Task {
+   public:
+    enum State : uint8_t {
+        kIdle = 0,
+        kDownloading,
+        kRebooting,
+        kFailed,
+    };
+
+    OtaUpdater();
+    ~OtaUpdater();
+
+    bool begin(const String &url, const String &sha256);
+    void run(void *data);
+
+    State getState(void) const { return _state; }
+    bool isBusy(void) const { return _state == kDownloading || _state == kRebooting; }
+    const char *getError(void) const { return _error; }
+    uint32_t getSize(void) const { return _size; }
+    uint32_t getWritten(void) const { return _written; }
+    uint32_t getThroughput(void) const;
+
+    void checkBoot(void);
+    bool isPending(void) const { return _pending; }
+    void probe(OtaProbe::Verdict verdict);
+
+   private:
+    bool _download(void);
+    void _fail(const char *error);
+    void _markValid(void);
+    void _rollback(const char *reason);
+
+    String _url;
+    uint8_t _digest[32];
+
+    volatile State _state;
+    const char *_error;
+    uint32_t _size;
+    volatile uint32_t _written;
+    uint32_t _startedAt;
+    uint32_t _elapsed;
+
+    bool _pending;
+};
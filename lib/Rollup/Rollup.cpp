@@ -0,0 +1,169 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <Rollup.h>
+#include <math.h>
+#include <string.h>
+
+static const uint32_t PERIOD[] = {60, 15 * 60, 60 * 60, 24 * 60 * 60};
+static const uint16_t DEPTH[]  = {ROLLUP_DEPTH_1MIN, ROLLUP_DEPTH_15MIN, ROLLUP_DEPTH_1HOUR, ROLLUP_DEPTH_1DAY};
+static const char *NAME[]      = {"1m", "15m", "1h", "1d"};
+
+static void initChannel(RollupChannel_t &channel, int32_t value) {
+    channel.min = value;
+    channel.max = value;
+    channel.sum = value;
+}
+
+static void mergeChannel(RollupChannel_t &to, const RollupChannel_t &from) {
+    if (from.min < to.min) {
+        to.min = from.min;
+    }
+    if (to.max < from.max) {
+        to.max = from.max;
+    }
+    to.sum += from.sum;
+}
+
+Rollup::Rollup() {
+    _ring[k1Min]  = _ring1Min;
+    _ring[k15Min] = _ring15Min;
+    _ring[k1Hour] = _ring1Hour;
+    _ring[k1Day]  = _ring1Day;
+    clear();
+}
+
+void Rollup::clear(void) {
+    for (uint8_t level = 0; level < kResolutions; level++) {
+        memset(&_open[level], 0, sizeof(RollupBucket_t));
+        _head[level]  = 0;
+        _count[level] = 0;
+    }
+}
+
+uint32_t Rollup::period(Resolution res) { return PERIOD[res]; }
+
+uint16_t Rollup::depth(Resolution res) { return DEPTH[res]; }
+
+bool Rollup::parse(const char *name, Resolution &res) {
+    for (uint8_t level = 0; level < kResolutions; level++) {
+        if (strcmp(name, NAME[level]) == 0) {
+            res = static_cast<Resolution>(level);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float Rollup::mean(const RollupChannel_t &channel, uint32_t count) {
+    return count ? (float)((double)channel.sum / count) : 0.0f;
+}
+
+// The means of a bucket, at its start, with the seconds of motion in it.
+TelemetrySample_t Rollup::toSample(const RollupBucket_t &bucket) {
+    TelemetrySample_t sample;
+
+    sample.time        = bucket.start;
+    sample.temperature = (int16_t)lroundf(mean(bucket.temperature, bucket.count));
+    sample.humidity    = (uint16_t)lroundf(mean(bucket.humidity, bucket.count));
+    sample.pressure    = (uint32_t)lroundf(mean(bucket.pressure, bucket.count));
+    sample.motion      = (uint16_t)(bucket.occupied < UINT16_MAX ? bucket.occupied : UINT16_MAX);
+
+    return sample;
+}
+
+// True when the sample closed the open 1-minute bucket, which is then
+// get(k1Min, 0).
+bool Rollup::add(const TelemetrySample_t &sample) {
+    RollupBucket_t bucket;
+
+    bucket.start    = sample.time;
+    bucket.count    = 1;
+    bucket.occupied = sample.motion;
+    initChannel(bucket.temperature, sample.temperature);
+    initChannel(bucket.humidity, sample.humidity);
+    initChannel(bucket.pressure, sample.pressure);
+
+    return _merge(k1Min, bucket);
+}
+
+bool Rollup::_merge(uint8_t level, const RollupBucket_t &bucket) {
+    RollupBucket_t &open = _open[level];
+    uint32_t start       = bucket.start - bucket.start % PERIOD[level];
+    bool closed          = open.count && open.start != start;
+
+    if (closed) {
+        _close(level);
+    }
+
+    if (open.count == 0) {
+        open       = bucket;
+        open.start = start;
+    } else {
+        open.count += bucket.count;
+        open.occupied += bucket.occupied;
+        mergeChannel(open.temperature, bucket.temperature);
+        mergeChannel(open.humidity, bucket.humidity);
+        mergeChannel(open.pressure, bucket.pressure);
+    }
+
+    return closed;
+}
+
+void Rollup::_close(uint8_t level) {
+    RollupBucket_t &open = _open[level];
+
+    _ring[level][_head[level]] = open;
+    _head[level]               = (_head[level] + 1) % DEPTH[level];
+    if (_count[level] < DEPTH[level]) {
+        _count[level]++;
+    }
+
+    if (level + 1 < kResolutions) {
+        _merge(level + 1, open);
+    }
+
+    open.count = 0;
+}
+
+uint16_t Rollup::available(Resolution res) const { return _count[res]; }
+
+// index 0 is the most recently closed bucket
+bool Rollup::get(Resolution res, uint16_t index, RollupBucket_t &bucket) const {
+    if (_count[res] <= index) {
+        return false;
+    }
+
+    uint16_t pos = (_head[res] + DEPTH[res] - 1 - index) % DEPTH[res];
+    bucket       = _ring[res][pos];
+
+    return true;
+}
+
+bool Rollup::getOpen(Resolution res, RollupBucket_t &bucket) const {
+    bucket = _open[res];
+
+    return bucket.count != 0;
+}
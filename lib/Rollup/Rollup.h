@@ -0,0 +1,94 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <TelemetryCodec.h>
+#include <stdint.h>
+
+// Cascading min/max/mean/count aggregates.
+// A sample is merged into the open 1-minute bucket. When a bucket of one
+// resolution closes it is stored in that resolution's ring and merged into
+// the open bucket of the next coarser one, so each sample costs O(1) and
+// every resolution can be read back without rescanning raw data.
+
+#define ROLLUP_DEPTH_1MIN  60   // 1 hour
+#define ROLLUP_DEPTH_15MIN 96   // 1 day
+#define ROLLUP_DEPTH_1HOUR 168  // 1 week
+#define ROLLUP_DEPTH_1DAY  31   // 1 month
+
+typedef struct {
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+} RollupChannel_t;
+
+typedef struct {
+    uint32_t start;               // UNIX time of the bucket start
+    uint32_t count;               // number of samples
+    uint32_t occupied;            // seconds with motion
+    RollupChannel_t temperature;  // [0.01 degC]
+    RollupChannel_t humidity;     // [0.01 %RH]
+    RollupChannel_t pressure;     // [Pa]
+} RollupBucket_t;
+
+class Rollup {
+   public:
+    enum Resolution : uint8_t {
+        k1Min = 0,
+        k15Min,
+        k1Hour,
+        k1Day,
+        kResolutions,
+    };
+
+    Rollup();
+
+    bool add(const TelemetrySample_t &sample);
+    void clear(void);
+
+    uint16_t available(Resolution res) const;
+    bool get(Resolution res, uint16_t index, RollupBucket_t &bucket) const;
+    bool getOpen(Resolution res, RollupBucket_t &bucket) const;
+
+    static uint32_t period(Resolution res);
+    static uint16_t depth(Resolution res);
+    static bool parse(const char *name, Resolution &res);
+    static float mean(const RollupChannel_t &channel, uint32_t count);
+    static TelemetrySample_t toSample(const RollupBucket_t &bucket);
+
+   private:
+    bool _merge(uint8_t level, const RollupBucket_t &bucket);
+    void _close(uint8_t level);
+
+    RollupBucket_t _open[kResolutions];
+    RollupBucket_t *_ring[kResolutions];
+    uint16_t _head[kResolutions];
+    uint16_t _count[kResolutions];
+
+    RollupBucket_t _ring1Min[ROLLUP_DEPTH_1MIN];
+    RollupBucket_t _ring15Min[ROLLUP_DEPTH_15MIN];
+    RollupBucket_t _ring1Hour[ROLLUP_DEPTH_1HOUR];
+    RollupBucket_t _ring1Day[ROLLUP_DEPTH_1DAY];
+};
@@ -0,0 +1,109 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <SegmentFont.h>
+
+static const int32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// value is in units of 10^-scale, decimals <= scale are shown if they fit.
+// Returns false when the value did not fit and "Hi" or "Lo" is shown.
+bool SegmentFont::format(int32_t value, uint8_t scale, uint8_t decimals, const SegmentUnit_t &unit, uint8_t segments[SEGMENT_DIGITS]) {
+    if (decimals > scale) {
+        decimals = scale;
+    }
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        uint8_t length = pass == 0 ? unit.length : unit.shortLength;
+        uint8_t width  = SEGMENT_DIGITS - length;
+
+        for (int8_t d = decimals; 0 <= d; d--) {
+            int32_t rounded = _round(value, scale - d);
+            if (_width(rounded, d) <= width) {
+                _render(rounded, d, width, segments);
+                for (uint8_t i = 0; i < length; i++) {
+                    segments[width + i] = unit.glyph[i];
+                }
+                return true;
+            }
+        }
+    }
+
+    uint8_t length = unit.shortLength;
+    for (uint8_t i = 0; i < SEGMENT_DIGITS; i++) {
+        segments[i] = GLYPH_BLANK;
+    }
+    segments[SEGMENT_DIGITS - length - 2] = value < 0 ? GLYPH_UPPER_L : GLYPH_UPPER_H;
+    segments[SEGMENT_DIGITS - length - 1] = value < 0 ? GLYPH_LOWER_O : GLYPH_LOWER_I;
+    for (uint8_t i = 0; i < length; i++) {
+        segments[SEGMENT_DIGITS - length + i] = unit.glyph[i];
+    }
+
+    return false;
+}
+
+// Divides by 10^shift, halves away from zero.
+int32_t SegmentFont::_round(int32_t value, uint8_t shift) {
+    if (shift == 0) {
+        return value;
+    }
+
+    int32_t half = POW10[shift] / 2;
+
+    return value < 0 ? -((-(int64_t)value + half) / POW10[shift]) : (value + (int64_t)half) / POW10[shift];
+}
+
+// Digits needed, with a leading zero before the decimals and the sign.
+uint8_t SegmentFont::_width(int32_t value, uint8_t decimals) {
+    uint32_t magnitude = value < 0 ? -(int64_t)value : value;
+    uint8_t width      = 1;
+
+    while (width < 10 && POW10[width] <= (int64_t)magnitude) {
+        width++;
+    }
+    if (width < decimals + 1) {
+        width = decimals + 1;
+    }
+
+    return width + (value < 0 ? 1 : 0);
+}
+
+// Right aligned in the first width digits.
+void SegmentFont::_render(int32_t value, uint8_t decimals, uint8_t width, uint8_t segments[SEGMENT_DIGITS]) {
+    uint32_t magnitude = value < 0 ? -(int64_t)value : value;
+    int8_t i           = width - 1;
+
+    for (uint8_t n = 0; i >= 0 && (n <= decimals || magnitude != 0); n++, i--) {
+        segments[i] = glyphDigit(magnitude % 10);
+        if (n == decimals && decimals != 0) {
+            segments[i] |= GLYPH_DOT;
+        }
+        magnitude /= 10;
+    }
+    if (value < 0 && i >= 0) {
+        segments[i--] = GLYPH_MINUS;
+    }
+    while (i >= 0) {
+        segments[i--] = GLYPH_BLANK;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// 7-segment glyphs and a fixed-point formatter for 4-digit displays.
+//
+// Bits are the TM1637Display ones (0x01 = A ... 0x40 = G, 0x80 = DP).
+// format() writes the segments of a value straight into a 4-byte array,
+// without going through text, and never writes more than the display
+// can show: decimals are dropped first, then the unit is shortened, and
+// what still does not fit shows "Hi" or "Lo".
+// No Arduino dependency.
+
+constexpr uint8_t GLYPH_DIGIT[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+constexpr uint8_t GLYPH_BLANK     = 0x00;
+constexpr uint8_t GLYPH_MINUS     = 0x40;
+constexpr uint8_t GLYPH_DEGREE    = 0x63;
+constexpr uint8_t GLYPH_UPPER_C   = 0x39;
+constexpr uint8_t GLYPH_UPPER_H   = 0x76;
+constexpr uint8_t GLYPH_UPPER_L   = 0x38;
+constexpr uint8_t GLYPH_UPPER_P   = 0x73;
+constexpr uint8_t GLYPH_LOWER_D   = 0x5E;
+constexpr uint8_t GLYPH_LOWER_I   = 0x10;
+constexpr uint8_t GLYPH_LOWER_O   = 0x5C;
+constexpr uint8_t GLYPH_DOT       = 0x80;
+
+constexpr uint8_t glyphDigit(uint8_t digit) { return digit < 10 ? GLYPH_DIGIT[digit] : GLYPH_MINUS; }
+
+#define SEGMENT_DIGITS 4
+
+typedef struct {
+    uint8_t glyph[2];     // shown after the number
+    uint8_t length;       // glyphs used normally
+    uint8_t shortLength;  // glyphs kept when the number needs the room
+} SegmentUnit_t;
+
+constexpr SegmentUnit_t UNIT_CELSIUS     = {{GLYPH_DEGREE, GLYPH_UPPER_C}, 2, 1};  // 25°C, 105°
+constexpr SegmentUnit_t UNIT_PERCENT     = {{GLYPH_DEGREE, GLYPH_LOWER_O}, 2, 0};  // 45°o, 100
+constexpr SegmentUnit_t UNIT_DEW_POINT   = {{GLYPH_DEGREE, GLYPH_LOWER_D}, 2, 1};  // 12°d, 9.5°d
+constexpr SegmentUnit_t UNIT_HEAT_INDEX  = {{GLYPH_DEGREE, GLYPH_UPPER_H}, 2, 1};  // 31°H, 105°
+constexpr SegmentUnit_t UNIT_HECTOPASCAL = {{GLYPH_UPPER_P, GLYPH_BLANK}, 1, 0};   // 998P, 1013
+constexpr SegmentUnit_t UNIT_NONE        = {{GLYPH_BLANK, GLYPH_BLANK}, 0, 0};
+
+class SegmentFont {
+   public:
+    static bool format(int32_t value, uint8_t scale, uint8_t decimals, const SegmentUnit_t &unit, uint8_t segments[SEGMENT_DIGITS]);
+
+   private:
+    static int32_t _round(int32_t value, uint8_t shift);
+    static uint8_t _width(int32_t value, uint8_t decimals);
+    static void _render(int32_t value, uint8_t decimals, uint8_t width, uint8_t segments[SEGMENT_DIGITS]);
+};
@@ -0,0 +1,210 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <SensorBus.h>
+#include <esp32-hal-log.h>
+
+SensorBus::SensorBus(TwoWire &wire) : Task("SENSOR_BUS", 4096, 2), _wire(wire) {
+    _count     = 0;
+    _callback  = nullptr;
+    _mutex     = nullptr;
+    _frequency = SENSOR_BUS_FREQUENCY;
+    _cycles    = 0;
+    _cycleTime = 0;
+}
+
+SensorBus::~SensorBus() {
+    requestStop();
+    join();
+}
+
+void SensorBus::begin(int sdaPin, int sclPin, uint32_t frequency) {
+    _mutex     = xSemaphoreCreateMutex();
+    _frequency = frequency;
+    _wire.begin(sdaPin, sclPin, frequency);
+}
+
+// A device that is missing now is probed again every SENSOR_BUS_RETRY cycles.
+bool SensorBus::add(BME280Class &device, MODE mode) {
+    if (_count >= SENSOR_BUS_DEVICES) {
+        log_e("No slot for the sensor at 0x%02x.", device.getAddress());
+        return false;
+    }
+
+    Slot_t &slot = _slot[_count++];
+    slot.device  = &device;
+    slot.mode    = mode;
+    slot.valid   = false;
+    slot.started = false;
+    slot.health  = {0, 0, 0, 0, 0};
+
+    bool present = device.setup(mode, _wire);
+    _wire.setClock(_frequency);  // begin() of the driver may have reset it
+
+    return present;
+}
+
+// For the caller that needs one sample before it goes on, e.g. setup().
+bool SensorBus::waitSample(uint32_t timeout) {
+    uint32_t cycles = _cycles;
+    uint32_t start  = millis();
+
+    while (_cycles == cycles && millis() - start < timeout) {
+        ::delay(5);
+    }
+
+    return _cycles != cycles;
+}
+
+void SensorBus::run(void *data) {
+    data = nullptr;
+
+    while (!isStopRequested()) {
+        if (wait(1000) && !isStopRequested()) {
+            _cycle();
+        }
+    }
+}
+
+// The latest sample that passed the filter, false before the first one and
+// while the device is failing, see _fail().
+bool SensorBus::getSample(uint8_t index, float &temperature, float &humidity, float &pressure) {
+    if (index >= _count) {
+        return false;
+    }
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    const Slot_t &slot = _slot[index];
+    bool valid         = slot.valid;
+    temperature        = slot.temperature;
+    humidity           = slot.humidity;
+    pressure           = slot.pressure;
+    xSemaphoreGive(_mutex);
+
+    return valid;
+}
+
+bool SensorBus::isHealthy(uint8_t index) const {
+    return index < _count && _slot[index].device->isPresent() && _slot[index].health.failures < SENSOR_BUS_FAILURES;
+}
+
+SensorHealth_t SensorBus::getHealth(uint8_t index) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    SensorHealth_t health = _slot[index].health;
+    xSemaphoreGive(_mutex);
+
+    return health;
+}
+
+void SensorBus::_cycle(void) {
+    uint32_t start      = micros();
+    uint32_t conversion = 0;  // [us] of the slowest device
+
+    // 1. start all conversions back to back
+    for (uint8_t i = 0; i < _count; i++) {
+        Slot_t &slot = _slot[i];
+        slot.started = false;
+
+        if (!slot.device->isPresent()) {
+            if (_cycles % SENSOR_BUS_RETRY != 0 || !slot.device->setup(slot.mode, _wire)) {
+                continue;
+            }
+            _wire.setClock(_frequency);
+            log_i("Sensor at 0x%02x is back.", slot.device->getAddress());
+        }
+
+        if (!slot.device->startConversion()) {
+            _fail(slot, slot.health.errors);
+            continue;
+        }
+        slot.started = true;
+        conversion   = max(conversion, slot.device->getConversionTime());
+    }
+
+    // 2. they run in parallel, so one wait covers all of them
+    if (conversion) {
+        delay((conversion + 999) / 1000);
+    }
+
+    // 3. one burst read per device
+    uint32_t deadline = millis() + SENSOR_BUS_TIMEOUT;
+    for (uint8_t i = 0; i < _count; i++) {
+        Slot_t &slot = _slot[i];
+        if (!slot.started) {
+            continue;
+        }
+
+        bool converting;
+        while ((converting = slot.device->isConverting()) && (int32_t)(millis() - deadline) < 0) {
+            delay(1);
+        }
+        if (converting) {
+            _fail(slot, slot.health.timeouts);
+            continue;
+        }
+
+        float temperature, humidity, pressure;
+        if (!slot.device->readSample(temperature, humidity, pressure)) {
+            _fail(slot, slot.health.errors);
+            continue;
+        }
+        bool accepted = slot.device->getFilter().update(temperature, humidity, pressure);
+
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        if (accepted) {
+            slot.temperature = temperature;
+            slot.humidity    = humidity;
+            slot.pressure    = pressure;
+            slot.valid       = true;
+            slot.health.samples++;
+        } else {
+            slot.health.rejected++;
+        }
+        slot.health.failures = 0;
+        xSemaphoreGive(_mutex);
+    }
+
+    _cycleTime = micros() - start;
+    _cycles++;
+
+    if (_callback) {
+        _callback();
+    }
+}
+
+void SensorBus::_fail(Slot_t &slot, uint32_t &counter) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    counter++;
+    if (slot.health.failures < UINT8_MAX) {
+        slot.health.failures++;
+    }
+    if (slot.health.failures >= SENSOR_BUS_FAILURES) {
+        slot.valid = false;  // the last sample is stale now
+    }
+    xSemaphoreGive(_mutex);
+
+    if (slot.health.failures == SENSOR_BUS_FAILURES) {
+        log_e("Sensor at 0x%02x is failing.", slot.device->getAddress());
+    }
+}
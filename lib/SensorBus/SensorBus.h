@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <BME280Class.h>
+#include <Task.h>
+#include <Wire.h>
+
+// Owner of the I2C bus and scheduler of the sensors on it.
+//
+// A cycle is started by trigger(). Every present device gets its forced
+// measurement started first, then the task sleeps for the longest
+// conversion time once and reads each device with one burst read, so N
+// sensors cost about as much bus wait as one. Results are filtered per
+// device and kept with its health counters; the callback tells the sample
+// pipeline that a cycle is complete.
+//
+// Nothing else may touch the bus after start().
+
+#define SENSOR_BUS_DEVICES   4
+#define SENSOR_BUS_FREQUENCY 400000  // [Hz]
+#define SENSOR_BUS_TIMEOUT   20      // [ms] over the conversion time
+#define SENSOR_BUS_FAILURES  3       // in a row, to be unhealthy
+#define SENSOR_BUS_RETRY     60      // [cycles] between probes of a missing device
+
+typedef struct {
+    uint32_t samples;   // accepted by the filter
+    uint32_t rejected;  // by the filter
+    uint32_t errors;    // NACK or short read
+    uint32_t timeouts;  // still converting at the deadline
+    uint8_t failures;   // in a row
+} SensorHealth_t;
+
+class SensorBus : public Task {
+   public:
+    typedef void (*Callback)(void);
+
+    SensorBus(TwoWire &wire);
+    ~SensorBus();
+
+    void begin(int sdaPin, int sclPin, uint32_t frequency = SENSOR_BUS_FREQUENCY);
+    bool add(BME280Class &device, MODE mode);
+    void onSample(Callback callback) { _callback = callback; }
+    void trigger(void) { notify(); }
+    bool waitSample(uint32_t timeout);
+    void run(void *data);
+
+    uint8_t count(void) const { return _count; }
+    BME280Class &device(uint8_t index) { return *_slot[index].device; }
+    bool getSample(uint8_t index, float &temperature, float &humidity, float &pressure);
+    bool isHealthy(uint8_t index) const;
+    SensorHealth_t getHealth(uint8_t index);
+    uint32_t getCycles(void) const { return _cycles; }
+    uint32_t getCycleTime(void) const { return _cycleTime; }
+
+   private:
+    typedef struct {
+        BME280Class *device;
+        MODE mode;
+        bool valid;
+        bool started;
+        float temperature;
+        float humidity;
+        float pressure;
+        SensorHealth_t health;
+    } Slot_t;
+
+    void _cycle(void);
+    void _fail(Slot_t &slot, uint32_t &counter);
+
+    TwoWire &_wire;
+    Slot_t _slot[SENSOR_BUS_DEVICES];
+    uint8_t _count;
+    Callback _callback;
+    SemaphoreHandle_t _mutex;
+    uint32_t _frequency;
+    volatile uint32_t _cycles;
+    uint32_t _cycleTime;  // [us] last cycle
+};
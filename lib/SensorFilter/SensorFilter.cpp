@@ -0,0 +1,142 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <SensorFilter.h>
+
+ChannelFilter::ChannelFilter() {
+    _preset.enabled = false;
+    _preset.lower   = 0;
+    _preset.upper   = 0;
+    _preset.median  = false;
+    _preset.maxRate = 0;
+    _preset.alpha   = 1.0f;
+    _rejected       = 0;
+    _limited        = 0;
+    reset();
+}
+
+void ChannelFilter::configure(const FilterPreset_t &preset) {
+    _preset = preset;
+    reset();
+}
+
+void ChannelFilter::reset(void) {
+    for (uint8_t i = 0; i < SENSOR_FILTER_WINDOW; i++) {
+        _window[i] = 0;
+    }
+    _head   = 0;
+    _count  = 0;
+    _output = 0;
+    _primed = false;
+}
+
+bool ChannelFilter::isPrimed(void) const { return _primed; }
+
+uint32_t ChannelFilter::getRejected(void) const { return _rejected; }
+
+uint32_t ChannelFilter::getLimited(void) const { return _limited; }
+
+float ChannelFilter::_median(void) const {
+    float sorted[SENSOR_FILTER_WINDOW];
+
+    // insertion sort over at most SENSOR_FILTER_WINDOW values
+    for (uint8_t i = 0; i < _count; i++) {
+        float v  = _window[i];
+        int8_t j = i - 1;
+        while (j >= 0 && sorted[j] > v) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = v;
+    }
+
+    return sorted[_count / 2];
+}
+
+bool ChannelFilter::update(float sample, float &value) {
+    if (!_preset.enabled) {
+        value = sample;
+        return true;
+    }
+
+    // NaN and out of range values are I2C glitches, keep the last output.
+    if (sample != sample || sample < _preset.lower || _preset.upper < sample) {
+        _rejected++;
+        value = _output;
+        return _primed;
+    }
+
+    _window[_head] = sample;
+    _head          = (_head + 1) % SENSOR_FILTER_WINDOW;
+    if (_count < SENSOR_FILTER_WINDOW) {
+        _count++;
+    }
+
+    float x = _preset.median ? _median() : sample;
+
+    if (!_primed) {
+        _output = x;
+        _primed = true;
+        value   = _output;
+        return true;
+    }
+
+    if (_preset.maxRate > 0) {
+        float delta = x - _output;
+        if (_preset.maxRate < delta) {
+            x = _output + _preset.maxRate;
+            _limited++;
+        } else if (delta < -_preset.maxRate) {
+            x = _output - _preset.maxRate;
+            _limited++;
+        }
+    }
+
+    _output += _preset.alpha * (x - _output);
+    value = _output;
+
+    return true;
+}
+
+void SensorFilter::configure(const FilterPreset_t presets[kChannels]) {
+    for (uint8_t i = 0; i < kChannels; i++) {
+        _channel[i].configure(presets[i]);
+    }
+}
+
+void SensorFilter::reset(void) {
+    for (uint8_t i = 0; i < kChannels; i++) {
+        _channel[i].reset();
+    }
+}
+
+bool SensorFilter::update(float &temperature, float &humidity, float &pressure) {
+    bool result = true;
+
+    result &= _channel[kTemperature].update(temperature, temperature);
+    result &= _channel[kHumidity].update(humidity, humidity);
+    result &= _channel[kPressure].update(pressure, pressure);
+
+    return result;
+}
@@ -0,0 +1,89 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Streaming filter for one sensor channel.
+// sample -> range check -> median of N -> rate of change limit -> EMA
+// Every stage works on a fixed-size ring buffer, so update() is O(1)
+// and never allocates.
+
+#define SENSOR_FILTER_WINDOW 5  // median window, must be odd
+
+typedef struct {
+    bool enabled;   // false passes samples through untouched
+    float lower;    // valid range of the raw sample
+    float upper;
+    bool median;    // median-of-N spike rejection
+    float maxRate;  // max change per sample, 0 = unlimited
+    float alpha;    // EMA coefficient, 1.0 = no smoothing
+} FilterPreset_t;
+
+class ChannelFilter {
+   public:
+    ChannelFilter();
+
+    void configure(const FilterPreset_t &preset);
+    void reset(void);
+
+    bool update(float sample, float &value);
+    bool isPrimed(void) const;
+
+    uint32_t getRejected(void) const;
+    uint32_t getLimited(void) const;
+
+   private:
+    float _median(void) const;
+
+    FilterPreset_t _preset;
+    float _window[SENSOR_FILTER_WINDOW];
+    uint8_t _head;
+    uint8_t _count;
+    float _output;
+    bool _primed;
+    uint32_t _rejected;
+    uint32_t _limited;
+};
+
+class SensorFilter {
+   public:
+    enum {
+        kTemperature = 0,
+        kHumidity,
+        kPressure,
+        kChannels,
+    };
+
+    void configure(const FilterPreset_t presets[kChannels]);
+    void reset(void);
+
+    bool update(float &temperature, float &humidity, float &pressure);
+
+    ChannelFilter &channel(uint8_t index) { return _channel[index]; }
+
+   private:
+    ChannelFilter _channel[kChannels];
+};
@@ -7,33 +7,95 @@
 
 static char tag[] = "Task";
 
-Task::Task(std::string taskName, uint16_t taskSize, uint8_t priority) {
+#if configSUPPORT_STATIC_ALLOCATION
+static StackType_t s_stack[TASK_POOL_SLOTS][TASK_POOL_STACK];
+static StaticTask_t s_tcb[TASK_POOL_SLOTS];
+static bool s_used[TASK_POOL_SLOTS];
+static portMUX_TYPE s_poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+static int8_t allocSlot(uint32_t size) {
+    int8_t slot = -1;
+
+    if (TASK_POOL_STACK < size) {
+        return slot;
+    }
+
+    portENTER_CRITICAL(&s_poolMux);
+    for (int8_t i = 0; i < TASK_POOL_SLOTS; i++) {
+        if (!s_used[i]) {
+            s_used[i] = true;
+            slot      = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_poolMux);
+
+    return slot;
+}
+
+static void freeSlot(int8_t slot) {
+    portENTER_CRITICAL(&s_poolMux);
+    s_used[slot] = false;
+    portEXIT_CRITICAL(&s_poolMux);
+}
+#endif
+
+Task::Task(std::string taskName, uint32_t taskSize, uint8_t priority) {
     m_handle   = nullptr;
     m_taskdata = nullptr;
     m_taskname = taskName;
     m_tasksize = taskSize;
     m_priority = priority;
     m_coreid   = tskNO_AFFINITY;
+    m_slot     = -1;
+    m_stop     = false;
+    m_done     = nullptr;
 }
 
-Task::~Task() {}
+// Derived classes whose run() touches their own members should call
+// requestStop() and join() in their destructor, this is the last resort.
+Task::~Task() {
+    if (m_handle != nullptr) {
+        requestStop();
+        join();
+    }
+}
 
 void Task::runTask(void *pTaskInstance) {
     Task *pTask = (Task *)pTaskInstance;
     ESP_LOGD(tag, ">> Task %s run", pTask->m_taskname.c_str());
     pTask->run(pTask->m_taskdata);
     ESP_LOGD(tag, "<< Task %s stop", pTask->m_taskname.c_str());
-    pTask->stop();
+
+    // The stack and TCB are released by join() (or stop()), so they are
+    // never reused while this task still exists.
+    xSemaphoreGive(pTask->m_done);
+    while (1) {
+        ::vTaskSuspend(nullptr);
+    }
 }
 
 void Task::start(void *taskData) {
     if (m_handle != nullptr) {
         ESP_LOGD(tag, "[] Task %s is already running", m_taskname.c_str());
+        return;
     }
     m_taskdata = taskData;
+    m_stop     = false;
+    m_done     = xSemaphoreCreateBinaryStatic(&m_doneBuffer);
+
+#if configSUPPORT_STATIC_ALLOCATION
+    m_slot = allocSlot(m_tasksize);
+    if (m_slot != -1) {
+        m_handle = ::xTaskCreateStaticPinnedToCore(&runTask, m_taskname.c_str(), m_tasksize, this, m_priority,
+                                                   s_stack[m_slot], &s_tcb[m_slot], m_coreid);
+        return;
+    }
+#endif
     ::xTaskCreatePinnedToCore(&runTask, m_taskname.c_str(), m_tasksize, this, m_priority, &m_handle, m_coreid);
 }
 
+// Deletes the task wherever it is. Prefer requestStop() and join().
 void Task::stop() {
     if (m_handle == nullptr) {
         return;
@@ -41,11 +103,52 @@ void Task::stop() {
     xTaskHandle handleTemp = m_handle;
     m_handle               = nullptr;
     ::vTaskDelete(handleTemp);
+    release();
 }
 
+void Task::release(void) {
+#if configSUPPORT_STATIC_ALLOCATION
+    if (m_slot != -1) {
+        freeSlot(m_slot);
+        m_slot = -1;
+    }
+#endif
+}
+
+void Task::requestStop(void) {
+    m_stop = true;
+    notify();
+}
+
+// Waits until run() returns, then frees the task.
+bool Task::join(uint32_t ms) {
+    if (m_handle == nullptr) {
+        return true;
+    }
+    if (xSemaphoreTake(m_done, ms / portTICK_PERIOD_MS) != pdTRUE) {
+        return false;
+    }
+    stop();
+
+    return true;
+}
+
+void Task::notify(void) {
+    if (m_handle != nullptr) {
+        ::xTaskNotifyGive(m_handle);
+    }
+}
+
+bool Task::isRunning(void) const { return m_handle != nullptr; }
+
+bool Task::isStopRequested(void) const { return m_stop; }
+
+// Sleeps up to ms, returns true when woken by notify() or requestStop().
+bool Task::wait(int ms) { return ::ulTaskNotifyTake(pdTRUE, ms / portTICK_PERIOD_MS) != 0; }
+
 void Task::delay(int ms) { ::vTaskDelay(ms / portTICK_PERIOD_MS); }
 
-void Task::setTaskSize(uint16_t size) { m_tasksize = size; }
+void Task::setTaskSize(uint32_t size) { m_tasksize = size; }
 
 void Task::setTaskPriority(uint8_t priority) { m_priority = priority; }
 
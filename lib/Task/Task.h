@@ -2,34 +2,54 @@
 #define _TASK_PERSION_H_
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include <string>
 
+// Stacks and TCBs of up to TASK_POOL_SLOTS tasks come from a static pool,
+// bigger or further tasks fall back to the heap.
+#define TASK_POOL_SLOTS 3
+#define TASK_POOL_STACK 8192  // [bytes] per slot
+
 class Task {
    public:
-    Task(std::string taskName = "task", uint16_t taskSize = 10240, uint8_t priority = 5);
-    ~Task();
+    Task(std::string taskName = "task", uint32_t taskSize = 10240, uint8_t priority = 5);
+    virtual ~Task();
     void start(void *taskData = nullptr);
     void stop();
 
+    void requestStop(void);
+    bool join(uint32_t ms = portMAX_DELAY);
+    void notify(void);
+    bool isRunning(void) const;
+
     void delay(int ms);
 
     virtual void run(void *data) = 0;
 
-    void setTaskSize(uint16_t size);
+    void setTaskSize(uint32_t size);
     void setTaskPriority(uint8_t priority);
     void setTaskName(std::string name);
     void setCore(BaseType_t coreID);
 
+   protected:
+    bool isStopRequested(void) const;
+    bool wait(int ms);
+
    private:
     xTaskHandle m_handle;
     void *m_taskdata;
     static void runTask(void *data);
+    void release(void);
     std::string m_taskname;
-    uint16_t m_tasksize;
+    uint32_t m_tasksize;
     uint8_t m_priority;
     BaseType_t m_coreid;
+    int8_t m_slot;
+    volatile bool m_stop;
+    SemaphoreHandle_t m_done;
+    StaticSemaphore_t m_doneBuffer;
     /* data */
 };
 
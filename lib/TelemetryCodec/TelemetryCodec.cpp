@@ -0,0 +1,208 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <TelemetryCodec.h>
+#include <math.h>
+
+static int32_t clamp(float value, int32_t lower, int32_t upper) {
+    if (value != value) {  // NaN
+        return lower;
+    }
+    if (value <= (float)lower) {
+        return lower;
+    }
+    if (value >= (float)upper) {
+        return upper;
+    }
+    return (int32_t)lroundf(value);
+}
+
+TelemetrySample_t TelemetryCodec::toSample(uint32_t time, float temperature, float humidity, float pressure, uint16_t motion) {
+    TelemetrySample_t sample;
+
+    sample.time        = time;
+    sample.temperature = (int16_t)clamp(temperature * 100.0f, INT16_MIN, INT16_MAX);
+    sample.humidity    = (uint16_t)clamp(humidity * 100.0f, 0, 10000);
+    sample.pressure    = (uint32_t)clamp(pressure * 100.0f, 0, 200000);  // hPa to Pa
+    sample.motion      = motion;
+
+    return sample;
+}
+
+float TelemetryCodec::temperature(const TelemetrySample_t &sample) { return sample.temperature / 100.0f; }
+
+float TelemetryCodec::humidity(const TelemetrySample_t &sample) { return sample.humidity / 100.0f; }
+
+float TelemetryCodec::pressure(const TelemetrySample_t &sample) { return sample.pressure / 100.0f; }
+
+size_t TelemetryCodec::maxFrameSize(uint8_t count) {
+    return TELEMETRY_HEADER_SIZE + (size_t)count * TELEMETRY_RECORD_MAX + TELEMETRY_CRC_SIZE;
+}
+
+uint32_t TelemetryCodec::zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t TelemetryCodec::unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+size_t TelemetryCodec::putVarint(uint32_t value, uint8_t *buffer, size_t size) {
+    size_t n = 0;
+
+    do {
+        if (n >= size) {
+            return 0;
+        }
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buffer[n++] = value ? (byte | 0x80) : byte;
+    } while (value);
+
+    return n;
+}
+
+size_t TelemetryCodec::getVarint(const uint8_t *buffer, size_t size, uint32_t &value) {
+    value = 0;
+
+    for (size_t n = 0; n < size && n < 5; n++) {
+        value |= (uint32_t)(buffer[n] & 0x7F) << (7 * n);
+        if ((buffer[n] & 0x80) == 0) {
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+size_t TelemetryCodec::encode(const TelemetrySample_t *samples, uint8_t count, uint8_t *buffer, size_t size) {
+    if (size < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE) {
+        return 0;
+    }
+
+    size_t pos    = 0;
+    buffer[pos++] = TELEMETRY_MAGIC;
+    buffer[pos++] = TELEMETRY_VERSION;
+    buffer[pos++] = count;
+
+    TelemetrySample_t prev = {0, 0, 0, 0, 0};
+    for (uint8_t i = 0; i < count; i++) {
+        const TelemetrySample_t &s = samples[i];
+        uint32_t fields[5];
+
+        if (i == 0) {
+            fields[0] = s.time;
+            fields[1] = zigzag(s.temperature);
+            fields[2] = s.humidity;
+            fields[3] = s.pressure;
+            fields[4] = s.motion;
+        } else {
+            fields[0] = s.time - prev.time;  // samples are time ordered
+            fields[1] = zigzag((int32_t)s.temperature - prev.temperature);
+            fields[2] = zigzag((int32_t)s.humidity - prev.humidity);
+            fields[3] = zigzag((int32_t)(s.pressure - prev.pressure));
+            fields[4] = zigzag((int32_t)s.motion - prev.motion);
+        }
+
+        for (uint8_t f = 0; f < 5; f++) {
+            size_t n = putVarint(fields[f], &buffer[pos], size - TELEMETRY_CRC_SIZE - pos);
+            if (n == 0) {
+                return 0;
+            }
+            pos += n;
+        }
+        prev = s;
+    }
+
+    uint16_t crc  = crc16(buffer, pos);
+    buffer[pos++] = crc & 0xFF;
+    buffer[pos++] = crc >> 8;
+
+    return pos;
+}
+
+size_t TelemetryCodec::decode(const uint8_t *buffer, size_t size, TelemetrySample_t *samples, uint8_t capacity, uint8_t &count) {
+    count = 0;
+
+    if (size < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE ||
+        buffer[0] != TELEMETRY_MAGIC || buffer[1] != TELEMETRY_VERSION) {
+        return 0;
+    }
+
+    uint8_t records = buffer[2];
+    if (records > capacity) {
+        return 0;
+    }
+
+    size_t pos             = TELEMETRY_HEADER_SIZE;
+    TelemetrySample_t prev = {0, 0, 0, 0, 0};
+    for (uint8_t i = 0; i < records; i++) {
+        uint32_t fields[5];
+
+        for (uint8_t f = 0; f < 5; f++) {
+            size_t n = getVarint(&buffer[pos], size - TELEMETRY_CRC_SIZE - pos, fields[f]);
+            if (n == 0) {
+                return 0;
+            }
+            pos += n;
+        }
+
+        TelemetrySample_t &s = samples[i];
+        if (i == 0) {
+            s.time        = fields[0];
+            s.temperature = (int16_t)unzigzag(fields[1]);
+            s.humidity    = (uint16_t)fields[2];
+            s.pressure    = fields[3];
+            s.motion      = (uint16_t)fields[4];
+        } else {
+            s.time        = prev.time + fields[0];
+            s.temperature = (int16_t)(prev.temperature + unzigzag(fields[1]));
+            s.humidity    = (uint16_t)(prev.humidity + unzigzag(fields[2]));
+            s.pressure    = prev.pressure + (uint32_t)unzigzag(fields[3]);
+            s.motion      = (uint16_t)(prev.motion + unzigzag(fields[4]));
+        }
+        prev = s;
+    }
+
+    uint16_t crc = buffer[pos] | (buffer[pos + 1] << 8);
+    if (crc != crc16(buffer, pos)) {
+        return 0;
+    }
+
+    count = records;
+
+    return pos + TELEMETRY_CRC_SIZE;
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t TelemetryCodec::crc16(const uint8_t *data, size_t length, uint16_t crc) {
+    while (length--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,73 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary frame layout (all multi-byte integers are LEB128 varints)
+//
+//   magic(0xAC) version(1) count(1 byte)
+//   record[0]      : time, zigzag(temperature), humidity, pressure, motion
+//   record[1..n-1] : delta time, zigzag(delta of every other field)
+//   crc16(2 bytes, little endian, CRC-16/CCITT-FALSE over magic..last record)
+//
+// Every frame starts with an absolute record, so frames can be streamed,
+// concatenated and decoded independently of each other.
+// This file has no Arduino dependency and builds on the host as it is.
+
+#define TELEMETRY_MAGIC       0xAC
+#define TELEMETRY_VERSION     1
+#define TELEMETRY_HEADER_SIZE 3
+#define TELEMETRY_CRC_SIZE    2
+#define TELEMETRY_RECORD_MAX  25  // 5 fields x 5 bytes of varint
+
+typedef struct {
+    uint32_t time;        // UNIX time [s]
+    int16_t temperature;  // [0.01 degC]
+    uint16_t humidity;    // [0.01 %RH]
+    uint32_t pressure;    // [Pa]
+    uint16_t motion;      // occupancy in the sampling interval [s]
+} TelemetrySample_t;
+
+class TelemetryCodec {
+   public:
+    static TelemetrySample_t toSample(uint32_t time, float temperature, float humidity, float pressure, uint16_t motion);
+    static float temperature(const TelemetrySample_t &sample);
+    static float humidity(const TelemetrySample_t &sample);
+    static float pressure(const TelemetrySample_t &sample);
+
+    static size_t maxFrameSize(uint8_t count);
+    static size_t encode(const TelemetrySample_t *samples, uint8_t count, uint8_t *buffer, size_t size);
+    static size_t decode(const uint8_t *buffer, size_t size, TelemetrySample_t *samples, uint8_t capacity, uint8_t &count);
+
+    static uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+   private:
+    static uint32_t zigzag(int32_t value);
+    static int32_t unzigzag(uint32_t value);
+    static size_t putVarint(uint32_t value, uint8_t *buffer, size_t size);
+    static size_t getVarint(const uint8_t *buffer, size_t size, uint32_t &value);
+};
@@ -0,0 +1,124 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <TimeService.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *WEEKDAY[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+TimeService::TimeService() {
+    memset(&_snapshot, 0, sizeof(_snapshot));
+    memset(&_next, 0, sizeof(_next));
+    _seq         = 0;
+    _invalid     = true;
+    _base        = 0;
+    _lastOffset  = 0;
+    _steppedAt   = 0;
+    _conversions = 0;
+    _updates     = 0;
+}
+
+// now [s] is the wall clock, monotonic [us] a clock that SNTP does not
+// step. Returns true when a new snapshot was published.
+bool TimeService::update(time_t now, int64_t monotonic) {
+    bool force = _invalid.exchange(false, std::memory_order_acq_rel);
+
+    if (now >= TIME_SERVICE_VALID) {
+        int64_t offset = (int64_t)now - monotonic / 1000000;
+        if (_steppedAt == 0 || offset - _lastOffset > 1 || offset - _lastOffset < -1) {
+            _steppedAt = now;
+            force     = true;
+        }
+        _lastOffset = offset;
+    }
+
+    if (!force && now == _next.utc) {
+        return false;
+    }
+
+    if (force || now / 60 != _base / 60) {
+        struct tm utc;
+        localtime_r(&now, &_next.local);
+        gmtime_r(&now, &utc);
+        _conversions++;
+        _base = now;
+
+        int32_t days = _next.local.tm_yday - utc.tm_yday;
+        if (_next.local.tm_year != utc.tm_year) {
+            days = _next.local.tm_year > utc.tm_year ? 1 : -1;
+        }
+        _next.offset = days * 86400 + (_next.local.tm_hour - utc.tm_hour) * 3600 + (_next.local.tm_min - utc.tm_min) * 60;
+    } else {
+        _next.local.tm_sec = now % 60;  // the zone offsets are whole minutes
+    }
+    _next.utc = now;
+    _format(_next);
+    _updates++;
+
+    _seq.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_release);
+    _snapshot = _next;
+    _seq.fetch_add(1, std::memory_order_release);
+
+    return true;
+}
+
+void TimeService::read(TimeSnapshot_t &snapshot) const {
+    uint32_t seq;
+
+    do {
+        seq      = _seq.load(std::memory_order_acquire);
+        snapshot = _snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != _seq.load(std::memory_order_relaxed));
+}
+
+bool TimeService::isValid(void) const {
+    TimeSnapshot_t snapshot;
+    read(snapshot);
+
+    return snapshot.utc >= TIME_SERVICE_VALID;
+}
+
+// The fields are taken modulo their width so that the compiler can prove
+// the 32 bytes of iso and web are enough, a valid tm is not changed by it.
+void TimeService::_format(TimeSnapshot_t &s) {
+    const struct tm &tm = s.local;
+    unsigned offset     = s.offset < 0 ? -s.offset : s.offset;
+    unsigned year       = (unsigned)(tm.tm_year + 1900) % 10000;
+    unsigned month      = (unsigned)(tm.tm_mon + 1) % 100;
+    unsigned day        = (unsigned)tm.tm_mday % 100;
+    unsigned hour       = (unsigned)tm.tm_hour % 100;
+    unsigned minute     = (unsigned)tm.tm_min % 100;
+    unsigned second     = (unsigned)tm.tm_sec % 100;
+
+    s.clock = tm.tm_hour * 100 + tm.tm_min;
+    snprintf(s.hhmm, sizeof(s.hhmm), "%02u:%02u", hour, minute);
+    snprintf(s.iso, sizeof(s.iso), "%04u-%02u-%02uT%02u:%02u:%02u%c%02u:%02u",
+             year, month, day, hour, minute, second,
+             s.offset < 0 ? '-' : '+', offset / 3600 % 100, offset / 60 % 60);
+    snprintf(s.web, sizeof(s.web), "%04u/%02u/%02u(%s) %02u:%02u:%02u.",
+             year, month, day, WEEKDAY[tm.tm_wday], hour, minute, second);
+}
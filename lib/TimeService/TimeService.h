@@ -0,0 +1,88 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+
+// The local time, broken down and formatted once per second for everybody.
+//
+// One writer calls update() from a periodic context (the render clock),
+// any number of readers take a copy of the snapshot with read(), lock free.
+// The snapshot is published with a sequence lock: the writer makes the
+// sequence odd while it copies, a reader retries until it copied under
+// the same even sequence. A reader must not preempt the writer on its core.
+//
+// localtime_r() runs when the minute changes, after invalidate() (time
+// zone) and when the wall clock steps (SNTP); within a minute the seconds
+// are counted on the cached time.
+// No Arduino dependency, the caller provides the clocks.
+
+#define TIME_SERVICE_VALID 1600000000  // [s] earlier is not synchronized yet
+
+typedef struct {
+    time_t utc;
+    struct tm local;
+    int32_t offset;  // [s] east of UTC
+    uint16_t clock;  // HHMM as a number, for the 7-segment display
+    char hhmm[6];    // 05:06
+    char iso[32];    // 2021-03-04T05:06:07+09:00
+    char web[32];    // 2021/03/04(Thu) 05:06:07.
+} TimeSnapshot_t;
+
+class TimeService {
+   public:
+    TimeService();
+
+    bool update(time_t now, int64_t monotonic);
+    void invalidate(void) { _invalid.store(true, std::memory_order_release); }
+
+    void read(TimeSnapshot_t &snapshot) const;
+    bool isValid(void) const;
+
+    // when the wall clock was first valid or last moved by more than 1 s
+    // against the monotonic clock, 0 before that. IDF 3.3 SNTP has no
+    // sync callback, so this is what a set by SNTP looks like from here.
+    time_t getSteppedAt(void) const { return _steppedAt; }
+    uint32_t getConversions(void) const { return _conversions; }
+    uint32_t getUpdates(void) const { return _updates; }
+
+   private:
+    void _format(TimeSnapshot_t &snapshot);
+
+    TimeSnapshot_t _snapshot;
+    std::atomic<uint32_t> _seq;
+    std::atomic<bool> _invalid;
+
+    // writer only
+    TimeSnapshot_t _next;
+    time_t _base;  // utc of the last localtime_r()
+    int64_t _lastOffset;
+    volatile time_t _steppedAt;
+    volatile uint32_t _conversions;
+    volatile uint32_t _updates;
+};
@@ -0,0 +1,118 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <TouchClassifier.h>
+
+TouchClassifier::TouchClassifier() {
+    _pressPercent   = 10;
+    _releasePercent = 5;
+    _state          = kIdle;
+    _raw            = 0;
+    _baseline       = 0;
+    _pressedAt      = 0;
+    _releasedAt     = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        _count[i] = 0;
+    }
+}
+
+void TouchClassifier::configure(uint16_t baseline, uint8_t pressPercent, uint8_t releasePercent) {
+    _baseline       = (uint32_t)baseline << 4;
+    _pressPercent   = pressPercent;
+    _releasePercent = releasePercent;
+    _state          = kIdle;
+}
+
+TouchClassifier::Gesture TouchClassifier::update(uint16_t raw, uint32_t now) {
+    uint32_t baseline = _baseline >> 4;
+    bool pressed      = raw * 100 < baseline * (100 - _pressPercent);
+    bool released     = baseline * (100 - _releasePercent) <= raw * 100;
+    Gesture gesture   = kNone;
+
+    _raw = raw;
+
+    switch (_state) {
+        case kIdle:
+            if (pressed) {
+                _state     = kPressed;
+                _pressedAt = now;
+            }
+            break;
+        case kPressed:
+            if (released) {
+                if (now - _pressedAt < TOUCH_DEBOUNCE) {
+                    _state = kIdle;
+                } else {
+                    _state      = kWaitSecond;
+                    _releasedAt = now;
+                }
+            } else if (TOUCH_LONG_PRESS <= now - _pressedAt) {
+                _state  = kHeld;
+                gesture = kLongPress;
+            }
+            break;
+        case kWaitSecond:
+            if (pressed) {
+                _state     = kSecondPressed;
+                _pressedAt = now;
+            } else if (TOUCH_DOUBLE_TAP <= now - _releasedAt) {
+                _state  = kIdle;
+                gesture = kTap;
+            }
+            break;
+        case kSecondPressed:
+            if (released) {
+                if (now - _pressedAt < TOUCH_DEBOUNCE) {
+                    _state = kWaitSecond;  // noise, keep waiting for the second tap
+                } else {
+                    _state  = kIdle;
+                    gesture = kDoubleTap;
+                }
+            } else if (TOUCH_LONG_PRESS <= now - _pressedAt) {
+                _state  = kHeld;
+                gesture = kLongPress;
+            }
+            break;
+        case kHeld:
+            if (released) {
+                _state = kIdle;
+            } else if (TOUCH_STUCK <= now - _pressedAt) {
+                // Nobody holds a pad this long, the baseline has drifted.
+                _baseline = (uint32_t)raw << 4;
+                _state    = kIdle;
+            }
+            break;
+    }
+
+    // Follow the untouched level only, so a touch never drags the baseline.
+    if (_state == kIdle && !pressed) {
+        _baseline += ((int32_t)((uint32_t)raw << 4) - (int32_t)_baseline) >> TOUCH_BASELINE_SHIFT;
+    }
+
+    if (gesture != kNone) {
+        _count[gesture]++;
+    }
+
+    return gesture;
+}
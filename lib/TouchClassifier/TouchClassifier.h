@@ -0,0 +1,77 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Touch gesture classifier over raw touch pad readings.
+// The untouched level is tracked by a slow IIR baseline, a touch is a
+// drop below the baseline with separate press/release levels (hysteresis)
+// and the press timing is classified into gestures.
+// No Arduino dependency, the caller provides the readings and the clock.
+
+#define TOUCH_BASELINE_SHIFT 6      // IIR coefficient 1/64
+#define TOUCH_DEBOUNCE       40     // [ms] shorter presses are noise
+#define TOUCH_DOUBLE_TAP     300    // [ms] max gap between two taps
+#define TOUCH_LONG_PRESS     800    // [ms]
+#define TOUCH_STUCK          10000  // [ms] recalibrate after this
+
+class TouchClassifier {
+   public:
+    enum Gesture : uint8_t {
+        kNone = 0,
+        kTap,
+        kDoubleTap,
+        kLongPress,
+    };
+
+    TouchClassifier();
+
+    void configure(uint16_t baseline, uint8_t pressPercent, uint8_t releasePercent);
+    Gesture update(uint16_t raw, uint32_t now);
+
+    uint16_t getRaw(void) const { return _raw; }
+    uint16_t getBaseline(void) const { return _baseline >> 4; }
+    uint32_t getCount(Gesture gesture) const { return _count[gesture]; }
+
+   private:
+    enum State : uint8_t {
+        kIdle = 0,
+        kPressed,
+        kWaitSecond,
+        kSecondPressed,
+        kHeld,
+    };
+
+    uint8_t _pressPercent;
+    uint8_t _releasePercent;
+
+    State _state;
+    uint16_t _raw;
+    uint32_t _baseline;  // x16 fixed point
+    uint32_t _pressedAt;
+    uint32_t _releasedAt;
+    uint32_t _count[4];
+};
@@ -0,0 +1,57 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <TouchEngine.h>
+
+TouchEngine::TouchEngine() {
+    _queue = NULL;
+    _pin   = 0;
+}
+
+TouchEngine::~TouchEngine() { end(); }
+
+void TouchEngine::begin(uint8_t pin, uint8_t pressPercent, uint8_t releasePercent) {
+    _pin = pin;
+
+    if (_queue == NULL) {
+        _queue = xQueueCreate(TOUCH_QUEUE_LENGTH, sizeof(Gesture));
+    }
+
+    configure(touchRead(_pin), pressPercent, releasePercent);
+    _ticker.attach_ms(TOUCH_SAMPLE_PERIOD, _sample, this);
+}
+
+void TouchEngine::end(void) { _ticker.detach(); }
+
+void TouchEngine::_sample(TouchEngine *engine) {
+    Gesture gesture = engine->update(touchRead(engine->_pin), millis());
+
+    if (gesture != kNone) {
+        xQueueSend(engine->_queue, &gesture, 0);  // drop when the consumer is busy
+    }
+}
+
+bool TouchEngine::receive(Gesture &gesture) {
+    return _queue != NULL && xQueueReceive(_queue, &gesture, 0) == pdTRUE;
+}
@@ -0,0 +1,54 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <Ticker.h>
+#include <TouchClassifier.h>
+
+// Samples a capacitive touch pad on a timer and posts the classified
+// gestures to a queue, the consumer runs whatever the gesture means in
+// its own context.
+
+#define TOUCH_SAMPLE_PERIOD 20  // [ms]
+#define TOUCH_QUEUE_LENGTH  4
+
+class TouchEngine : public TouchClassifier {
+   public:
+    TouchEngine();
+    ~TouchEngine();
+
+    void begin(uint8_t pin, uint8_t pressPercent, uint8_t releasePercent);
+    void end(void);
+
+    bool receive(Gesture &gesture);
+
+   private:
+    static void _sample(TouchEngine *engine);
+
+    Ticker _ticker;
+    QueueHandle_t _queue;
+    uint8_t _pin;
+};
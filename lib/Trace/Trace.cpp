@@ -0,0 +1,142 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <Trace.h>
+#include <stdio.h>
+#include <string.h>
+
+void Trace::record(char phase, const char *name, uint32_t time, uint32_t duration, uint8_t core, const char *task) {
+    Cursor ticket;
+    TraceRecord_t &r = _rings.reserve(core, ticket);
+
+    r.time     = time;
+    r.duration = duration;
+    r.name     = name;
+    r.phase    = phase;
+    r.core     = core;
+    strncpy(r.task, task ? task : "?", sizeof(r.task) - 1);
+    r.task[sizeof(r.task) - 1] = '\0';
+
+    _rings.publish(core, ticket);
+}
+
+TraceExport::TraceExport(Trace &trace) : _trace(trace), _base(0), _records(0), _started(false), _done(false) {
+    for (uint8_t c = 0; c < TRACE_CORES; c++) {
+        _cursor[c] = trace.oldest(c);
+        _end[c]    = trace.head(c);
+        _peeked[c] = false;
+        _named[c]  = 0;
+    }
+    memset(_tasks, 0, sizeof(_tasks));
+}
+
+// Reads the next record of core into _pending, up to the end taken at
+// the start: what the export itself records is not in it.
+bool TraceExport::_peek(uint8_t core) {
+    if (!_peeked[core] && (int32_t)(_end[core] - _cursor[core]) > 0) {
+        _peeked[core] = _trace.read(core, _cursor[core], _pending[core]) && (int32_t)(_end[core] - _cursor[core]) >= 0;
+    }
+
+    return _peeked[core];
+}
+
+size_t TraceExport::next(char *buffer, size_t size) {
+    size_t n = 0;
+
+    if (_done) {
+        return 0;
+    }
+    if (!_started) {
+        _started = true;
+        n        = snprintf(buffer, size, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    }
+
+    while (n + TRACE_TEXT <= size) {
+        int8_t first = -1;
+        for (uint8_t c = 0; c < TRACE_CORES; c++) {
+            if (_peek(c) && (first < 0 || (int32_t)(_pending[c].time - _pending[first].time) < 0)) {
+                first = c;
+            }
+        }
+        if (first < 0) {
+            _done = true;
+            n += snprintf(&buffer[n], size - n, "]}\n");
+            break;
+        }
+        _peeked[first] = false;
+        n += _text(_pending[first], &buffer[n], size - n);
+    }
+
+    return n;
+}
+
+// One event, after the process and thread names the first time the core
+// and the task appear. A task beyond TRACE_TASKS is thread 0, unnamed.
+size_t TraceExport::_text(const TraceRecord_t &r, char *buffer, size_t size) {
+    uint8_t tid = 0;
+    int n       = 0;
+
+    if (_records == 0) {
+        _base = r.time;
+    }
+    for (uint8_t t = 0; t < TRACE_TASKS; t++) {
+        if (_tasks[t][0] == '\0') {
+            memcpy(_tasks[t], r.task, sizeof(_tasks[t]));
+        }
+        if (strncmp(_tasks[t], r.task, sizeof(_tasks[t])) == 0) {
+            tid = t + 1;
+            break;
+        }
+    }
+
+    const char *comma = _records ? "," : "";
+    if ((_named[r.core] & 1) == 0) {
+        n += snprintf(&buffer[n], size - n, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"core %u\"}}",
+                      comma, r.core, r.core);
+        comma = ",";
+    }
+    if (tid && (_named[r.core] & (1 << tid)) == 0) {
+        n += snprintf(&buffer[n], size - n, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                      comma, r.core, tid, r.task);
+        comma = ",";
+    }
+    _named[r.core] |= 1 | (1 << tid);
+
+    n += snprintf(&buffer[n], size - n, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%d,\"pid\":%u,\"tid\":%u", comma, r.name, r.phase,
+                  (int32_t)(r.time - _base), r.core, tid);
+    if (r.phase == 'X') {
+        n += snprintf(&buffer[n], size - n, ",\"dur\":%u}", r.duration);
+    } else if (r.phase == 'i') {
+        n += snprintf(&buffer[n], size - n, ",\"s\":\"t\"}");
+    } else {
+        n += snprintf(&buffer[n], size - n, "}");
+    }
+    _records++;
+
+    return n;
+}
+
+#if defined(ARDUINO) && !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_TRACE)
+Trace trace;
+#endif
@@ -0,0 +1,143 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <CoreRing.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Timeline of what the tasks on both cores were doing, exported in the
+// Chrome trace event format for chrome://tracing or ui.perfetto.dev.
+//
+// A record is an instant, the begin or end of a span, or a whole span
+// recorded when it ends ('X', with its duration). Whole spans shorter than
+// TRACE_MIN_SPAN are not recorded, so the idle loop() iterations do not
+// push the stall being looked for out of the rings.
+//
+// The records are kept in a CoreRing, as those of DeferredLog. Names must
+// be literals or otherwise outlive the record; the task name is copied,
+// the task may be gone by the time the trace is exported.
+// The class has no Arduino dependency; the host simulator records in its
+// virtual time. On the device the TRACE_x() macros record with
+// esp_timer_get_time(), the core and the FreeRTOS task; -DNO_TRACE
+// compiles them out.
+
+#define TRACE_RECORDS   128   // per core, power of two
+#define TRACE_CORES     2
+#define TRACE_MIN_SPAN  1000  // [us]
+#define TRACE_TASKS     16    // named threads in an export
+#define TRACE_TEXT      320   // [bytes] longest exported record, with the names
+#define TRACE_TASK_NAME 16    // [bytes] configMAX_TASK_NAME_LEN of the core
+
+typedef struct {
+    uint32_t time;      // [us] of the event, the start of a whole span
+    uint32_t duration;  // [us] of a whole span
+    const char *name;
+    char task[TRACE_TASK_NAME];
+    char phase;  // 'i' instant, 'B' begin, 'E' end, 'X' whole span
+    uint8_t core;
+    uint16_t reserved;
+} TraceRecord_t;
+
+class Trace {
+   public:
+    typedef uint32_t Cursor;
+
+    void record(char phase, const char *name, uint32_t time, uint32_t duration, uint8_t core, const char *task);
+
+    Cursor oldest(uint8_t core) const { return _rings.oldest(core); }
+    Cursor head(uint8_t core) const { return _rings.head(core); }
+    bool read(uint8_t core, Cursor &cursor, TraceRecord_t &record) { return _rings.read(core, cursor, record); }
+
+    uint32_t getRecords(void) const { return _rings.getRecords(); }
+    uint32_t getLost(void) const { return _rings.getLost(); }
+
+   private:
+    CoreRing<TraceRecord_t, TRACE_RECORDS, TRACE_CORES> _rings;
+};
+
+// The records in the rings when it is made, both cores merged in order,
+// as {"traceEvents":[...]} in batches. One process per core, one thread
+// per task. Times count from the first record, a span that started before
+// it has a negative time.
+class TraceExport {
+   public:
+    TraceExport(Trace &trace);
+
+    size_t next(char *buffer, size_t size);  // at least TRACE_TEXT bytes
+
+   private:
+    bool _peek(uint8_t core);
+    size_t _text(const TraceRecord_t &record, char *buffer, size_t size);
+
+    Trace &_trace;
+    Trace::Cursor _cursor[TRACE_CORES];
+    Trace::Cursor _end[TRACE_CORES];
+    TraceRecord_t _pending[TRACE_CORES];
+    bool _peeked[TRACE_CORES];
+    char _tasks[TRACE_TASKS][TRACE_TASK_NAME];
+    uint32_t _named[TRACE_CORES];  // bit 0 process_name, bit per task thread_name sent
+    uint32_t _base;
+    uint32_t _records;
+    bool _started;
+    bool _done;
+};
+
+#if defined(ARDUINO) && !defined(NO_GLOBAL_INSTANCES) && !defined(NO_GLOBAL_TRACE)
+#include <Arduino.h>
+
+extern Trace trace;
+
+static_assert(TRACE_TASK_NAME >= configMAX_TASK_NAME_LEN, "TRACE_TASK_NAME cuts the task names");
+
+#ifndef NO_TRACE
+// A whole span from here to the end of the scope.
+class TraceScope {
+   public:
+    TraceScope(const char *name) : _name(name), _start((uint32_t)esp_timer_get_time()) {}
+    ~TraceScope() {
+        uint32_t duration = (uint32_t)esp_timer_get_time() - _start;
+        if (duration >= TRACE_MIN_SPAN) {
+            trace.record('X', _name, _start, duration, xPortGetCoreID(), pcTaskGetTaskName(NULL));
+        }
+    }
+
+   private:
+    const char *_name;
+    uint32_t _start;
+};
+
+#define TRACE_EVENT(phase, name) trace.record(phase, name, (uint32_t)esp_timer_get_time(), 0, xPortGetCoreID(), pcTaskGetTaskName(NULL))
+#define TRACE_SCOPE(name)        TraceScope _traceScope(name)
+#define TRACE_INSTANT(name)      TRACE_EVENT('i', name)
+#define TRACE_BEGIN(name)        TRACE_EVENT('B', name)
+#define TRACE_END(name)          TRACE_EVENT('E', name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#endif
+#endif
@@ -0,0 +1,105 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <UploadScheduler.h>
+
+UploadScheduler::UploadScheduler() {
+    _period        = 60 * 1000;
+    _blockOff      = 15 * 1000;
+    _blockOn       = 45 * 1000;
+    _next          = 0;
+    _windowArmed   = false;
+    _windowStart   = 0;
+    _windowEnd     = 0;
+    _motionSent    = false;
+}
+
+void UploadScheduler::configure(uint32_t period, uint32_t blockOff, uint32_t blockOn) {
+    _period   = period;
+    _blockOff = blockOff;
+    _blockOn  = blockOn;
+}
+
+void UploadScheduler::begin(uint32_t now) {
+    _next        = now + _period;
+    _windowArmed = false;
+}
+
+// True once per period. Periods missed while the caller was busy are
+// skipped, like a Ticker flag that is set again before it is consumed.
+bool UploadScheduler::pollSensor(uint32_t now) {
+    if ((int32_t)(now - _next) < 0) {
+        return false;
+    }
+
+    do {
+        _next += _period;
+    } while ((int32_t)(now - _next) >= 0);
+
+    return true;
+}
+
+// The sensor upload is due at once, the period restarts from it.
+void UploadScheduler::expedite(uint32_t now) { _next = now; }
+
+// The motion window is timed from the end of the sensor upload.
+void UploadScheduler::sensorSent(uint32_t now) {
+    _windowArmed = true;
+    _windowStart = now + _blockOff;
+    _windowEnd   = now + _blockOn;
+    _motionSent  = false;
+}
+
+bool UploadScheduler::isBlocked(uint32_t now) const {
+    if (!_windowArmed) {
+        return true;
+    }
+
+    return (int32_t)(now - _windowStart) < 0 || (int32_t)(now - _windowEnd) >= 0;
+}
+
+bool UploadScheduler::pollMotion(uint32_t now) const {
+    return !_motionSent && !isBlocked(now);
+}
+
+// Closes the window whether or not the upload got through.
+void UploadScheduler::motionSent(void) {
+    _motionSent = true;
+}
+
+// Earliest time at which pollSensor() or pollMotion() can change.
+uint32_t UploadScheduler::nextDeadline(uint32_t now) const {
+    uint32_t deadline = _next;
+
+    if (_windowArmed) {
+        if ((int32_t)(now - _windowStart) < 0 && (int32_t)(_windowStart - deadline) < 0) {
+            deadline = _windowStart;
+        }
+        if ((int32_t)(now - _windowEnd) < 0 && (int32_t)(_windowEnd - deadline) < 0) {
+            deadline = _windowEnd;
+        }
+    }
+
+    return deadline;
+}
@@ -0,0 +1,68 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Upload timing of the clock, driven by a millisecond clock from outside
+// (millis() on the device, virtual time in the simulator).
+//
+//  - a sensor upload is due every period
+//  - motion uploads are held back while blocked, and are only let through
+//    in the window from blockOff to blockOn after the last sensor upload,
+//    so the two never hit ThingSpeak's rate limit together
+//  - one motion upload per window; a failed one waits for the next window
+//  - expedite() brings the sensor upload forward, after a reconnect
+//
+// What is pending is up to the caller (see MotionLedger).
+
+class UploadScheduler {
+   public:
+    UploadScheduler();
+
+    void configure(uint32_t period, uint32_t blockOff, uint32_t blockOn);
+    void begin(uint32_t now);
+
+    bool pollSensor(uint32_t now);
+    void expedite(uint32_t now);
+    void sensorSent(uint32_t now);
+    bool isBlocked(uint32_t now) const;
+
+    bool pollMotion(uint32_t now) const;
+    void motionSent(void);
+
+    uint32_t nextDeadline(uint32_t now) const;
+
+   private:
+    uint32_t _period;
+    uint32_t _blockOff;
+    uint32_t _blockOn;
+
+    uint32_t _next;
+    bool _windowArmed;
+    uint32_t _windowStart;
+    uint32_t _windowEnd;
+    bool _motionSent;
+};
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Generates a synthetic trace for test/test_sim/ClockSim.cpp.
+
+    python3 sim/gen_trace.py --days 3 --fail 0.1 > /tmp/3days.trace
+"""
+
+import argparse
+import math
+import random
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--days", type=float, default=1.0)
+    parser.add_argument("--fail", type=float, default=0.0, help="ratio of failed uploads")
+    parser.add_argument("--outages", type=float, default=0.0, help="network outages per day")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    end = int(args.days * 86400 * 1000)
+    events = []
+
+    # BME280 once a minute, a daily temperature swing and rare I2C glitches
+    for t in range(0, end, 60 * 1000):
+        day = t / 86400000.0
+        temp = 24.0 + 3.0 * math.sin(2 * math.pi * day) + random.gauss(0, 0.05)
+        humid = 50.0 - 8.0 * math.sin(2 * math.pi * day) + random.gauss(0, 0.2)
+        press = 1013.0 + random.gauss(0, 0.1)
+        if random.random() < 0.01:
+            temp = -142.9
+        events.append((t, "bme %.2f %.2f %.2f" % (temp, humid, press)))
+
+    # PIR: people pass by during the day, mostly short presences
+    t = 0
+    while t < end:
+        hour = t / 3600000.0 % 24
+        busy = 7 <= hour < 23
+        t += int(random.expovariate(1.0 / (120000 if busy else 1800000)))
+        length = int(random.expovariate(1.0 / 8000)) + 2000
+        if end <= t + length:
+            break
+        events.append((t, "pir 1"))
+        events.append((t + length, "pir 0"))
+        t += length
+
+    # HTTP outcome changes every few minutes
+    for t in range(0, end, 5 * 60 * 1000):
+        if random.random() < args.fail:
+            # half of the failures time out after ThingSpeak stored the write
+            code = random.choice((500, -304))
+            events.append((t, "http %d %d" % (code, random.randint(2000, 15000))))
+        else:
+            events.append((t, "http 200 %d" % random.randint(300, 1500)))
+
+    # outages of 2 to 60 minutes, half of them AP losses, half DNS/TLS
+    # failures behind a working AP
+    t = 0
+    while args.outages > 0:
+        t += int(random.expovariate(args.outages / 86400000.0))
+        length = random.randint(2, 60) * 60 * 1000
+        if end <= t + length:
+            break
+        if random.random() < 0.5:
+            events.append((t, "ap 0"))
+            events.append((t + length, "ap 1"))
+        else:
+            events.append((t, "net 0 %d" % random.randint(3000, 20000)))
+            events.append((t + length, "net 1"))
+        t += length
+
+    # a tap now and then, touch readings drop from ~100 to ~40
+    for t in range(3600 * 1000, end, 3 * 3600 * 1000):
+        events.append((t, "touch 40"))
+        events.append((t + 150, "touch 100"))
+
+    events.append((end, "end"))
+    events.sort(key=lambda e: e[0])
+    for t, e in events:
+        print("%d %s" % (t, e))
+
+
+if __name__ == "__main__":
+    main()
@@ -27,80 +27,201 @@ SOFTWARE.
 #include <AutoConnect.h>
 #include <BME280Class.h>
 #include <Button2.h>
+#include <ChunkedWriter.h>
+#include <ClockLoop.h>
+#include <ComfortMetrics.h>
+#include <Connectivity.h>
+#include <DeferredLog.h>
+#include <DimmableDisplay.h>
+#include <DisplayIntensity.h>
 #include <ESPUI.h>
 #include <ESPmDNS.h>
+#include <GossipLink.h>
+#include <HTTPClient.h>
+#include <History.h>
+#include <HttpServerTask.h>
 #include <LED_DisPlay.h>
+#include <LatencyHistogram.h>
+#include <LogDrain.h>
+#include <MotionInput.h>
+#include <MotionLedger.h>
+#include <OccupancyModel.h>
+#include <NvsConfig.h>
+#include <OpenMetrics.h>
+#include <OtaUpdater.h>
+#include <Preferences.h>
+#include <Rollup.h>
+#include <SegmentFont.h>
+#include <SensorBus.h>
 #include <TM1637Display.h>
+#include <TouchEngine.h>
+#include <Trace.h>
+#include <UploadScheduler.h>
 #include <ThingSpeak.h>
 #include <Ticker.h>
+#include <TimeService.h>
 #include <WebServer.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <secrets.h>
 #include <timezone.h>
-
-#include <esp32_touch.hpp>
+#include <config.h>
 // log
 #include <esp32-hal-log.h>
+#ifdef RUN_BENCHMARKS
+#include <BenchCases.h>
+#endif
 // WiFi Connection
 #define HOSTNAME        "atom_clock"
 #define AP_NAME         "ATOM-G-AP"
-// NTP Clock
-#define TIME_ZONE       "JST-9"
+// NTP Clock, after the server of the time zone (see include/config.h)
 #define NTP_SERVER1     "ntp.nict.jp"
 #define NTP_SERVER2     "ntp.jst.mfeed.ad.jp"
-#define NTP_SERVER3     "asia.pool.ntp.org"
 // 7segLED TM1637
 #define CLK             19
 #define DIO             22
-// BME280
+// Display intensity, levels are in include/config.h
+#define DIM_FADE        3000  // [ms]
+#define PAGE_FADE       750   // [ms] environment data pages
+#define RENDER_PERIOD   20    // [ms]
+#define LIT_SEGMENTS    20    // of an average HH:MM, for the current estimate
+#define WAKE_BUDGET     100   // [ms] PIR edge to lit digits
+// BME280, indoor (0x76, the global bme280) and outdoor (0x77) on one bus
 #define SDA             25
 #define SCL             21
-// WiFi reset
+// WiFi reconnect, or reset when held
 #define BUTTON_PIN      39
+#define BUTTON_RESET    5000  // [ms]
 // PIR Detection
 #define PIR_SENSOR_PIN  23
+// Sensor gossip, a neighbour is gone after GOSSIP_MISSED periods unheard
+#define GOSSIP_MISSED   3
+#define FLEET_URL       "https://api.thingspeak.com/channels/%lu/bulk_update.json"
+#define FLEET_BODY      (64 + (GOSSIP_PEERS + 1) * 144)
 // Enable/Disable LED Display
-#define TOUCH_IO_TOGGLE 8  // GPIO33
-#define TOUCH_THRESHOLD 92
+#define TOUCH_IO_TOGGLE 33  // T8
 #define HTTP_PORT       80
 
 WebServer Server;
 AutoConnect Portal(Server);
 AutoConnectConfig Config;  // Enable autoReconnect supported on v0.9.4
-AutoConnectAux Timezone;
+ACText(tzCaption, "Sets the time zone to get the current local time.",
+       "font-family:Arial;font-weight:bold;text-align:center;margin-bottom:10px;color:DarkSlateBlue");
+ACElement(tzSelect, TZ_SELECT);
+ACElement(tzNewline, "<br>");
+ACSubmit(tzStart, "OK", "/start");
+AutoConnectAux Timezone("/timezone", "TimeZone", true, {tzCaption, tzSelect, tzNewline, tzStart});
+int64_t portalTime  = 0;  // [us] initAutoConnect()
+uint32_t portalHeap = 0;  // [bytes] at most, while in initAutoConnect()
+#ifdef HTTP_SERVER_TASK
+HttpServerTask httpServer(Portal);
+#endif
 
 Ticker clocker;
-Ticker sensorChecker;
-Ticker blockOFF;
-Ticker blockON;
+Ticker sampler;
+Ticker renderer;
 
-ESP32Touch touch;
+TouchEngine touch;
 LED_DisPlay led;
-Button2 button     = Button2(BUTTON_PIN);
-Button2 pir_sensor = Button2(PIR_SENSOR_PIN);
-TM1637Display display(CLK, DIO);
+Button2 button = Button2(BUTTON_PIN);
+DimmableDisplay display(CLK, DIO);
+DisplayIntensity intensity;
+LatencyHistogram renderLatency;
+LatencyHistogram wakeLatency;
 WiFiClientSecure _client;
-
-bool sendDataflag    = false;
-float motionTime     = 0;
-bool motionDetecting = false;
-bool blockflag       = true;
-bool sendMotionflag  = false;
+Rollup rollup;
+History history;  // also under rollupMutex
+SemaphoreHandle_t rollupMutex = NULL;
+LatencyHistogram loopLatency;
+UploadScheduler scheduler;
+OtaUpdater ota;
+NvsConfig nvs("config");
+ConfigStore config(CONFIG_TABLE, kConfigKeys);
+MotionLedger ledger;
+MotionInput motionInput;
+OccupancyModel occupancy;
+SensorBus sensors(Wire);
+LogDrain logDrain(deferredLog, Serial);
+TimeService timeService;
+BME280Class outdoor(BME280_ADDRESS);
+Connectivity connectivity;
+GossipLink gossip;
+ClockLoop clockLoop(ledger, scheduler, connectivity, intensity, occupancy, timeService);
+
+volatile bool motionDetecting = false;  // as shown, set by renderDisplay()
+volatile bool wifiAssociated  = false;  // set by wifiEvent()
+volatile bool wifiIp          = false;
+bool sampleflag               = false;
+bool sampleValid              = false;
+bool clockDisplaying          = true;
+
+enum {
+    kPageNone = 0,
+    kPageTemperature,
+    kPageHumidity,
+    kPageDewPoint,
+    kPagePressure,
+    kPageHeatIndex,
+    kPageEnd,
+};
+volatile uint8_t envPage = kPageNone;
+bool envPageShown        = false;
+
+uint32_t uploadSuccess = 0;
+uint32_t uploadFailure = 0;
+uint32_t wakeLate      = 0;
+uint32_t fleetSuccess  = 0;
+uint32_t fleetFailure  = 0;
+TelemetrySample_t gossipSample;  // as last announced
 
 unsigned long myChannelNumber = SECRET_CH_ID;
 const char* myWriteAPIKey     = SECRET_WRITE_APIKEY;
 const char* certificate       = SECRET_TS_ROOT_CA;
 
+unsigned long fleetChannelNumber = SECRET_FLEET_CH_ID;
+const char* fleetWriteAPIKey     = SECRET_FLEET_WRITE_APIKEY;
+const char gossipKey[]           = SECRET_GOSSIP_KEY;
+static_assert(sizeof(gossipKey) == GOSSIP_KEY + 1, "SECRET_GOSSIP_KEY must have 16 characters");
+
 float temperature;
 float humidity;
 float pressure;
+ComfortSample_t comfort;  // derived from the last sample
+
+// The part of loop()'s state that /metrics shows, copied at the end of
+// every loop() iteration. The HTTP task reads the copy under statusMutex,
+// never the 64-bit totals while loop() updates them.
+typedef struct {
+    bool sampleValid;
+    float temperature;
+    float humidity;
+    float pressure;
+    ComfortSample_t comfort;
+    uint64_t motionTotal;         // [us]
+    uint64_t motionAcknowledged;  // [us]
+    uint64_t motionQueued;        // [us]
+    uint32_t motionRetransmissions;
+    uint8_t motionReports;
+    bool occupancyKnown;  // false while the clock is not set
+    uint16_t occupancyLevel;
+    bool occupancyExpected;
+    uint32_t occupancyHours;
+    Connectivity::State linkState;
+    uint64_t linkTime[Connectivity::kStates];  // [ms]
+    uint32_t linkAssociations;
+    uint32_t linkAttempts;
+    uint32_t linkFailed;
+    uint32_t linkWait;  // [ms]
+    float linkCharge;   // [mAh]
+} LoopStatus_t;
+LoopStatus_t loopStatus;
+SemaphoreHandle_t statusMutex = NULL;
 
 uint16_t alarm_hour;
 uint16_t alarm_min;
 uint16_t enable_alarm;
 
-void rootPage(void) {
+String rootContent(void) {
     String content =
         "<html>"
         "<head>"
@@ -111,24 +232,586 @@ void rootPage(void) {
         "</head>"
         "<body>"
         "<h2 align=\"center\" style=\"color:blue;margin:20px;\">Hello, world</h2>"
-        "<h3 align=\"center\" style=\"color:gray;margin:10px;\">{{DateTime}}</h3>"
+        "<h3 align=\"center\" style=\"color:gray;margin:10px;\"><time datetime=\"{{ISO}}\">{{DateTime}}</time></h3>"
         "<p style=\"text-align:center;\">Reload the page to update the time.</p>"
+        "<p style=\"text-align:center;\"><a href=\"/occupancy?fmt=html\">Usual week</a></p>"
         "<p></p><p style=\"padding-top:15px;text-align:center\">" AUTOCONNECT_LINK(COG_24) "</p>"
                                                                                            "</body>"
                                                                                            "</html>";
-    static const char* wd[7] = {"Sun", "Mon", "Tue", "Wed", "Thr", "Fri", "Sat"};
-    struct tm* tm;
-    time_t t;
-    char dateTime[26];
-
-    t  = time(NULL);
-    tm = localtime(&t);
-    sprintf(dateTime, "%04d/%02d/%02d(%s) %02d:%02d:%02d.",
-            tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
-            wd[tm->tm_wday],
-            tm->tm_hour, tm->tm_min, tm->tm_sec);
-    content.replace("{{DateTime}}", String(dateTime));
-    Server.send(200, "text/html", content);
+    TimeSnapshot_t now;
+
+    timeService.read(now);
+    content.replace("{{ISO}}", now.iso);
+    content.replace("{{DateTime}}", now.web);
+
+    return content;
+}
+
+void rootPage(void) { Server.send(200, "text/html", rootContent()); }
+
+// Copies the state /metrics shows, skipped rather than wait for a scrape.
+void publishStatus(void) {
+    LoopStatus_t next;
+    uint32_t now = millis();
+    uint32_t week;
+
+    next.sampleValid           = sampleValid;
+    next.temperature           = temperature;
+    next.humidity              = humidity;
+    next.pressure              = pressure;
+    next.comfort               = comfort;
+    next.motionTotal           = ledger.getTotal(esp_timer_get_time());
+    next.motionAcknowledged    = ledger.getAcknowledged();
+    next.motionQueued          = ledger.getQueued();
+    next.motionRetransmissions = ledger.getRetransmissions();
+    next.motionReports         = ledger.getDepth();
+    next.occupancyKnown        = clockLoop.weekTime(week);
+    next.occupancyLevel        = next.occupancyKnown ? occupancy.getLevel(OccupancyModel::slot(week)) : 0;
+    next.occupancyExpected     = next.occupancyKnown && occupancy.isExpected(OccupancyModel::slot(week));
+    next.occupancyHours        = occupancy.getHours();
+    next.linkState             = connectivity.getState();
+    for (uint8_t s = 0; s < Connectivity::kStates; s++) {
+        next.linkTime[s] = connectivity.getTime((Connectivity::State)s, now);
+    }
+    next.linkAssociations = connectivity.getAssociations();
+    next.linkAttempts     = connectivity.getAttempts();
+    next.linkFailed       = connectivity.getFailed();
+    next.linkWait         = connectivity.getWait(now);
+    next.linkCharge       = connectivity.getCharge(now);
+
+    if (xSemaphoreTake(statusMutex, 0) == pdTRUE) {
+        loopStatus = next;
+        xSemaphoreGive(statusMutex);
+    }
+}
+
+void readStatus(LoopStatus_t& status) {
+    xSemaphoreTake(statusMutex, portMAX_DELAY);
+    status = loopStatus;
+    xSemaphoreGive(statusMutex);
+}
+
+// A clock may upload for the fleet while it reaches ThingSpeak.
+bool isFleetCandidate(void) {
+    Connectivity::State state = connectivity.getState();
+
+    return fleetChannelNumber != 0 && (state == Connectivity::kIp || state == Connectivity::kOnline);
+}
+
+// The node id of the clock that uploads the sensor data for everybody,
+// 0 while every clock uploads its own.
+uint32_t fleetLeader(void) {
+    if (!gossip.isRunning() || config.get(kGossip) == 0) {
+        return 0;
+    }
+
+    return gossip.leader(isFleetCandidate());
+}
+
+void rollupPage(void) {
+    Rollup::Resolution res = Rollup::k1Min;
+    if (Server.hasArg("res") && !Rollup::parse(Server.arg("res").c_str(), res)) {
+        Server.send(400, "text/plain", "res must be one of 1m, 15m, 1h, 1d");
+        return;
+    }
+
+    // Stream the buckets oldest first.
+    ChunkedWriter writer(Server);
+    writer.begin(200, "application/json");
+    writer.print("[");
+
+    char buffer[256];
+    RollupBucket_t b;
+    for (int i = rollup.available(res) - 1; 0 <= i; i--) {
+        xSemaphoreTake(rollupMutex, portMAX_DELAY);
+        rollup.get(res, i, b);
+        xSemaphoreGive(rollupMutex);
+        int len = snprintf(buffer, sizeof(buffer),
+                           "%s{\"t\":%u,\"n\":%u,\"occ\":%u,"
+                           "\"temp\":[%.2f,%.2f,%.2f],"
+                           "\"humid\":[%.2f,%.2f,%.2f],"
+                           "\"press\":[%.2f,%.2f,%.2f]}",
+                           (i == rollup.available(res) - 1) ? "" : ",", b.start, b.count, b.occupied,
+                           b.temperature.min / 100.0f, Rollup::mean(b.temperature, b.count) / 100.0f, b.temperature.max / 100.0f,
+                           b.humidity.min / 100.0f, Rollup::mean(b.humidity, b.count) / 100.0f, b.humidity.max / 100.0f,
+                           b.pressure.min / 100.0f, Rollup::mean(b.pressure, b.count) / 100.0f, b.pressure.max / 100.0f);
+        writer.write((const uint8_t*)buffer, len);
+    }
+
+    writer.print("]");
+    writer.end();
+}
+
+// A UNIX time argument, the default if it is missing.
+bool timeArg(const char* name, uint32_t fallback, uint32_t& value) {
+    if (!Server.hasArg(name)) {
+        value = fallback;
+        return true;
+    }
+
+    const String& arg = Server.arg(name);
+    char* end;
+    value = strtoul(arg.c_str(), &end, 10);
+
+    return arg.length() && *end == '\0';
+}
+
+// The minutes of /history between from and to, inclusive, as CSV, JSON or
+// TelemetryCodec frames. Only one batch is formatted at a time, under the
+// lock, and sent while sampling goes on.
+void historyPage(void) {
+    HistoryExport::Format format = HistoryExport::kCsv;
+    uint32_t from;
+    uint32_t to;
+    if (!timeArg("from", 0, from) || !timeArg("to", UINT32_MAX, to) ||
+        (Server.hasArg("fmt") && !HistoryExport::parse(Server.arg("fmt").c_str(), format))) {
+        Server.send(400, "text/plain", "from and to must be UNIX times, fmt one of csv, json, bin");
+        return;
+    }
+
+    ChunkedWriter writer(Server);
+    HistoryExport exporter(history, format, from, to);
+    uint8_t buffer[CHUNKED_WRITER_BUFFER];
+    size_t len;
+
+    writer.begin(200, HistoryExport::contentType(format));
+    do {
+        xSemaphoreTake(rollupMutex, portMAX_DELAY);
+        len = exporter.next(buffer, sizeof(buffer));
+        xSemaphoreGive(rollupMutex);
+        writer.write(buffer, len);
+    } while (len);
+    writer.end();
+}
+
+// The occupancy model as JSON, the share of occupied minutes and the
+// number of weeks learned per hour of the week from Sunday 00:00. With
+// ?fmt=html a week table shaded by the share, the current hour framed.
+void occupancyPage(void) {
+    static const char* DAYS[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    ChunkedWriter writer(Server);
+    uint32_t week = 0;
+    int slot      = clockLoop.weekTime(week) ? OccupancyModel::slot(week) : -1;
+    char buffer[128];
+    int len;
+
+    if (Server.arg("fmt") == "html") {
+        writer.begin(200, "text/html");
+        writer.print("<!DOCTYPE html><html><head><meta charset=\"UTF-8\"><title>Occupancy</title></head><body>"
+                     "<table style=\"border-collapse:collapse;font:10px sans-serif\"><tr><th></th>");
+        for (uint8_t h = 0; h < 24; h++) {
+            len = snprintf(buffer, sizeof(buffer), "<th>%u</th>", h);
+            writer.write((const uint8_t*)buffer, len);
+        }
+        for (uint8_t d = 0; d < 7; d++) {
+            len = snprintf(buffer, sizeof(buffer), "</tr><tr><th>%s</th>", DAYS[d]);
+            writer.write((const uint8_t*)buffer, len);
+            for (uint8_t h = 0; h < 24; h++) {
+                uint8_t s = d * 24 + h;
+                len       = snprintf(buffer, sizeof(buffer), "<td style=\"width:20px;height:20px;background:rgba(255,96,0,%.2f)%s\"></td>",
+                                     occupancy.getLevel(s) / 65536.0, s == slot ? ";outline:2px solid #000" : "");
+                writer.write((const uint8_t*)buffer, len);
+            }
+        }
+        writer.print("</tr></table></body></html>");
+        writer.end();
+        return;
+    }
+
+    writer.begin(200, "application/json");
+    len = snprintf(buffer, sizeof(buffer), "{\"slot\":%d,\"hours\":%u,\"level\":[", slot, occupancy.getHours());
+    writer.write((const uint8_t*)buffer, len);
+    for (uint8_t s = 0; s < OCCUPANCY_SLOTS; s++) {
+        len = snprintf(buffer, sizeof(buffer), "%s%.3f", s ? "," : "", occupancy.getLevel(s) / 65536.0);
+        writer.write((const uint8_t*)buffer, len);
+    }
+    writer.print("],\"weeks\":[");
+    for (uint8_t s = 0; s < OCCUPANCY_SLOTS; s++) {
+        len = snprintf(buffer, sizeof(buffer), "%s%u", s ? "," : "", occupancy.getWeeks(s));
+        writer.write((const uint8_t*)buffer, len);
+    }
+    writer.print("]}");
+    writer.end();
+}
+
+// This clock and the neighbours it hears, with their latest readings.
+void gossipPage(void) {
+    GossipPeer_t peers[GOSSIP_PEERS];
+    uint8_t count = gossip.peers(peers, GOSSIP_PEERS);
+    uint32_t now  = millis();
+    ChunkedWriter writer(Server);
+    char buffer[192];
+
+    writer.begin(200, "application/json");
+    int len = snprintf(buffer, sizeof(buffer), "{\"node\":\"%08x\",\"port\":%u,\"leader\":\"%08x\",\"peers\":[",
+                       gossip.getNode(), gossip.getPort(), fleetLeader());
+    writer.write((const uint8_t*)buffer, len);
+    for (uint8_t i = 0; i < count; i++) {
+        const GossipFrame_t& f = peers[i].frame;
+        len                    = snprintf(buffer, sizeof(buffer),
+                       "%s{\"node\":\"%08x\",\"age\":%u,\"flags\":%u,\"t\":%u,"
+                       "\"temp\":%.2f,\"humid\":%.2f,\"press\":%.2f,\"occ\":%u}",
+                       i ? "," : "", f.node, now - peers[i].seenAt, f.flags, f.sample.time,
+                       TelemetryCodec::temperature(f.sample), TelemetryCodec::humidity(f.sample),
+                       TelemetryCodec::pressure(f.sample), f.sample.motion);
+        writer.write((const uint8_t*)buffer, len);
+    }
+    writer.print("]}");
+    writer.end();
+}
+
+// GET /config lists the settings, GET /config?<key>=<value>&... sets them
+// first. Nothing is set unless every pair is valid.
+void configPage(void) {
+    int32_t values[CONFIG_MAX_KEYS];
+    int8_t keys[CONFIG_MAX_KEYS];
+    int n = 0;
+
+    for (int i = 0; i < Server.args() && n < CONFIG_MAX_KEYS; i++) {
+        String value = Server.arg(i);
+        char* end;
+
+        keys[n]   = config.find(Server.argName(i).c_str());
+        values[n] = strtol(value.c_str(), &end, 10);
+        if (keys[n] < 0 || value.length() == 0 || *end != 0 ||
+            values[n] < config.key(keys[n]).lower || config.key(keys[n]).upper < values[n]) {
+            Server.send(400, "text/plain", "unknown key or value out of range: " + Server.argName(i));
+            return;
+        }
+        n++;
+    }
+    for (int i = 0; i < n; i++) {
+        config.set(keys[i], values[i], millis());
+    }
+
+    ChunkedWriter writer(Server);
+    writer.begin(200, "application/json");
+    writer.print("{");
+
+    char buffer[128];
+    for (uint8_t i = 0; i < config.count(); i++) {
+        const ConfigKey_t& key = config.key(i);
+        int len                = snprintf(buffer, sizeof(buffer), "%s\"%s\":{\"value\":%d,\"default\":%d,\"lower\":%d,\"upper\":%d}",
+                                          i ? "," : "", key.name, config.get(i), key.value, key.lower, key.upper);
+        writer.write((const uint8_t*)buffer, len);
+    }
+
+    writer.print("}");
+    writer.end();
+}
+
+// POST /update with url=<image>&sha256=<hex> starts an update, with the
+// portal's credentials. The reply and /metrics show how it goes.
+void updatePage(void) {
+    static const char* STATE[] = {"idle", "downloading", "rebooting", "failed"};
+
+    if (!Server.authenticate(Config.username.c_str(), Config.password.c_str())) {
+        Server.requestAuthentication(DIGEST_AUTH);
+        return;
+    }
+    if (!Server.hasArg("url") || !ota.begin(Server.arg("url"), Server.arg("sha256"))) {
+        Server.send(400, "text/plain", "busy, no url, or sha256 is not 64 hex digits");
+        return;
+    }
+    // The transfer gets the CPU and the network to itself.
+    led.requestStop();
+    led.join();
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "{\"state\":\"%s\",\"error\":\"%s\",\"size\":%u,\"written\":%u,\"throughput\":%u,\"pending\":%s}",
+             STATE[ota.getState()], ota.getError(), ota.getSize(), ota.getWritten(), ota.getThroughput(),
+             ota.isPending() ? "true" : "false");
+    Server.send(202, "application/json", buffer);
+}
+
+// Per device on the sensor bus, labelled with the I2C address.
+void metricsSensors(OpenMetrics& metrics) {
+    static const char* CHANNEL[] = {"temperature", "humidity", "pressure"};
+    char label[40];
+
+    metrics.family("sensor_present", "gauge", "1 while the sensor answers on the bus.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        snprintf(label, sizeof(label), "address=\"0x%02x\"", sensors.device(i).getAddress());
+        metrics.sample("sensor_present", sensors.device(i).isPresent(), label);
+    }
+    metrics.family("sensor_healthy", "gauge", "0 after consecutive bus errors or timeouts.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        snprintf(label, sizeof(label), "address=\"0x%02x\"", sensors.device(i).getAddress());
+        metrics.sample("sensor_healthy", sensors.isHealthy(i), label);
+    }
+    metrics.family("sensor_bus_errors", "counter", "NACKs and short reads.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        snprintf(label, sizeof(label), "address=\"0x%02x\"", sensors.device(i).getAddress());
+        metrics.sample("sensor_bus_errors", sensors.getHealth(i).errors, label, "_total");
+    }
+    metrics.family("sensor_timeouts", "counter", "Conversions not finished in time.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        snprintf(label, sizeof(label), "address=\"0x%02x\"", sensors.device(i).getAddress());
+        metrics.sample("sensor_timeouts", sensors.getHealth(i).timeouts, label, "_total");
+    }
+    metrics.family("sensor_rejected_samples", "counter", "Samples rejected by the sensor filter.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        SensorFilter& filter = sensors.device(i).getFilter();
+        for (uint8_t c = 0; c < SensorFilter::kChannels; c++) {
+            snprintf(label, sizeof(label), "address=\"0x%02x\",channel=\"%s\"", sensors.device(i).getAddress(), CHANNEL[c]);
+            metrics.sample("sensor_rejected_samples", filter.channel(c).getRejected(), label, "_total");
+        }
+    }
+    metrics.family("sensor_limited_samples", "counter", "Samples held back by the rate of change limit.");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        SensorFilter& filter = sensors.device(i).getFilter();
+        for (uint8_t c = 0; c < SensorFilter::kChannels; c++) {
+            snprintf(label, sizeof(label), "address=\"0x%02x\",channel=\"%s\"", sensors.device(i).getAddress(), CHANNEL[c]);
+            metrics.sample("sensor_limited_samples", filter.channel(c).getLimited(), label, "_total");
+        }
+    }
+
+    float t, h, p;
+    metrics.family("sensor_temperature_celsius", "gauge", "Temperature of every sensor.", "celsius");
+    for (uint8_t i = 0; i < sensors.count(); i++) {
+        if (sensors.getSample(i, t, h, p)) {
+            snprintf(label, sizeof(label), "address=\"0x%02x\"", sensors.device(i).getAddress());
+            metrics.sample("sensor_temperature_celsius", t, label);
+        }
+    }
+    metrics.counter("sensor_bus_cycles", "Bus cycles since boot.", sensors.getCycles());
+    metrics.gauge("sensor_cycle_seconds", "Duration of the last bus cycle.", sensors.getCycleTime() / 1000000.0, "seconds");
+}
+
+void metricsOccupancy(OpenMetrics& metrics, const LoopStatus_t& status) {
+    if (status.occupancyKnown) {
+        metrics.gauge("occupancy_level", "Usual share of occupied minutes in this hour of the week.", status.occupancyLevel / 65536.0);
+        metrics.gauge("occupancy_expected", "1 when people usually come in this hour of the week.", status.occupancyExpected);
+    }
+    metrics.counter("occupancy_hours", "Hours learned by the occupancy model since boot.", status.occupancyHours);
+}
+
+void metricsConnectivity(OpenMetrics& metrics, const LoopStatus_t& status) {
+    char label[24];
+
+    metrics.family("connectivity_state", "gauge", "1 for the current link state.");
+    for (uint8_t s = 0; s < Connectivity::kStates; s++) {
+        snprintf(label, sizeof(label), "state=\"%s\"", Connectivity::name((Connectivity::State)s));
+        metrics.sample("connectivity_state", status.linkState == s, label);
+    }
+    metrics.family("connectivity_state_seconds", "counter", "Time spent in each link state.", "seconds");
+    for (uint8_t s = 0; s < Connectivity::kStates; s++) {
+        snprintf(label, sizeof(label), "state=\"%s\"", Connectivity::name((Connectivity::State)s));
+        metrics.sample("connectivity_state_seconds", status.linkTime[s] / 1000.0, label, "_total");
+    }
+    metrics.counter("connectivity_associations", "Joins of the AP started.", status.linkAssociations);
+    metrics.counter("connectivity_attempts", "Upload attempts.", status.linkAttempts);
+    metrics.counter("connectivity_attempts_failed", "Upload attempts that did not reach the server.", status.linkFailed);
+    metrics.gauge("connectivity_backoff_seconds", "Time until the next upload or join may be tried.", status.linkWait / 1000.0, "seconds");
+    metrics.counter("connectivity_radio_milliamp_hours", "Estimated charge drawn by the radio.", status.linkCharge);
+}
+
+void metricsGossip(OpenMetrics& metrics) {
+    static const char* RESULT[] = {"accepted", "malformed", "forged", "replayed", "own", "full"};
+    GossipPeer_t peers[GOSSIP_PEERS];
+    char label[24];
+
+    metrics.gauge("gossip_peers", "Neighbours heard within the timeout.", gossip.peers(peers, GOSSIP_PEERS));
+    metrics.gauge("gossip_leader", "1 while this clock uploads for the fleet.", fleetLeader() == gossip.getNode());
+    metrics.counter("gossip_frames_sent", "Frames multicast.", gossip.getSent());
+    metrics.family("gossip_frames_received", "counter", "Frames received by result.");
+    for (uint8_t r = 0; r < Gossip::kResults; r++) {
+        snprintf(label, sizeof(label), "result=\"%s\"", RESULT[r]);
+        metrics.sample("gossip_frames_received", gossip.getCount((Gossip::Result)r), label, "_total");
+    }
+    metrics.counter("gossip_evictions", "Neighbours dropped after the timeout.", gossip.getEvicted());
+    metrics.family("fleet_uploads", "counter", "Bulk writes to the fleet channel by result.");
+    metrics.sample("fleet_uploads", fleetSuccess, "result=\"success\"", "_total");
+    metrics.sample("fleet_uploads", fleetFailure, "result=\"failure\"", "_total");
+}
+
+// The whole exposition, to the response or to the bench.
+void metricsContent(Print& out) {
+    OpenMetrics metrics(out, "atom_clock_");
+    LoopStatus_t status;
+
+    readStatus(status);
+    if (status.sampleValid) {
+        metrics.gauge("temperature_celsius", "BME280 temperature.", status.temperature, "celsius");
+        metrics.gauge("humidity_percent", "BME280 relative humidity.", status.humidity, "percent");
+        metrics.gauge("pressure_hectopascals", "BME280 pressure.", status.pressure, "hectopascals");
+        metrics.gauge("pressure_sea_level_hectopascals", "Pressure at sea level.", status.comfort.seaLevelPressure / 100.0, "hectopascals");
+        metrics.gauge("dew_point_celsius", "Dew point.", status.comfort.dewPoint / 100.0, "celsius");
+        metrics.gauge("heat_index_celsius", "NOAA heat index.", status.comfort.heatIndex / 100.0, "celsius");
+        metrics.gauge("absolute_humidity_grams_per_cubic_meter", "Water vapour density.", status.comfort.absoluteHumidity / 100.0, "grams_per_cubic_meter");
+    }
+    metricsSensors(metrics);
+
+    metrics.gauge("motion_detecting", "1 while the PIR sensor detects motion.", motionDetecting);
+    metrics.gauge("motion_pending_seconds", "Occupancy time not acknowledged by ThingSpeak yet.", (status.motionTotal - status.motionAcknowledged) / 1000000.0, "seconds");
+    metrics.counter("motion_acknowledged_seconds", "Occupancy time acknowledged by ThingSpeak.", status.motionAcknowledged / 1000000.0);
+    metrics.counter("motion_retransmissions", "Motion reports sent again after a failure.", status.motionRetransmissions);
+    metrics.gauge("motion_reports_queued", "Motion reports waiting for an acknowledgement.", status.motionReports);
+    metrics.gauge("motion_queued_seconds", "Occupancy time in the reports waiting for an acknowledgement.", status.motionQueued / 1000000.0, "seconds");
+    metrics.counter("motion_edges", "PIR edges seen by the interrupt.", motionInput.getEdges());
+    metrics.counter("motion_edges_lost", "PIR edges overwritten before they were read.", motionInput.getOverruns());
+    metricsOccupancy(metrics, status);
+
+    metrics.gauge("touch_raw", "Touch pad reading.", touch.getRaw());
+    metrics.gauge("touch_baseline", "Tracked untouched touch pad level.", touch.getBaseline());
+    metrics.family("touch_gestures", "counter", "Classified touch gestures.");
+    metrics.sample("touch_gestures", touch.getCount(TouchEngine::kTap), "gesture=\"tap\"", "_total");
+    metrics.sample("touch_gestures", touch.getCount(TouchEngine::kDoubleTap), "gesture=\"double_tap\"", "_total");
+    metrics.sample("touch_gestures", touch.getCount(TouchEngine::kLongPress), "gesture=\"long_press\"", "_total");
+
+    metrics.gauge("wifi_rssi_dbm", "WiFi signal strength.", WiFi.RSSI(), "dbm");
+    metricsConnectivity(metrics, status);
+    metricsGossip(metrics);
+    metrics.gauge("heap_free_bytes", "Free heap.", ESP.getFreeHeap(), "bytes");
+    metrics.gauge("heap_min_free_bytes", "Low water mark of the free heap.", ESP.getMinFreeHeap(), "bytes");
+    metrics.gauge("heap_max_alloc_bytes", "Largest allocatable heap block.", ESP.getMaxAllocHeap(), "bytes");
+    metrics.gauge("uptime_seconds", "Time since boot.", esp_timer_get_time() / 1000000.0, "seconds");
+    metrics.gauge("boot_portal_seconds", "Duration of initAutoConnect() at boot, with the WiFi join.", portalTime / 1000000.0, "seconds");
+    metrics.gauge("boot_portal_heap_bytes", "Heap taken at most in initAutoConnect() at boot.", portalHeap, "bytes");
+    metrics.histogram("loop_duration_seconds", "Duration of one loop() iteration.", loopLatency);
+#ifdef HTTP_SERVER_TASK
+    metrics.counter("http_polls", "Polls of the web server by its task.", httpServer.getPolls());
+#endif
+
+    uint8_t level = intensity.getLevel();
+    metrics.gauge("display_level", "Display intensity on a perceptual 0-255 scale.", level);
+    metrics.gauge("display_current_milliamps", "Estimated current of the 7-segment display and the LED.",
+                  DisplayIntensity::tm1637Current(level, LIT_SEGMENTS) + DisplayIntensity::ws2812Current(led.Brightness, 255, 1), "milliamps");
+    metrics.histogram("display_render_seconds", "Duration of one display render tick.", renderLatency);
+    metrics.histogram("display_wake_seconds", "PIR edge to the display showing it.", wakeLatency);
+    metrics.counter("display_wake_late", "Wakes slower than the budget.", wakeLate);
+
+    metrics.gauge("ota_written_bytes", "Bytes of the OTA image written so far.", ota.getWritten(), "bytes");
+    metrics.gauge("ota_throughput_bytes_per_second", "Transfer rate of the last OTA download.", ota.getThroughput());
+    metrics.gauge("ota_pending", "1 while this image has not passed the health probe.", ota.isPending());
+
+    metrics.counter("log_records", "Deferred log records written.", deferredLog.getRecords());
+    metrics.counter("log_records_lost", "Deferred log records overwritten before they were read.", deferredLog.getLost());
+    metrics.counter("trace_records", "Trace events recorded.", trace.getRecords());
+    metrics.counter("trace_records_lost", "Trace events overwritten while they were read.", trace.getLost());
+    metrics.counter("config_flash_writes", "Settings written to NVS.", config.getWrites());
+    metrics.gauge("history_minutes", "Minutes kept for /history.", history.count());
+    metrics.counter("config_write_failures", "Settings that could not be written to NVS.", config.getFailures());
+
+    metrics.family("uploads", "counter", "ThingSpeak writes by result.");
+    metrics.sample("uploads", uploadSuccess, "result=\"success\"", "_total");
+    metrics.sample("uploads", uploadFailure, "result=\"failure\"", "_total");
+
+    if (timeService.getSteppedAt()) {
+        metrics.gauge("clock_step_age_seconds", "Time since the wall clock was first set or last stepped by more than 1 s.", time(NULL) - timeService.getSteppedAt(), "seconds");
+    }
+    metrics.counter("time_conversions", "localtime_r() calls of the time service.", timeService.getConversions());
+
+    metrics.end();
+}
+
+void metricsPage(void) {
+    ChunkedWriter writer(Server);
+
+    writer.begin(200, "application/openmetrics-text; version=1.0.0; charset=utf-8");
+    metricsContent(writer);
+    writer.end();
+}
+
+// The deferred log records still in the rings, as text, or raw for
+// tools/log_decode.py (?fmt=bin). ?bench compares the cost of one record
+// with one log_d() [CPU cycles].
+void logPage(void) {
+    ChunkedWriter writer(Server);
+    DeferredLog::Cursor cursors[DEFERRED_LOG_CORES];
+    LogRecord_t record;
+
+    if (Server.hasArg("bench")) {
+        const uint8_t CALLS = 16;
+        char buffer[64];
+
+        uint32_t start = ESP.getCycleCount();
+        for (uint8_t i = 0; i < CALLS; i++) {
+            DLOG_RECORD('D', "bench %u %2.1f", i, temperature);
+        }
+        uint32_t deferred = (ESP.getCycleCount() - start) / CALLS;
+
+        start = ESP.getCycleCount();
+        for (uint8_t i = 0; i < CALLS; i++) {
+            log_d("bench %u %2.1f", i, temperature);
+        }
+        uint32_t direct = (ESP.getCycleCount() - start) / CALLS;
+
+        snprintf(buffer, sizeof(buffer), "{\"deferred\":%u,\"log_d\":%u}", deferred, direct);
+        Server.send(200, "application/json", buffer);
+        return;
+    }
+
+    for (uint8_t c = 0; c < DEFERRED_LOG_CORES; c++) {
+        cursors[c] = deferredLog.oldest(c);
+    }
+
+    if (Server.arg("fmt") == "bin") {
+        const uint32_t header[] = {DEFERRED_LOG_MAGIC, DEFERRED_LOG_WORDS};
+
+        writer.begin(200, "application/octet-stream");
+        writer.write((const uint8_t*)header, sizeof(header));
+        while (deferredLog.read(cursors, record)) {
+            writer.write((const uint8_t*)&record, sizeof(record));
+        }
+    } else {
+        char line[LOG_DRAIN_LINE];
+
+        writer.begin(200, "text/plain");
+        while (deferredLog.read(cursors, record)) {
+            LogDrain::print(record, line, sizeof(line));
+            writer.println(line);
+        }
+    }
+    writer.end();
+}
+
+// The trace rings as Chrome trace JSON, for chrome://tracing or
+// ui.perfetto.dev. ?bench returns the cost of a record in CPU cycles.
+void tracePage(void) {
+    if (Server.hasArg("bench")) {
+        const uint8_t CALLS = 16;
+        char buffer[64];
+
+        uint32_t start = ESP.getCycleCount();
+        for (uint8_t i = 0; i < CALLS; i++) {
+            TRACE_INSTANT("bench");
+        }
+        uint32_t instant = (ESP.getCycleCount() - start) / CALLS;
+
+        start = ESP.getCycleCount();
+        for (uint8_t i = 0; i < CALLS; i++) {
+            TRACE_SCOPE("bench");  // shorter than TRACE_MIN_SPAN, not recorded
+        }
+        uint32_t scope = (ESP.getCycleCount() - start) / CALLS;
+
+        snprintf(buffer, sizeof(buffer), "{\"instant\":%u,\"scope\":%u}", instant, scope);
+        Server.send(200, "application/json", buffer);
+        return;
+    }
+
+    ChunkedWriter writer(Server);
+    TraceExport exporter(trace);
+    char buffer[CHUNKED_WRITER_BUFFER];
+    size_t len;
+
+    writer.begin(200, "application/json");
+    while ((len = exporter.next(buffer, sizeof(buffer))) > 0) {
+        writer.write((const uint8_t*)buffer, len);
+    }
+    writer.end();
+}
+
+// The index into TZ, -1 for an unknown zone.
+int findTimezone(const String& zone) {
+    for (uint8_t n = 0; n < sizeof(TZ) / sizeof(Timezone_t); n++) {
+        if (strcasecmp(zone.c_str(), TZ[n].zone) == 0) {
+            return n;
+        }
+    }
+
+    return -1;
 }
 
 void startPage(void) {
@@ -136,14 +819,10 @@ void startPage(void) {
     // Values are accessible with the element name.
     String tz = Server.arg("timezone");
 
-    for (uint8_t n = 0; n < sizeof(TZ) / sizeof(Timezone_t); n++) {
-        String tzName = String(TZ[n].zone);
-        if (tz.equalsIgnoreCase(tzName)) {
-            configTime(TZ[n].tzoff * 3600, 0, TZ[n].ntpServer);
-            log_d("Time zone: %s", tz.c_str());
-            log_d("ntp server: %s", String(TZ[n].ntpServer).c_str());
-            break;
-        }
+    int n = findTimezone(tz);
+    if (n >= 0) {
+        config.set(kTimezone, n, millis());  // applied by applyConfig()
+        log_d("Time zone: %s", tz.c_str());
     }
 
     // The /start page just constitutes timezone,
@@ -174,88 +853,100 @@ void otaPage(void) {
 
 void displayOn(void) {
     display.clear();
-    display.setBrightness(7, true);
+    intensity.setScene(255, 0, millis());
 }
 
 void displayOff(void) {
     display.clear();
-    display.setBrightness(7, false);
+    intensity.setScene(0, 0, millis());
 }
 
-void sendThingSpeakChannel(float temperature, float humidity, float pressure) {
+// ThingSpeak returns -301 when the connect (DNS, TCP or TLS) fails. Any
+// other error got as far as the server.
+Connectivity::Outcome uploadOutcome(int code) {
+    if (code == 200) {
+        return Connectivity::kSucceeded;
+    }
+
+    return code == -301 ? Connectivity::kFailed : Connectivity::kRejected;
+}
+
+int writeThingSpeak(void) {
+    TRACE_SCOPE("thingspeak_write");
+    uint32_t start = millis();
+
+    // write to the ThingSpeak channel
+    int code = ThingSpeak.writeFields(myChannelNumber, myWriteAPIKey);
+    connectivity.attempted(uploadOutcome(code), start, millis());
+    if (code == 200) {
+        uploadSuccess++;
+        dlog_d("Channel update successful.");
+    } else {
+        uploadFailure++;
+        dlog_d("Problem updating channel. HTTP error code %d", code);
+    }
+
+    return code;
+}
+
+void setThingSpeakFields(float temperature, float humidity, float pressure, const ComfortSample_t& comfort) {
     char buffer1[16] = {0};
     char buffer2[16] = {0};
     char buffer3[16] = {0};
+    char buffer6[16] = {0};
+    char buffer7[16] = {0};
+    char buffer8[16] = {0};
 
     sprintf(buffer1, "%2.1f", temperature);
     sprintf(buffer2, "%2.1f", humidity);
     sprintf(buffer3, "%4.1f", pressure);
+    sprintf(buffer6, "%2.1f", comfort.dewPoint / 100.0f);
+    sprintf(buffer7, "%2.1f", comfort.absoluteHumidity / 100.0f);
+    sprintf(buffer8, "%4.1f", comfort.seaLevelPressure / 100.0f);
 
     String tempe(buffer1);
     String humid(buffer2);
     String press(buffer3);
+    String dew(buffer6);
+    String absolute(buffer7);
+    String seaLevel(buffer8);
 
     ThingSpeak.setField(1, tempe);
     ThingSpeak.setField(2, humid);
     ThingSpeak.setField(3, press);
-
-    // write to the ThingSpeak channel
-    int code = ThingSpeak.writeFields(myChannelNumber, myWriteAPIKey);
-    if (code == 200)
-        log_d("Channel update successful.");
-    else
-        log_d("Problem updating channel. HTTP error code %d", code);
+    ThingSpeak.setField(6, dew);
+    ThingSpeak.setField(7, absolute);
+    ThingSpeak.setField(8, seaLevel);
 }
 
-void printTemperatureLED(float value) {
-    char buffer[16] = {0};
-    sprintf(buffer, "0x%2.0fC", value);
-
-    display.clear();
-    display.showNumberHexEx(strtol(buffer, 0, 16), (0x80 >> 2), false, 3, 1);
+void sendThingSpeakChannel(float temperature, float humidity, float pressure) {
+    setThingSpeakFields(temperature, humidity, pressure, comfort);
+    writeThingSpeak();
 }
 
-void printHumidityLED(float value) {
-    char buffer[16] = {0};
+// The reading goes to the formatter in hundredths (0.01 degC, %RH or hPa),
+// the fixed-point Comfort fields as they are.
+void printEnvLED(int32_t hundredths, uint8_t decimals, const SegmentUnit_t& unit) {
+    uint8_t segments[SEGMENT_DIGITS];
 
-    sprintf(buffer, "%2f", value);
-    String humidLed(buffer);
-    display.clear();
-    display.showNumberDecEx(humidLed.toInt(), (0x80 >> 0), false);
+    SegmentFont::format(hundredths, 2, decimals, unit, segments);
+    display.setSegments(segments);
 }
 
-void printPressureLED(float value) {
-    char buffer[16] = {0};
-
-    sprintf(buffer, "%4f", value);
-    String pressLed(buffer);
-    display.clear();
-    display.showNumberDecEx(pressLed.toInt(), (0x80 >> 0), false);
+void printEnvLED(float value, uint8_t decimals, const SegmentUnit_t& unit) {
+    printEnvLED((int32_t)lroundf(value * 100), decimals, unit);
 }
 
-void _checkSensor(void) { sendDataflag = true; }
-
-String getLEDTime(void) {
-    time_t t      = time(NULL);
-    struct tm* tm = localtime(&t);
-
-    char buffer[16] = {0};
-    sprintf(buffer, "%02d%02d", tm->tm_hour, tm->tm_min);
-
-    return String(buffer);
+// Ticker: start a bus cycle. SensorBus: the cycle is complete.
+void _triggerSensor(void) {
+    TRACE_SCOPE("sensor_trigger");
+    sensors.trigger();
 }
 
-String getTime(void) {
-    time_t t      = time(NULL);
-    struct tm* tm = localtime(&t);
-
-    char buffer[128] = {0};
-    sprintf(buffer, "%04d-%02d-%02dT%02d:%02d:%02d+0900", tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec);
-
-    return String(buffer);
-}
+void _sampleSensor(void) { sampleflag = true; }
 
 void displayClock(void) {
+    TRACE_SCOPE("display_clock");
     uint8_t dots        = 0;
     static uint8_t flag = 0;
     flag                = ~flag;
@@ -274,11 +965,19 @@ void displayClock(void) {
         }
     }
 
-    display.showNumberDecEx(getLEDTime().toInt(), dots, true);
+    TimeSnapshot_t now;
+    timeService.read(now);
+    display.showNumberDecEx(now.clock, dots, true);
 }
 
 void initClock(void) {
-    configTzTime(TIME_ZONE, NTP_SERVER1, NTP_SERVER2, NTP_SERVER3);
+    const Timezone_t& tz = TZ[config.get(kTimezone)];
+    char posix[16];
+
+    // POSIX TZ counts hours west of UTC
+    snprintf(posix, sizeof(posix), "UTC%+d", -tz.tzoff);
+    configTzTime(posix, tz.ntpServer, NTP_SERVER1, NTP_SERVER2);
+    timeService.invalidate();
 }
 
 void selectAlarmAMPM(Control* sender, int value) {
@@ -364,9 +1063,26 @@ void initESPUI(void) {
     ESPUI.begin("ATOM NTP Clock");
 }
 
+void initRollup(void) {
+    rollupMutex = xSemaphoreCreateMutex();
+    statusMutex = xSemaphoreCreateMutex();
+}
+
+void configureScheduler(void) {
+    scheduler.configure(config.get(kUploadPeriod) * 1000, config.get(kBlockOff) * 1000, config.get(kBlockOn) * 1000);
+}
+
 void initBME280(void) {
-    bme280.setup(SDA, SCL, MODE::WEATHER_STATION);
-    sensorChecker.attach(60, _checkSensor);
+    sensors.begin(SDA, SCL);
+    sensors.add(bme280, MODE::WEATHER_STATION);   // the clock's own readings
+    sensors.add(outdoor, MODE::WEATHER_STATION);  // optional, metrics only
+    sensors.onSample(_sampleSensor);
+    sensors.setCore(1);
+    sensors.start();
+
+    configureScheduler();
+    scheduler.begin(millis());
+    sampler.attach(config.get(kSamplingPeriod), _triggerSensor);
 }
 
 void connecting(void) {
@@ -379,56 +1095,129 @@ void connecting(void) {
         display.showNumberDecEx(0, (0x80 >> 4), false);
 }
 
+// A press joins the AP again at once. Held for BUTTON_RESET, the saved
+// credentials are erased and the portal comes up after the restart.
 void released(Button2& btn) {
+    if (btn.wasPressedFor() < BUTTON_RESET) {
+        log_i("Reconnect WiFi.");
+        connectivity.reconnect(millis());
+        WiFi.reconnect();
+        return;
+    }
+
     WiFi.disconnect(true, true);
     ESP.restart();
 }
 
-void pirDetected(Button2& btn) {
-    log_d("--- detected.");
-    motionDetecting = true;
-}
-void pirReleased(Button2& btn) {
-    motionTime += btn.wasPressedFor();
-    log_d("--- released: %d", motionTime);
-    motionDetecting = false;
-    sendMotionflag  = true;
+// WiFi event task
+void wifiEvent(WiFiEvent_t event) {
+    switch (event) {
+        case SYSTEM_EVENT_STA_CONNECTED:
+            wifiAssociated = true;
+            break;
+        case SYSTEM_EVENT_STA_DISCONNECTED:
+            wifiAssociated = false;
+            wifiIp         = false;
+            break;
+        case SYSTEM_EVENT_STA_GOT_IP:
+            wifiIp = true;
+            break;
+        case SYSTEM_EVENT_STA_LOST_IP:
+            wifiIp = false;
+            break;
+        default:
+            break;
+    }
 }
 
-void initButton(void) { button.setReleasedHandler(released); }
+// Runs in loop(), before the uploads. Connectivity paces the joins.
+void handleConnectivity(void) {
+    uint32_t now = millis();
 
-void initPIRSensor(void) {
-    pir_sensor.setPressedHandler(pirDetected);
-    pir_sensor.setReleasedHandler(pirReleased);
+    connectivity.link(wifiAssociated, wifiIp, now);
+    switch (connectivity.poll(now)) {
+        case Connectivity::kAssociate:
+            WiFi.reconnect();
+            break;
+        case Connectivity::kAbandon:
+            WiFi.disconnect();
+            break;
+        default:
+            break;
+    }
 }
 
-void fadeInDisplay(uint32_t ms) {
-    uint32_t period = ms / 18;
+void IRAM_ATTR pirChanged(void) {
+    motionInput.edge(digitalRead(PIR_SENSOR_PIN), esp_timer_get_time());
+}
 
-    display.setBrightness(0, false);
-    delay(period);
+void saveOccupancy(void) {
+    uint8_t blob[OCCUPANCY_BLOB];
+    size_t length = occupancy.save(blob, sizeof(blob));
+    Preferences prefs;
 
-    for (int i = 0; i < 8; i++) {
-        display.setBrightness(i, true);
-        delay(period);
+    prefs.begin("occupancy", false);
+    if (prefs.putBytes("model", blob, length) != length) {
+        log_e("Cannot save the occupancy model");
     }
+    prefs.end();
 }
 
-void fadeOutDisplay(uint32_t ms) {
-    uint32_t period = ms / 18;
+// Runs in loop(), see ClockLoop::occupancy().
+void handleOccupancy(void) {
+    if (clockLoop.occupancy(millis())) {
+        saveOccupancy();
+    }
+}
 
-    for (int i = 7; - 1 < i; i--) {
-        display.setBrightness(i, true);
-        delay(period);
+// Runs in loop(). A presence shorter than the debounce time is taken as a
+// glitch, see ClockLoop::edge().
+void handleMotion(void) {
+    static MotionInput::Cursor cursor = 0;
+    MotionEdge_t edge;
+
+    while (motionInput.read(cursor, edge)) {
+        switch (clockLoop.edge(edge)) {
+            case ClockLoop::kGlitch:
+                dlog_d("--- glitch: %u us", (uint32_t)(edge.time - clockLoop.getRise().time));
+                break;
+            case ClockLoop::kReleased:
+                dlog_d("--- released.");
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (clockLoop.settle(esp_timer_get_time())) {
+        dlog_d("--- detected.");
     }
+}
+
+void initButton(void) { button.setReleasedHandler(released); }
 
-    display.setBrightness(0, false);
-    delay(period);
+void configureLoop(void) {
+    clockLoop.configure(config.get(kPirDebounce), config.get(kPrewarm), config.get(kMotionDefer));
 }
 
-void fadeInOutDisplay(uint32_t ms) {
-    fadeInDisplay(ms);
-    fadeOutDisplay(ms);
+void initPIRSensor(void) {
+    configureLoop();
+    ledger.begin(esp_random() >> 8, esp_timer_get_time());
+    pinMode(PIR_SENSOR_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(PIR_SENSOR_PIN), pirChanged, CHANGE);
+}
+
+void initOccupancy(void) {
+    uint8_t blob[OCCUPANCY_BLOB];
+    Preferences prefs;
+
+    prefs.begin("occupancy", true);
+    size_t length = prefs.getBytes("model", blob, sizeof(blob));
+    prefs.end();
+
+    if (length && !occupancy.load(blob, length)) {
+        log_e("Occupancy model of another version, starts over");
+    }
 }
 
 void initThingSpeak(void) {
@@ -436,36 +1225,315 @@ void initThingSpeak(void) {
     ThingSpeak.begin(_client);
 }
 
+// Temperature, humidity, dew point and sea-level pressure fade in and out
+// one after another, driven by renderDisplay(); the heat index follows
+// when it is felt a degree warmer than the temperature. The clock comes back afterwards if it is on.
+// Only the render clock writes to the display from here on.
 void showEnvData(void) {
-    printTemperatureLED(temperature);
-    fadeInOutDisplay(1.5 * 1000);
+    TRACE_INSTANT("env_data");
+    clocker.detach();
+    intensity.setScene(0, 0, millis());
+    envPageShown = false;
+    envPage      = kPageTemperature;
+}
+
+void stepEnvData(uint32_t now) {
+    if (envPage == kPageNone || !intensity.isSceneDone(now)) {
+        return;
+    }
+
+    if (envPageShown) {
+        envPageShown = false;
+        envPage++;
+        intensity.setScene(0, PAGE_FADE, now);
+        return;
+    }
+
+    switch (envPage) {
+        case kPageTemperature:
+            printEnvLED(temperature, 1, UNIT_CELSIUS);
+            break;
+        case kPageHumidity:
+            printEnvLED(humidity, 0, UNIT_PERCENT);
+            break;
+        case kPageDewPoint:
+            printEnvLED(comfort.dewPoint, 1, UNIT_DEW_POINT);
+            break;
+        case kPagePressure:
+            printEnvLED((int32_t)comfort.seaLevelPressure, 0, UNIT_HECTOPASCAL);
+            break;
+        case kPageHeatIndex:
+            if (comfort.heatIndex - lroundf(temperature * 100) >= 100) {
+                printEnvLED(comfort.heatIndex, 1, UNIT_HEAT_INDEX);
+                break;
+            }
+            // fall through
+        default:
+            envPage = kPageNone;
+            if (clockDisplaying) {
+                displayOn();
+                clocker.attach_ms(500, displayClock);
+            } else {
+                displayOff();
+            }
+            return;
+    }
+    envPageShown = true;
+    intensity.setScene(255, PAGE_FADE, now);
+}
+
+// Runs on the render clock: interpolates the fades and auto dimming, and
+// writes the brightness only when the hardware level changes. It is also
+// the writer of timeService.
+// PIR edges are taken here rather than in loop(), so waking the display
+// takes at most one RENDER_PERIOD whatever loop() is doing.
+void renderDisplay(void) {
+    TRACE_SCOPE("render");
+    static uint8_t shownLevel         = 0xFF;
+    static MotionInput::Cursor cursor = 0;
+
+    uint32_t start = micros();
+    uint32_t now   = millis();
+    uint64_t rise  = 0;
+
+    MotionEdge_t edge;
+    while (motionInput.read(cursor, edge)) {
+        intensity.motion(edge.level, now);
+        motionDetecting = edge.level;
+        if (edge.level) {
+            rise = edge.time;
+        }
+    }
 
-    printHumidityLED(humidity);
-    fadeInOutDisplay(1.5 * 1000);
+    stepEnvData(now);
+    uint8_t level = clockLoop.render(now, time(NULL), esp_timer_get_time());
+
+    if (level != shownLevel) {
+        uint8_t brightness;
+        bool on = DisplayIntensity::tm1637(level, brightness);
+
+        if (on != display.isOn() || brightness != display.getBrightness()) {
+            display.setLevel(brightness, on);
+        }
+        led.setDimming(level);
+        shownLevel = level;
+    }
+
+    if (rise) {
+        uint32_t latency = esp_timer_get_time() - rise;
+        wakeLatency.record(latency);
+        if (latency > WAKE_BUDGET * 1000) {
+            wakeLate++;
+        }
+    }
+
+    renderLatency.record(micros() - start);
+}
+
+void configureIntensity(void) {
+    intensity.configure(config.get(kDisplayDay), config.get(kDisplayNight), config.get(kDisplayIdle),
+                        config.get(kNightStart), config.get(kNightEnd), config.get(kIdleTimeout) * 60 * 1000,
+                        config.get(kBlankTimeout) * 60 * 1000, DIM_FADE);
+}
 
-    printPressureLED(pressure);
-    fadeInOutDisplay(1.5 * 1000);
+void initDisplay(void) {
+    configureIntensity();
+    intensity.activity(millis());
+    renderer.attach_ms(RENDER_PERIOD, renderDisplay);
+}
+
+void sampleSensor(void) {
+    TRACE_SCOPE("sample");
+    if (!sensors.getSample(0, temperature, humidity, pressure)) {
+        sampleValid = false;  // nothing is uploaded or rolled up until it is back
+        return;
+    }
+    sampleValid = true;
+    ComfortMetrics::derive(TelemetryCodec::toSample(0, temperature, humidity, pressure, 0), config.get(kAltitude), comfort);
+
+    time_t t = time(NULL);
+    if (t < TIME_SERVICE_VALID) {  // not synchronized with NTP yet
+        return;
+    }
+
+    uint16_t motion = motionDetecting ? config.get(kSamplingPeriod) : 0;
+    xSemaphoreTake(rollupMutex, portMAX_DELAY);
+    RollupBucket_t b;
+    if (rollup.add(TelemetryCodec::toSample(t, temperature, humidity, pressure, motion)) && rollup.get(Rollup::k1Min, 0, b)) {
+        history.append(Rollup::toSample(b));  // the minute this sample closed
+    }
+    xSemaphoreGive(rollupMutex);
 }
 
 void sendThingSpeakData(void) {
-    if (bme280.getTemperature(temperature) && bme280.getHumidity(humidity) && bme280.getPressure(pressure)) {
+    if (sampleValid) {
         sendThingSpeakChannel(temperature, humidity, pressure);
     } else {
         log_e("temperature = %f, humidity = %f, pressure = %f", temperature, humidity, pressure);
     }
 }
 
-void sendMotionTime(float time) {
-    float min = time / 1000 / 60;
+// Sends the oldest unacknowledged motion report. Field 5 carries its
+// sequence number, so a report that got through but was not acknowledged
+// can be told apart from the retransmission.
+void sendMotionReport(void) {
+    MotionReport_t report;
 
-    ThingSpeak.setField(4, min);  // ms to min
+    if (!ledger.cut(esp_timer_get_time()) || !ledger.peek(report)) {
+        return;
+    }
 
-    // write to the ThingSpeak channel
-    int code = ThingSpeak.writeFields(myChannelNumber, myWriteAPIKey);
-    if (code == 200)
-        log_d("Channel update successful.");
-    else
-        log_d("Problem updating channel. HTTP error code %d", code);
+    ThingSpeak.setField(4, (float)(report.occupied / 1000000.0 / 60.0));  // us to min
+    ThingSpeak.setField(5, (long)report.seq);
+
+    int code = writeThingSpeak();
+    ledger.sent(report.seq, code == 200);
+
+    dlog_i("motion report #%u: %llu us, attempt %u, HTTP %d", report.seq, report.occupied, report.attempts + 1, code);
+}
+
+// Runs in loop(). Gossip starts once the clock has an address and sends
+// the latest reading every gossip seconds. The motion field carries the
+// occupied seconds since the frame before.
+void handleGossip(void) {
+    static uint32_t sentAt   = 0;
+    static uint64_t motionAt = 0;  // [us] of the ledger total, sent so far
+    uint32_t period          = config.get(kGossip) * 1000;
+    uint32_t now             = millis();
+
+    if (period == 0 || now - sentAt < period || connectivity.getState() < Connectivity::kIp) {
+        return;
+    }
+    sentAt = now;
+
+    // The ids of the ESP32s of one maker differ in the low bytes of the MAC.
+    if (!gossip.begin((const uint8_t*)gossipKey, (uint32_t)(ESP.getEfuseMac() >> 16), period * GOSSIP_MISSED)) {
+        return;
+    }
+
+    uint64_t total  = ledger.getTotal(esp_timer_get_time());
+    uint16_t motion = min((total - motionAt) / 1000000, (uint64_t)UINT16_MAX);
+    motionAt += motion * 1000000ULL;
+
+    uint8_t flags = (isFleetCandidate() ? kGossipCandidate : 0) | (sampleValid ? kGossipValid : 0);
+    gossipSample  = TelemetryCodec::toSample(time(NULL), temperature, humidity, pressure, motion);
+    gossip.announce(gossipSample, flags);
+}
+
+// The latest reading of every clock in one bulk update, oldest first.
+// Field 5 tells the clocks apart.
+size_t fleetBody(char* body, size_t size) {
+    GossipFrame_t frames[GOSSIP_PEERS + 1];
+    GossipPeer_t peers[GOSSIP_PEERS];
+    uint8_t count = 0;
+
+    if (sampleValid) {
+        frames[count].node   = gossip.getNode();
+        frames[count].sample = gossipSample;
+        count++;
+    }
+    uint8_t n = gossip.peers(peers, GOSSIP_PEERS);
+    for (uint8_t i = 0; i < n; i++) {
+        if (peers[i].frame.flags & kGossipValid) {
+            frames[count++] = peers[i].frame;
+        }
+    }
+    for (uint8_t i = 1; i < count; i++) {
+        GossipFrame_t f = frames[i];
+        uint8_t j       = i;
+        for (; j > 0 && frames[j - 1].sample.time > f.sample.time; j--) {
+            frames[j] = frames[j - 1];
+        }
+        frames[j] = f;
+    }
+
+    size_t len = snprintf(body, size, "{\"write_api_key\":\"%s\",\"updates\":[", fleetWriteAPIKey);
+    for (uint8_t i = 0; i < count && len < size; i++) {
+        const TelemetrySample_t& s = frames[i].sample;
+        time_t t                   = s.time;
+        struct tm utc;
+        char iso[24];
+
+        gmtime_r(&t, &utc);
+        strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        len += snprintf(&body[len], size - len,
+                        "%s{\"created_at\":\"%s\",\"field1\":%.1f,\"field2\":%.1f,\"field3\":%.1f,\"field4\":%.2f,\"field5\":\"%08x\"}",
+                        i ? "," : "", iso, TelemetryCodec::temperature(s), TelemetryCodec::humidity(s),
+                        TelemetryCodec::pressure(s), s.motion / 60.0, frames[i].node);
+    }
+    if (len + 3 > size) {
+        return 0;
+    }
+    len += snprintf(&body[len], size - len, "]}");
+
+    return len;
+}
+
+// One TLS session for the whole fleet. HTTPClient reports a failed
+// connect as HTTPC_ERROR_CONNECTION_REFUSED, ThingSpeak answers 202.
+void sendFleetData(void) {
+    TRACE_SCOPE("fleet_upload");
+    static char body[FLEET_BODY];
+    char url[80];
+    HTTPClient http;
+    int code = HTTPC_ERROR_CONNECTION_REFUSED;
+
+    size_t length = fleetBody(body, sizeof(body));
+    if (length == 0) {
+        log_e("Fleet update does not fit");
+        return;
+    }
+
+    uint32_t start = millis();
+    snprintf(url, sizeof(url), FLEET_URL, fleetChannelNumber);
+    if (http.begin(_client, url)) {
+        http.addHeader("Content-Type", "application/json");
+        code = http.POST((uint8_t*)body, length);
+        http.end();
+    }
+
+    if (code == 200 || code == 202) {
+        connectivity.attempted(Connectivity::kSucceeded, start, millis());
+        fleetSuccess++;
+        dlog_d("Fleet update successful.");
+    } else {
+        connectivity.attempted(code == HTTPC_ERROR_CONNECTION_REFUSED ? Connectivity::kFailed : Connectivity::kRejected, start, millis());
+        fleetFailure++;
+        dlog_d("Problem updating the fleet channel. HTTP error code %d", code);
+    }
+}
+
+// Without a gossip leader every clock writes its own channel. The leader
+// writes the fleet channel for everybody and the others stay off the air.
+void uploadSensors(void) {
+    uint32_t leader = fleetLeader();
+
+    if (leader == 0) {
+        dlog_d("Clock send BME280 Data.");
+        sendThingSpeakData();
+    } else if (leader == gossip.getNode()) {
+        dlog_d("Clock send the fleet data.");
+        sendFleetData();
+    } else {
+        dlog_d("%08x sends the sensor data.", leader);
+    }
+}
+
+// The upload of the OTA health probe: since boot ThingSpeak took a write,
+// the fleet channel took one of the leader, or a follower announced its
+// sample while it hears the leader that uploads for it. A follower never
+// writes the sensor data itself, and its motion reports may be held back
+// for motion_defer.
+bool uploadAcknowledged(void) {
+    static bool acknowledged = false;
+
+    if (!acknowledged) {
+        uint32_t leader = fleetLeader();
+        acknowledged    = uploadSuccess != 0 || fleetSuccess != 0 ||
+                          (leader != 0 && leader != gossip.getNode() && gossip.getSent() != 0);
+    }
+
+    return acknowledged;
 }
 
 void setNtpClockNetworkInfo(void) {
@@ -477,35 +1545,119 @@ void setNtpClockNetworkInfo(void) {
     ThingSpeak.setStatus(networkInfo);  //ThingSpeak limits this to 255 bytes.
 }
 
-void initTouchSensor(void) {
-    static uint8_t toggle = 0;
+// A TLS session does not outlive the link. Back on the AP, the sensor
+// upload goes at once with the new address in its status line, and the
+// pending motion follows in its window.
+void connectivityChanged(Connectivity::State state, Connectivity::State previous) {
+    TRACE_INSTANT(Connectivity::name(state));
+    dlog_i("connectivity %s -> %s", Connectivity::name(previous), Connectivity::name(state));
+
+    if (state == Connectivity::kDown || state == Connectivity::kAssociating) {
+        _client.stop();
+    } else if (state == Connectivity::kIp) {
+        setNtpClockNetworkInfo();
+        scheduler.expedite(millis());
+    }
+}
+
+void initConnectivity(void) {
+    connectivity.begin(esp_random(), millis());
+    connectivity.onChange(connectivityChanged);
+    handleConnectivity();
+}
 
-    touch.configure_input(TOUCH_IO_TOGGLE, TOUCH_THRESHOLD, []() {
-        log_d("Toggling Clock LED");
+void toggleDisplay(void) {
+    dlog_d("Toggling Clock LED");
 
-        if (toggle) {
-            displayOff();
+    clockDisplaying = !clockDisplaying;
+
+    if (clockDisplaying) {
+        showEnvData();
+    } else {
+        envPage = kPageNone;
+        clocker.detach();
+        intensity.setScene(0, PAGE_FADE, millis());
+    }
+}
+
+void handleTouch(void) {
+    TouchEngine::Gesture gesture;
+
+    if (!touch.receive(gesture)) {
+        return;
+    }
+
+    switch (gesture) {
+        case TouchEngine::kTap:
+            toggleDisplay();
+            break;
+        case TouchEngine::kDoubleTap:
             showEnvData();
-            displayOn();
-            clocker.attach_ms(500, displayClock);
-        } else {
-            clocker.detach();
-            displayOff();
-        }
+            break;
+        case TouchEngine::kLongPress:
+            dlog_d("Resync NTP");
+            initClock();
+            break;
+        default:;
+    }
 
-        toggle = ~toggle;
-    });
+    intensity.activity(millis());
+}
 
-    touch.begin();
+void initTouchSensor(void) {
+    touch.begin(TOUCH_IO_TOGGLE, config.get(kTouchPress), config.get(kTouchRelease));
 }
 
 void initLED(void) {
     led.begin(1);  // for ATOM Lite
     led.setTaskName("ATOM_LITE_LED");
+    led.setTaskSize(4096);
     led.setTaskPriority(2);
     led.start();
     delay(50);
-    led.setBrightness(30);
+    led.setBrightness(60);  // perceptual, as bright as 30 % linear
+}
+
+// Runs in loop() through config.poll() after a setting has changed.
+void applyConfig(uint8_t key, int32_t value) {
+    log_i("config %s = %d", config.key(key).name, value);
+
+    switch (key) {
+        case kTimezone:
+            initClock();
+            break;
+        case kSamplingPeriod:
+            sampler.attach(value, _triggerSensor);
+            break;
+        case kUploadPeriod:
+        case kBlockOff:
+        case kBlockOn:
+            configureScheduler();
+            break;
+        case kTouchPress:
+        case kTouchRelease:
+            touch.configure(touch.getBaseline(), config.get(kTouchPress), config.get(kTouchRelease));
+            break;
+        case kPirDebounce:
+        case kPrewarm:
+        case kMotionDefer:
+            configureLoop();
+            break;
+        case kGossip:
+            gossip.setTimeout(value * 1000 * GOSSIP_MISSED);
+            break;
+        case kAltitude:  // read by sampleSensor()
+            break;
+        default:
+            configureIntensity();
+            break;
+    }
+}
+
+void initConfig(void) {
+    nvs.begin();
+    config.begin(nvs);
+    config.observe(CONFIG_ANY, applyConfig);
 }
 
 void initAutoConnect(void) {
@@ -514,42 +1666,154 @@ void initAutoConnect(void) {
     // even once it is disconnected.
     Config.autoReconnect = true;
     Config.ota           = AC_OTA_BUILTIN;
+    // The portal pages, its built-in updater among them, ask for a login.
+    Config.auth      = AC_AUTH_DIGEST;
+    Config.authScope = AC_AUTHSCOPE_AC;
+    Config.username  = SECRET_PORTAL_USER;
+    Config.password  = SECRET_PORTAL_PASSWORD;
     Portal.config(Config);
 
-    // Load aux. page
-    Timezone.load(AUX_TIMEZONE);
-    // Retrieve the select element that holds the time zone code and
-    // register the zone mnemonic in advance.
-    AutoConnectSelect& tz = Timezone["timezone"].as<AutoConnectSelect>();
-    for (uint8_t n = 0; n < sizeof(TZ) / sizeof(Timezone_t); n++) {
-        tz.add(String(TZ[n].zone));
-    }
-
-    Portal.join({Timezone});  // Register aux. page
+    // The aux. page and its elements are static, see timezone.h
+    Portal.join({Timezone});
 
     // Behavior a root path of ESP8266WebServer.
     Server.on("/", rootPage);
     Server.on("/start", startPage);  // Set NTP server trigger handler
     Server.on("/ota", otaPage);
+    Server.on("/rollup", rollupPage);
+    Server.on("/history", historyPage);
+    Server.on("/metrics", metricsPage);
+    Server.on("/update", HTTP_POST, updatePage);
+    Server.on("/config", configPage);
+    Server.on("/log", logPage);
+    Server.on("/trace", tracePage);
+    Server.on("/occupancy", occupancyPage);
+    Server.on("/gossip", gossipPage);
+
+    WiFi.onEvent(wifiEvent);
 
     // Establish a connection with an autoReconnect option.
     if (Portal.begin()) {
         log_i("WiFi connected: %s", WiFi.localIP().toString().c_str());
+        // The driver would scan without a pause while the AP is away,
+        // from here on Connectivity decides when to join again.
+        WiFi.setAutoReconnect(false);
         if (MDNS.begin(HOSTNAME)) {
             MDNS.addService("http", "tcp", HTTP_PORT);
             log_i("HTTP Server ready! Open http://%s.local/ in your browser\n", HOSTNAME);
         } else
             log_e("Error setting up MDNS responder");
     }
+
+#ifdef HTTP_SERVER_TASK
+    // From here on HTTP requests are served outside of loop().
+    httpServer.setCore(0);
+    httpServer.start();
+#endif
+}
+
+void initLog(void) {
+    logDrain.setCore(0);  // loop() never blocks, priority 1 would not run on core 1
+    logDrain.start();
+}
+
+#ifdef RUN_BENCHMARKS
+// The allocator is wrapped by the linker (-Wl,--wrap=malloc ...) to count
+// the allocations of the benchmark task only.
+TaskHandle_t benchTask = NULL;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    if (benchTask && xTaskGetCurrentTaskHandle() == benchTask) {
+        Bench::allocated(size);
+    }
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    if (benchTask && xTaskGetCurrentTaskHandle() == benchTask) {
+        Bench::allocated(count * size);
+    }
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+    if (benchTask && xTaskGetCurrentTaskHandle() == benchTask) {
+        Bench::allocated(size);
+    }
+    return __real_realloc(p, size);
+}
 }
 
+uint64_t benchNanos(void) { return esp_timer_get_time() * 1000; }
+
+void benchOutput(const char* line) { Serial.println(line); }
+
+void benchDisplayClock(void* context) { displayClock(); }
+
+void benchThingSpeakFields(void* context) {
+    static const ComfortSample_t sample = {1213, 1022, 2456, 101325};
+    setThingSpeakFields(24.56f, 45.12f, 1013.25f, sample);
+}
+
+void benchTimezone(void* context) {
+    static const String zone("asia/tokyo");
+    findTimezone(zone);
+}
+
+void benchRootPage(void* context) { rootContent(); }
+
+// Counts what a scrape would send.
+class BenchSink : public Print {
+   public:
+    size_t write(uint8_t c) override { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return size; }
+};
+
+void benchMetricsPage(void* context) {
+    BenchSink sink;
+    metricsContent(sink);
+}
+
+// The hot paths on the device, before the render clock owns the display.
+// The results go to the serial port in the format of bench/baseline.txt.
+void runBenchmarks(void) {
+    Bench bench(benchNanos, benchOutput);
+
+    addHotPaths(bench);
+    bench.add("display_clock", benchDisplayClock);
+    bench.add("thingspeak_fields", benchThingSpeakFields);
+    bench.add("tz_lookup", benchTimezone);
+    bench.add("root_page", benchRootPage);
+    bench.add("metrics_page", benchMetricsPage);
+
+    benchTask = xTaskGetCurrentTaskHandle();
+    bench.run();
+    benchTask = NULL;
+    bench.print();
+}
+#endif
+
 void setup(void) {
+    ota.checkBoot();
+    initConfig();
     initLED();
     led.drawpix(0, CRGB::Red);
 
     displayOn();
 
+    initRollup();
+    portalHeap = ESP.getFreeHeap();
+    portalTime = esp_timer_get_time();
     initAutoConnect();
+    portalTime = esp_timer_get_time() - portalTime;
+    portalHeap -= ESP.getMinFreeHeap();
+    log_i("initAutoConnect: %lld ms, %u bytes of heap at most", portalTime / 1000, portalHeap);
+    initLog();
 
     displayOff();
 
@@ -558,52 +1822,70 @@ void setup(void) {
     initClock();
     initButton();
     initPIRSensor();
+    initOccupancy();
     initTouchSensor();
     initThingSpeak();
+    initConnectivity();
     //initESPUI();
 
     led.drawpix(0, CRGB::Green);
 
     setNtpClockNetworkInfo();
-    sendThingSpeakData();
+    sensors.trigger();
+    sensors.waitSample(1000);
+    sampleSensor();
+    if (connectivity.canAttempt(millis())) {
+        sendThingSpeakData();
+    }
 
+    publishStatus();
+#ifdef RUN_BENCHMARKS
+    runBenchmarks();
+#endif
+    initDisplay();
     showEnvData();
-    displayOn();
-    clocker.attach_ms(500, displayClock);
-}
-
-void _off(void) {
-    log_i("blockflag is false.");
-    blockflag = false;
-}
-
-void _on(void) {
-    log_i("blockflag is true.");
-    blockflag = true;
 }
 
 void loop(void) {
-    Portal.handleClient();
+    TRACE_SCOPE("loop");
+    uint32_t start = micros();
+
+#ifndef HTTP_SERVER_TASK
+    {
+        TRACE_SCOPE("portal");
+        Portal.handleClient();
+    }
+#endif
     button.loop();
-    pir_sensor.loop();
+    handleConnectivity();
+    handleMotion();
+    handleOccupancy();
+    handleGossip();
+    handleTouch();
+    config.poll(millis());
+
+    if (sampleflag) {
+        sampleSensor();
+        ota.probe(clockLoop.probe(millis(), sampleValid, uploadAcknowledged()));
+        if (ota.getState() == OtaUpdater::kFailed && !led.isRunning()) {
+            led.start();
+        }
+        sampleflag = false;
+    }
 
     //every 60 seconds
-    if (sendDataflag) {
-        log_d("Clock send BME280 Data.");
-        sendThingSpeakData();
-        blockOFF.once(15, _off);
-        blockON.once(45, _on);
-
-        sendDataflag = false;
+    if (clockLoop.pollSensor(millis(), ota.isBusy()) == ClockLoop::kSend) {
+        uploadSensors();
+        scheduler.sensorSent(millis());
     }
 
-    if (blockflag == false && sendMotionflag == true) {
-        log_i("Clock can send motion data.");
-        sendMotionTime(motionTime);
-
-        motionTime     = 0;
-        sendMotionflag = false;
+    if (clockLoop.pollMotion(millis(), ota.isBusy())) {
+        dlog_i("Clock can send motion data.");
+        sendMotionReport();
+        clockLoop.motionSent(millis());
     }
 
+    publishStatus();
+    loopLatency.record(micros() - start);
     yield();
 }
@@ -4,6 +4,16 @@
 #define SECRET_CH_ID        0000000  // replace 0000000 with your channel number
 #define SECRET_WRITE_APIKEY "XYZ"    // replace XYZ with your channel write API Key
 
+// Sensor gossip, the same on every clock of the LAN. The clock elected by
+// gossip writes everybody's readings to the fleet channel, 0 = none.
+#define SECRET_GOSSIP_KEY         "0123456789abcdef"  // 16 characters
+#define SECRET_FLEET_CH_ID        0000000
+#define SECRET_FLEET_WRITE_APIKEY "XYZ"
+
+// Digest credentials of the portal pages and of POST /update.
+#define SECRET_PORTAL_USER     "admin"
+#define SECRET_PORTAL_PASSWORD "XYZ"  // replace XYZ with a password of your own
+
 // ThingSpeak Root Certificate, Expiration Date: November 9, 2031 at 7:00:00 PM
 // EST
 
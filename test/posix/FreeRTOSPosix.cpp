@@ -0,0 +1,264 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// FreeRTOS calls of lib/Task on POSIX threads, see freertos/task.h.
+
+#include <errno.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <new>
+#include <time.h>
+
+struct tskTaskControlBlock {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t signal;
+    TaskFunction_t code;
+    void *parameters;
+    uint32_t notified;
+    bool deleted;
+    bool heap;
+};
+
+struct QueueDefinition {
+    pthread_mutex_t lock;
+    pthread_cond_t signal;
+    bool given;
+};
+
+static_assert(sizeof(tskTaskControlBlock) <= sizeof(StaticTask_t), "StaticTask_t too small");
+static_assert(sizeof(QueueDefinition) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t too small");
+
+PosixTasks_t posixTasks;
+
+static pthread_mutex_t s_countLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread tskTaskControlBlock *s_current = nullptr;
+
+static void count(uint32_t &counter, int delta) {
+    pthread_mutex_lock(&s_countLock);
+    counter += delta;
+    pthread_mutex_unlock(&s_countLock);
+}
+
+static void deadline(struct timespec &ts, TickType_t ticks) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+}
+
+// Waits on the condition with the lock held, false on the timeout.
+static bool block(pthread_cond_t &signal, pthread_mutex_t &lock, TickType_t ticks, const struct timespec &until) {
+    if (ticks == portMAX_DELAY) {
+        return pthread_cond_wait(&signal, &lock) == 0;
+    }
+
+    return pthread_cond_timedwait(&signal, &lock, &until) != ETIMEDOUT;
+}
+
+// Ends the calling task when it has been deleted, with its lock held.
+static void exitIfDeleted(tskTaskControlBlock *task) {
+    if (task->deleted) {
+        pthread_mutex_unlock(&task->lock);
+        pthread_exit(nullptr);
+    }
+}
+
+static void *trampoline(void *parameters) {
+    tskTaskControlBlock *task = (tskTaskControlBlock *)parameters;
+
+    s_current = task;
+    task->code(task->parameters);
+    vTaskSuspend(nullptr);  // a FreeRTOS task must not return
+
+    return nullptr;
+}
+
+static TaskHandle_t create(tskTaskControlBlock *task, TaskFunction_t code, void *parameters, bool heap) {
+    pthread_mutex_init(&task->lock, nullptr);
+    pthread_cond_init(&task->signal, nullptr);
+    task->code       = code;
+    task->parameters = parameters;
+    task->notified   = 0;
+    task->deleted    = false;
+    task->heap       = heap;
+
+    count(posixTasks.created, 1);
+    count(posixTasks.heap, heap);
+    count(posixTasks.live, 1);
+    if (pthread_create(&task->thread, nullptr, trampoline, task) != 0) {
+        count(posixTasks.live, -1);
+        return nullptr;
+    }
+
+    return task;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code, const char *name, uint32_t depth, void *parameters,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core) {
+    return create(new (tcb) tskTaskControlBlock, code, parameters, false);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t depth, void *parameters,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+    tskTaskControlBlock *task = new tskTaskControlBlock;
+
+    *created = create(task, code, parameters, true);
+    if (*created == nullptr) {
+        delete task;
+        return pdFALSE;
+    }
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == s_current) {
+        return;  // lib/Task never deletes itself
+    }
+
+    pthread_mutex_lock(&task->lock);
+    task->deleted = true;
+    pthread_cond_broadcast(&task->signal);
+    pthread_mutex_unlock(&task->lock);
+    pthread_join(task->thread, nullptr);
+
+    pthread_cond_destroy(&task->signal);
+    pthread_mutex_destroy(&task->lock);
+    count(posixTasks.deleted, 1);
+    count(posixTasks.live, -1);
+    if (task->heap) {
+        delete task;
+    }
+}
+
+void vTaskSuspend(TaskHandle_t task) {
+    tskTaskControlBlock *self = s_current;
+
+    if (task != nullptr || self == nullptr) {
+        return;  // only a task suspending itself
+    }
+
+    pthread_mutex_lock(&self->lock);
+    while (true) {
+        exitIfDeleted(self);
+        pthread_cond_wait(&self->signal, &self->lock);
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    tskTaskControlBlock *self = s_current;
+    struct timespec until;
+
+    if (self == nullptr) {
+        struct timespec ts = {(time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L};
+        nanosleep(&ts, nullptr);
+        return;
+    }
+
+    deadline(until, ticks);
+    pthread_mutex_lock(&self->lock);
+    exitIfDeleted(self);
+    while (block(self->signal, self->lock, ticks, until)) {
+        exitIfDeleted(self);
+    }
+    pthread_mutex_unlock(&self->lock);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&task->lock);
+    task->notified++;
+    pthread_cond_broadcast(&task->signal);
+    pthread_mutex_unlock(&task->lock);
+
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    tskTaskControlBlock *self = s_current;
+    struct timespec until;
+    uint32_t value;
+
+    deadline(until, ticks);
+    pthread_mutex_lock(&self->lock);
+    exitIfDeleted(self);
+    while (self->notified == 0 && ticks != 0 && block(self->signal, self->lock, ticks, until)) {
+        exitIfDeleted(self);
+    }
+    value = self->notified;
+    if (value != 0) {
+        self->notified = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return value;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    QueueDefinition *semaphore = new (buffer) QueueDefinition;
+
+    pthread_mutex_init(&semaphore->lock, nullptr);
+    pthread_cond_init(&semaphore->signal, nullptr);
+    semaphore->given = false;
+
+    return semaphore;
+}
+
+// A binary semaphore that starts given, without priority inheritance.
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    SemaphoreHandle_t mutex = xSemaphoreCreateBinaryStatic(new StaticSemaphore_t);
+
+    mutex->given = true;
+
+    return mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    struct timespec until;
+    bool taken;
+
+    deadline(until, ticks);
+    pthread_mutex_lock(&semaphore->lock);
+    while (!semaphore->given && ticks != 0 && block(semaphore->signal, semaphore->lock, ticks, until)) {
+    }
+    taken            = semaphore->given;
+    semaphore->given = false;
+    pthread_mutex_unlock(&semaphore->lock);
+
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    pthread_mutex_lock(&semaphore->lock);
+    semaphore->given = true;
+    pthread_cond_signal(&semaphore->signal);
+    pthread_mutex_unlock(&semaphore->lock);
+
+    return pdTRUE;
+}
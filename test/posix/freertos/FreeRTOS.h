@@ -0,0 +1,69 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Just enough of FreeRTOS on POSIX threads to run lib/Task on the host,
+// see test/posix/test_task and test/posix/test_sensorbus.
+// A task is a thread, priorities and cores are ignored and a tick is a
+// millisecond.
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#define configSUPPORT_STATIC_ALLOCATION 1
+
+#define portMAX_DELAY      0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdFALSE            0
+#define pdTRUE             1
+#define pdPASS             pdTRUE
+#define tskNO_AFFINITY     0x7fffffff
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef TaskHandle_t xTaskHandle;
+typedef struct QueueDefinition *SemaphoreHandle_t;
+
+// Room for the control blocks below, as on the device.
+typedef struct {
+    uint64_t space[32];
+} StaticTask_t;
+
+typedef struct {
+    uint64_t space[16];
+} StaticSemaphore_t;
+
+typedef pthread_mutex_t portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)      pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)       pthread_mutex_unlock(mux)
@@ -0,0 +1,176 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// The part of the Adafruit BME280 driver that lib/BME280Class builds on,
+// over the simulated bus of Wire.h: begin() checks the chip ID and takes
+// a fixed calibration, setSampling() writes the control registers.
+
+#pragma once
+
+#include <Wire.h>
+
+#define BME280_ADDRESS           0x77
+#define BME280_ADDRESS_ALTERNATE 0x76
+
+enum {
+    BME280_REGISTER_CHIPID       = 0xD0,
+    BME280_REGISTER_CONTROLHUMID = 0xF2,
+    BME280_REGISTER_STATUS       = 0xF3,
+    BME280_REGISTER_CONTROL      = 0xF4,
+    BME280_REGISTER_CONFIG       = 0xF5,
+    BME280_REGISTER_PRESSUREDATA = 0xF7,
+};
+
+typedef struct {
+    uint16_t dig_T1;
+    int16_t dig_T2;
+    int16_t dig_T3;
+    uint16_t dig_P1;
+    int16_t dig_P2;
+    int16_t dig_P3;
+    int16_t dig_P4;
+    int16_t dig_P5;
+    int16_t dig_P6;
+    int16_t dig_P7;
+    int16_t dig_P8;
+    int16_t dig_P9;
+    uint8_t dig_H1;
+    int16_t dig_H2;
+    uint8_t dig_H3;
+    int16_t dig_H4;
+    int16_t dig_H5;
+    int8_t dig_H6;
+} bme280_calib_data;
+
+class Adafruit_BME280 {
+   public:
+    enum sensor_sampling {
+        SAMPLING_NONE = 0b000,
+        SAMPLING_X1   = 0b001,
+        SAMPLING_X2   = 0b010,
+        SAMPLING_X4   = 0b011,
+        SAMPLING_X8   = 0b100,
+        SAMPLING_X16  = 0b101
+    };
+
+    enum sensor_mode {
+        MODE_SLEEP  = 0b00,
+        MODE_FORCED = 0b01,
+        MODE_NORMAL = 0b11
+    };
+
+    enum sensor_filter {
+        FILTER_OFF = 0b000,
+        FILTER_X2  = 0b001,
+        FILTER_X4  = 0b010,
+        FILTER_X8  = 0b011,
+        FILTER_X16 = 0b100
+    };
+
+    enum standby_duration {
+        STANDBY_MS_0_5  = 0b000,
+        STANDBY_MS_10   = 0b110,
+        STANDBY_MS_20   = 0b111,
+        STANDBY_MS_62_5 = 0b001,
+        STANDBY_MS_125  = 0b010,
+        STANDBY_MS_250  = 0b011,
+        STANDBY_MS_500  = 0b100,
+        STANDBY_MS_1000 = 0b101
+    };
+
+    Adafruit_BME280() : _wire(nullptr), _address(0), _sensorID(0) {}
+
+    bool begin(uint8_t address, TwoWire *wire) {
+        _wire     = wire;
+        _address  = address;
+        _sensorID = _read8(BME280_REGISTER_CHIPID);
+        if (_sensorID != 0x60) {
+            return false;
+        }
+
+        _bme280_calib = {28485, 26735, 50,
+                         37882, -10590, 3024, 7256, -47, -7, 9900, -10230, 4285,
+                         75, 359, 0, 338, 0, 30};
+        setSampling();
+
+        return true;
+    }
+
+    void setSampling(sensor_mode mode = MODE_NORMAL, sensor_sampling tempSampling = SAMPLING_X16,
+                     sensor_sampling pressSampling = SAMPLING_X16, sensor_sampling humSampling = SAMPLING_X16,
+                     sensor_filter filter = FILTER_OFF, standby_duration duration = STANDBY_MS_0_5) {
+        _measReg.mode   = mode;
+        _measReg.osrs_t = tempSampling;
+        _measReg.osrs_p = pressSampling;
+        _humReg.osrs_h  = humSampling;
+
+        _write8(BME280_REGISTER_CONTROL, MODE_SLEEP);
+        _write8(BME280_REGISTER_CONTROLHUMID, _humReg.get());
+        _write8(BME280_REGISTER_CONFIG, (duration << 5) | (filter << 2));
+        _write8(BME280_REGISTER_CONTROL, _measReg.get());
+    }
+
+    uint32_t sensorID(void) { return _sensorID; }
+
+   protected:
+    struct ctrl_meas {
+        unsigned int osrs_t : 3;
+        unsigned int osrs_p : 3;
+        unsigned int mode : 2;
+        unsigned int get() { return (osrs_t << 5) | (osrs_p << 2) | mode; }
+    };
+
+    struct ctrl_hum {
+        unsigned int none : 5;
+        unsigned int osrs_h : 3;
+        unsigned int get() { return osrs_h; }
+    };
+
+    ctrl_meas _measReg;
+    ctrl_hum _humReg;
+    bme280_calib_data _bme280_calib;
+
+   private:
+    void _write8(uint8_t reg, uint8_t value) {
+        _wire->beginTransmission(_address);
+        _wire->write(reg);
+        _wire->write(value);
+        _wire->endTransmission();
+    }
+
+    uint8_t _read8(uint8_t reg) {
+        _wire->beginTransmission(_address);
+        _wire->write(reg);
+        if (_wire->endTransmission() != 0 || _wire->requestFrom(_address, (uint8_t)1) != 1) {
+            return 0xFF;
+        }
+
+        return _wire->read();
+    }
+
+    TwoWire *_wire;
+    uint8_t _address;
+    uint32_t _sensorID;
+};
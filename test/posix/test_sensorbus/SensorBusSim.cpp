@@ -0,0 +1,235 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Runs lib/SensorBus with lib/BME280Class on a simulated I2C bus and
+// checks its cycle: one forced start and one burst read per device, the
+// devices converting in parallel so two cost about as much as one, a NACK
+// or a short read counted as a bus error, a conversion that never ends
+// counted as a timeout at the deadline without holding up the other
+// device, a device unhealthy after SENSOR_BUS_FAILURES and healthy again
+// with its next read, a failing or silent device without a sample until
+// it answers again, and a missing device probed again every
+// SENSOR_BUS_RETRY cycles and left alone in between. Prints the cycle
+// time with one and two devices and with latency on the bus.
+//
+//   pio test -e native -f posix/test_sensorbus -v
+//
+// The bus and the sensors come from Wire.h here, the FreeRTOS calls from
+// test/posix/freertos; the times are the host's sleeps, not the ESP32's.
+
+#include <SensorBus.h>
+#include <stdio.h>
+#include <unity.h>
+
+#define CYCLES  20
+#define LATENCY 1000  // [us] per transfer
+#define SLACK   5000  // [us] for the host's scheduling
+
+static uint32_t alone;  // [us] cycle time of one device
+
+// One cycle as loop() triggers it, false when it did not end in time.
+static bool cycle(SensorBus &bus) {
+    uint32_t cycles = bus.getCycles();
+    uint32_t start  = millis();
+
+    bus.trigger();
+    while (bus.getCycles() == cycles && millis() - start < 1000) {
+        delay(1);
+    }
+
+    return bus.getCycles() != cycles;
+}
+
+// Average cycle time [us] of the next cycles.
+static uint32_t cycles(SensorBus &bus, int count) {
+    uint64_t sum = 0;
+    bool ended   = true;
+
+    for (int i = 0; i < count; i++) {
+        ended = cycle(bus) && ended;
+        sum += bus.getCycleTime();
+    }
+    TEST_ASSERT_MESSAGE(ended, "every cycle ends");
+
+    return sum / count;
+}
+
+static bool inRange(SensorBus &bus, uint8_t index) {
+    float temperature, humidity, pressure;
+
+    return bus.getSample(index, temperature, humidity, pressure) &&
+           temperature > 22.0f && temperature < 24.0f &&
+           humidity > 43.0f && humidity < 45.0f &&
+           pressure > 1008.0f && pressure < 1010.0f;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_single(void) {
+    TwoWire wire;
+    SimBME280_t &sim = wire.attach(0x76);
+    BME280Class device(0x76);
+    SensorBus bus(wire);
+
+    bus.begin(21, 22);
+    TEST_ASSERT_MESSAGE(bus.add(device, MODE::WEATHER_STATION), "device found");
+    TEST_ASSERT_MESSAGE(wire.getFrequency() == SENSOR_BUS_FREQUENCY, "bus clock kept after the driver's begin()");
+    bus.start();
+
+    uint32_t starts = sim.starts;
+    uint32_t time   = cycles(bus, CYCLES);
+    SensorHealth_t health = bus.getHealth(0);
+
+    TEST_ASSERT_MESSAGE(sim.starts - starts == CYCLES, "one forced start a cycle");
+    TEST_ASSERT_MESSAGE(sim.bursts == CYCLES, "one burst read a cycle");
+    TEST_ASSERT_MESSAGE(health.samples + health.rejected == CYCLES, "every read goes through the filter");
+    TEST_ASSERT_MESSAGE(health.errors == 0 && health.timeouts == 0, "no errors on a good bus");
+    TEST_ASSERT_MESSAGE(inRange(bus, 0), "sample of the burst");
+    TEST_ASSERT_MESSAGE(time >= sim.conversion, "cycle waits for the conversion");
+    TEST_ASSERT_MESSAGE(time < device.getConversionTime() + SLACK, "cycle ends after the conversion");
+    printf("1 device: cycle %.1f ms, conversion %.1f ms\n", time / 1000.0, device.getConversionTime() / 1000.0);
+    alone = time;
+}
+
+static void test_pair(void) {
+    TwoWire wire;
+    SimBME280_t &simA = wire.attach(0x76);
+    SimBME280_t &simB = wire.attach(0x77);
+    BME280Class a(0x76);
+    BME280Class b(0x77);
+    SensorBus bus(wire);
+
+    bus.begin(21, 22);
+    TEST_ASSERT_MESSAGE(bus.add(a, MODE::WEATHER_STATION) && bus.add(b, MODE::WEATHER_STATION), "both devices found");
+    bus.start();
+
+    // parallel conversions
+    uint32_t time = cycles(bus, CYCLES);
+    TEST_ASSERT_MESSAGE(simA.bursts == CYCLES && simB.bursts == CYCLES, "one burst read a device and cycle");
+    TEST_ASSERT_MESSAGE(inRange(bus, 0) && inRange(bus, 1), "samples of both devices");
+    TEST_ASSERT_MESSAGE(time < alone + SLACK / 2, "two devices cost about one");
+    printf("2 devices: cycle %.1f ms\n", time / 1000.0);
+
+    // latency on every transfer
+    uint32_t transfers = wire.getTransfers();
+    wire.setLatency(LATENCY);
+    time = cycles(bus, CYCLES);
+    wire.setLatency(0);
+    uint32_t perCycle = (wire.getTransfers() - transfers) / CYCLES;
+    TEST_ASSERT_MESSAGE(bus.getHealth(0).errors + bus.getHealth(1).errors == 0, "latency is no error");
+    TEST_ASSERT_MESSAGE(bus.getHealth(0).timeouts + bus.getHealth(1).timeouts == 0, "latency is no timeout");
+    TEST_ASSERT_MESSAGE(time < a.getConversionTime() + perCycle * LATENCY + SLACK, "latency adds up once a transfer");
+    printf("2 devices, %u us a transfer: %u transfers, cycle %.1f ms\n", LATENCY, perCycle, time / 1000.0);
+
+    // NACK
+    SensorHealth_t before = bus.getHealth(1);
+    uint32_t samples      = bus.getHealth(0).samples;
+    simB.nack             = true;
+    cycles(bus, SENSOR_BUS_FAILURES - 1);
+    TEST_ASSERT_MESSAGE(bus.isHealthy(1), "healthy before SENSOR_BUS_FAILURES");
+    TEST_ASSERT_MESSAGE(inRange(bus, 1), "last sample kept over a few NACKs");
+    cycle(bus);
+    TEST_ASSERT_MESSAGE(!bus.isHealthy(1), "unhealthy after SENSOR_BUS_FAILURES NACKs");
+    TEST_ASSERT_MESSAGE(!inRange(bus, 1), "no sample of a device failing");
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).errors - before.errors == SENSOR_BUS_FAILURES, "a NACK is a bus error");
+    TEST_ASSERT_MESSAGE(bus.isHealthy(0), "other device stays healthy");
+    TEST_ASSERT_MESSAGE(bus.getHealth(0).samples - samples == SENSOR_BUS_FAILURES, "other device keeps sampling");
+    simB.nack = false;
+    cycle(bus);
+    TEST_ASSERT_MESSAGE(bus.isHealthy(1), "healthy again with the next read");
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).failures == 0, "failures reset");
+    TEST_ASSERT_MESSAGE(inRange(bus, 1), "sample again with the next read");
+
+    // short read
+    uint32_t bursts = simB.bursts;
+    before          = bus.getHealth(1);
+    simB.shortRead  = true;
+    cycle(bus);
+    simB.shortRead = false;
+    TEST_ASSERT_MESSAGE(simB.bursts - bursts == 1, "burst read tried");
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).errors - before.errors == 1, "a short read is a bus error");
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).samples == before.samples, "no sample of a short read");
+
+    // conversion that never ends
+    bursts     = simB.bursts;
+    before     = bus.getHealth(1);
+    samples    = bus.getHealth(0).samples;
+    simB.stuck = true;
+    cycle(bus);
+    time       = bus.getCycleTime();
+    simB.stuck = false;
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).timeouts - before.timeouts == 1, "still converting at the deadline is a timeout");
+    TEST_ASSERT_MESSAGE(simB.bursts == bursts, "no read of a device still converting");
+    TEST_ASSERT_MESSAGE(bus.getHealth(0).samples - samples == 1, "other device read before the deadline");
+    TEST_ASSERT_MESSAGE(time >= SENSOR_BUS_TIMEOUT * 1000, "waited until the deadline");
+    TEST_ASSERT_MESSAGE(time < a.getConversionTime() + SENSOR_BUS_TIMEOUT * 1000 + SLACK, "gave up at the deadline");
+    printf("timeout: cycle %.1f ms\n", time / 1000.0);
+    cycle(bus);
+    TEST_ASSERT_MESSAGE(bus.getHealth(1).failures == 0, "read again after the timeout");
+
+    // gone silent, e.g. unplugged
+    simB.present = false;
+    cycles(bus, SENSOR_BUS_FAILURES);
+    TEST_ASSERT_MESSAGE(!bus.isHealthy(1), "silent device unhealthy");
+    TEST_ASSERT_MESSAGE(!inRange(bus, 1), "silent device has no sample");
+    TEST_ASSERT_MESSAGE(inRange(bus, 0), "other device keeps its sample");
+    simB.present = true;
+    cycle(bus);
+    TEST_ASSERT_MESSAGE(inRange(bus, 1), "sample again when it answers");
+}
+
+static void test_missing(void) {
+    TwoWire wire;
+    SimBME280_t &sim = wire.attach(0x76);
+    BME280Class device(0x76);
+    SensorBus bus(wire);
+
+    sim.present = false;
+    bus.begin(21, 22);
+    TEST_ASSERT_MESSAGE(!bus.add(device, MODE::WEATHER_STATION), "missing device reported");
+    bus.start();
+
+    cycle(bus);  // probed in cycle 0
+    sim.present        = true;
+    uint32_t transfers = wire.getTransfers();
+    cycles(bus, SENSOR_BUS_RETRY - 1);
+    TEST_ASSERT_MESSAGE(wire.getTransfers() == transfers, "no transfers to a missing device between probes");
+    TEST_ASSERT_MESSAGE(!device.isPresent() && !bus.isHealthy(0), "missing until probed");
+
+    cycle(bus);
+    TEST_ASSERT_MESSAGE(device.isPresent() && bus.isHealthy(0), "back after SENSOR_BUS_RETRY cycles");
+    TEST_ASSERT_MESSAGE(sim.bursts == 1, "read in the cycle it came back");
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single);
+    RUN_TEST(test_pair);
+    RUN_TEST(test_missing);
+
+    return UNITY_END();
+}
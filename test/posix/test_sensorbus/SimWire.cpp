@@ -0,0 +1,171 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// The simulated bus of Wire.h.
+
+#include <Adafruit_BME280.h>
+#include <string.h>
+
+#define BME280_CHIP_ID 0x60
+
+const uint8_t SIM_BME280_DATA[8] = {0x4D, 0xB1, 0x00, 0x80, 0xB4, 0x00, 0x73, 0x85};
+
+TwoWire Wire;
+
+TwoWire::TwoWire() {
+    _count     = 0;
+    _address   = 0;
+    _txLength  = 0;
+    _rxLength  = 0;
+    _rxIndex   = 0;
+    _latency   = 0;
+    _transfers = 0;
+    _frequency = 100000;
+}
+
+bool TwoWire::begin(int sdaPin, int sclPin, uint32_t frequency) {
+    _frequency = frequency;
+
+    return true;
+}
+
+SimBME280_t &TwoWire::attach(uint8_t address) {
+    SimBME280_t &device = _device[_count++];
+
+    memset(&device, 0, sizeof(device));
+    device.address    = address;
+    device.present    = true;
+    device.conversion = 8000;  // typical of 1x oversampling, the maximum is 9.3 ms
+
+    return device;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address  = address;
+    _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+    if (_txLength >= sizeof(_tx)) {
+        return 0;
+    }
+    _tx[_txLength++] = value;
+
+    return 1;
+}
+
+// 0 on success, 2 for a NACK of the address as the ESP32 driver.
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    SimBME280_t *device = _find(_address);
+
+    _transfer();
+    if (device == nullptr || _txLength == 0) {
+        return 2;
+    }
+
+    device->pointer = _tx[0];
+    for (uint8_t i = 1; i < _txLength; i++) {
+        uint8_t reg = device->pointer++;
+        if (reg == BME280_REGISTER_CONTROL) {
+            device->ctrlMeas = _tx[i];
+            if ((_tx[i] & 0x03) == 0x01 || (_tx[i] & 0x03) == 0x02) {
+                device->started   = micros();
+                device->measuring = true;
+                device->starts++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    SimBME280_t *device = _find(address);
+
+    _transfer();
+    _rxLength = 0;
+    _rxIndex  = 0;
+    if (device == nullptr || quantity > sizeof(_rx)) {
+        return 0;
+    }
+
+    if (device->pointer == BME280_REGISTER_PRESSUREDATA) {
+        device->bursts++;
+    }
+    if (device->shortRead && quantity > 1) {
+        quantity--;
+    }
+    for (uint8_t i = 0; i < quantity; i++) {
+        _rx[_rxLength++] = _register(*device, device->pointer++);
+    }
+
+    return _rxLength;
+}
+
+int TwoWire::read(void) {
+    if (_rxIndex >= _rxLength) {
+        return -1;
+    }
+
+    return _rx[_rxIndex++];
+}
+
+// Present and not NACKing.
+SimBME280_t *TwoWire::_find(uint8_t address) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_device[i].address == address) {
+            return _device[i].present && !_device[i].nack ? &_device[i] : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+uint8_t TwoWire::_register(SimBME280_t &device, uint8_t address) {
+    if (device.measuring && !device.stuck && micros() - device.started >= device.conversion) {
+        device.measuring = false;
+    }
+
+    switch (address) {
+        case BME280_REGISTER_CHIPID:
+            return BME280_CHIP_ID;
+        case BME280_REGISTER_STATUS:
+            return device.measuring || device.stuck ? 0x08 : 0x00;
+        case BME280_REGISTER_CONTROL:
+            return device.ctrlMeas;
+        default:
+            if (address >= BME280_REGISTER_PRESSUREDATA && address < BME280_REGISTER_PRESSUREDATA + sizeof(SIM_BME280_DATA)) {
+                return SIM_BME280_DATA[address - BME280_REGISTER_PRESSUREDATA];
+            }
+            return 0;
+    }
+}
+
+void TwoWire::_transfer(void) {
+    _transfers++;
+    if (_latency) {
+        delayMicroseconds(_latency);
+    }
+}
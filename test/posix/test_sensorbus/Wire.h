@@ -0,0 +1,94 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// TwoWire with simulated BME280s on it instead of a bus, see
+// SensorBusSim.cpp. A device converts in real time after a forced start
+// and can be told to drop off the bus, NACK, cut a burst short or never
+// finish its conversion; every transfer can be given a latency.
+
+#pragma once
+
+#include <Arduino.h>
+
+#define SIM_WIRE_DEVICES 4
+#define SIM_WIRE_BUFFER  32  // [bytes] as the ESP32 driver
+
+// One simulated BME280, the test sets the faults between bus cycles.
+typedef struct {
+    uint8_t address;
+    bool present;         // answers at its address
+    bool nack;            // present, but NACKs every transfer
+    bool shortRead;       // returns a byte less of a burst
+    bool stuck;           // status.measuring never clears
+    uint32_t conversion;  // [us] of a forced measurement
+    uint32_t started;     // micros() of the last start
+    bool measuring;
+    uint8_t pointer;  // register address
+    uint8_t ctrlMeas;
+    uint32_t starts;  // forced measurements
+    uint32_t bursts;  // reads from the data registers
+} SimBME280_t;
+
+class TwoWire {
+   public:
+    TwoWire();
+
+    bool begin(int sdaPin, int sclPin, uint32_t frequency = 100000);
+    void setClock(uint32_t frequency) { _frequency = frequency; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    int read(void);
+
+    // host only
+    SimBME280_t &attach(uint8_t address);
+    void setLatency(uint32_t latency) { _latency = latency; }
+    uint32_t getTransfers(void) const { return _transfers; }
+    uint32_t getFrequency(void) const { return _frequency; }
+
+   private:
+    SimBME280_t *_find(uint8_t address);
+    uint8_t _register(SimBME280_t &device, uint8_t address);
+    void _transfer(void);
+
+    SimBME280_t _device[SIM_WIRE_DEVICES];
+    uint8_t _count;
+    uint8_t _address;  // of the transmission
+    uint8_t _tx[SIM_WIRE_BUFFER];
+    uint8_t _txLength;
+    uint8_t _rx[SIM_WIRE_BUFFER];
+    uint8_t _rxLength;
+    uint8_t _rxIndex;
+    uint32_t _latency;  // [us] per transfer
+    uint32_t _transfers;
+    uint32_t _frequency;
+};
+
+extern TwoWire Wire;  // default of BME280Class::setup(), no device on it
+
+// The burst every simulated device reads, 23 degC, 1009 hPa and 44 %RH
+// with the calibration in Adafruit_BME280.h, as in lib/Bench.
+extern const uint8_t SIM_BME280_DATA[8];
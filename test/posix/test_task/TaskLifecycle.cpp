@@ -0,0 +1,227 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Runs lib/Task on POSIX threads and checks its lifecycle: start, wake by
+// notify(), requestStop() and join(), join() timing out, stop() of a task
+// that never returns, teardown by the destructor and restarting. Checks
+// that the static pool serves small tasks, sends big ones and a full
+// pool to the heap, and keeps a slot until its task is joined. Prints
+// the cost of a start and join cycle.
+//
+//   pio test -e native -f posix/test_task -v
+//
+// The FreeRTOS calls come from test/posix/freertos, a task is a thread
+// here, so the costs are the host's, not the ESP32's.
+
+#include <Task.h>
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+
+#include <atomic>
+
+#define CYCLES     2000
+#define SMALL_TASK 4096                 // [bytes] fits a pool slot
+#define BIG_TASK   (2 * TASK_POOL_STACK)  // [bytes] does not
+
+static std::atomic<uint32_t> returns(0);
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Sleeps until woken, as the LED and HTTP server tasks do.
+class Worker : public Task {
+   public:
+    Worker(uint32_t size = SMALL_TASK) : Task("worker", size, 5), wakes(0), returned(false) {}
+    ~Worker() {
+        requestStop();
+        join();
+    }
+
+    void run(void *data) override {
+        while (!isStopRequested()) {
+            if (wait(1000)) {
+                wakes++;
+            }
+        }
+        returned = true;
+        returns++;
+    }
+
+    std::atomic<uint32_t> wakes;
+    std::atomic<bool> returned;
+};
+
+// Does not look at requestStop() before it is done.
+class Stubborn : public Task {
+   public:
+    Stubborn() : Task("stubborn", SMALL_TASK, 5) {}
+    ~Stubborn() { join(); }
+
+    void run(void *data) override { delay(200); }
+};
+
+static bool started(Task &task, bool heap) {
+    uint32_t before = posixTasks.heap;
+
+    task.start();
+
+    return task.isRunning() && posixTasks.heap - before == (heap ? 1u : 0u);
+}
+
+static bool settle(std::atomic<bool> &flag) {
+    for (int i = 0; i < 1000 && !flag; i++) {
+        vTaskDelay(1);
+    }
+
+    return flag;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_lifecycle(void) {
+    Worker worker;
+    uint64_t begin;
+
+    TEST_ASSERT_MESSAGE(started(worker, false), "small task from the pool");
+
+    begin = nanos();
+    worker.notify();
+    for (int i = 0; i < 1000 && worker.wakes == 0; i++) {
+        vTaskDelay(1);
+    }
+    printf("notify() to wake %.1f us\n", (nanos() - begin) / 1000.0);
+    TEST_ASSERT_MESSAGE(worker.wakes == 1, "woken by notify()");
+
+    begin = nanos();
+    worker.requestStop();
+    TEST_ASSERT_MESSAGE(worker.join(), "joined");
+    printf("requestStop() to joined %.1f us\n", (nanos() - begin) / 1000.0);
+    TEST_ASSERT_MESSAGE(nanos() - begin < 100000000ULL, "stop wakes the task before its timeout");
+    TEST_ASSERT_MESSAGE(worker.returned, "run() returned");
+    TEST_ASSERT_MESSAGE(!worker.isRunning(), "not running after join()");
+    TEST_ASSERT_MESSAGE(posixTasks.live == 0, "thread gone after join()");
+
+    worker.returned = false;
+    TEST_ASSERT_MESSAGE(started(worker, false), "restarted from the pool");
+    worker.requestStop();
+    TEST_ASSERT_MESSAGE(worker.join() && worker.returned, "restarted task joined");
+}
+
+static void test_timeout(void) {
+    Stubborn stubborn;
+
+    stubborn.start();
+    stubborn.requestStop();
+    TEST_ASSERT_MESSAGE(!stubborn.join(50), "join() times out while run() goes on");
+    TEST_ASSERT_MESSAGE(stubborn.isRunning(), "still running after the timeout");
+    TEST_ASSERT_MESSAGE(stubborn.join(), "joined once run() returned");
+}
+
+static void test_pool(void) {
+    Worker slots[TASK_POOL_SLOTS];
+    Worker full, big(BIG_TASK), waiting;
+
+    for (uint8_t i = 0; i < TASK_POOL_SLOTS; i++) {
+        TEST_ASSERT_MESSAGE(started(slots[i], false), "pool slot");
+    }
+    TEST_ASSERT_MESSAGE(started(full, true), "heap when the pool is full");
+    TEST_ASSERT_MESSAGE(started(big, true), "heap for a big stack");
+
+    // run() has returned but the TCB is live until join().
+    slots[0].requestStop();
+    TEST_ASSERT_MESSAGE(settle(slots[0].returned), "run() returned");
+    TEST_ASSERT_MESSAGE(started(waiting, true), "slot kept until join()");
+    TEST_ASSERT_MESSAGE(slots[0].join(), "joined");
+    waiting.requestStop();
+    TEST_ASSERT_MESSAGE(waiting.join(), "joined");
+    TEST_ASSERT_MESSAGE(started(waiting, false), "slot reused after join()");
+}
+
+static void test_abandon(void) {
+    Worker worker;
+    uint32_t before = returns;
+
+    worker.start();
+    worker.stop();
+    TEST_ASSERT_MESSAGE(!worker.isRunning(), "not running after stop()");
+    TEST_ASSERT_MESSAGE(returns == before, "stop() deletes the task in run()");
+    TEST_ASSERT_MESSAGE(posixTasks.live == 0, "thread gone after stop()");
+    TEST_ASSERT_MESSAGE(started(worker, false), "slot free after stop()");
+}
+
+static void test_destructor(void) {
+    uint32_t before = returns;
+
+    {
+        Worker worker;
+        worker.start();
+    }
+    TEST_ASSERT_MESSAGE(returns == before + 1, "destructor stops run()");
+    TEST_ASSERT_MESSAGE(posixTasks.live == 0, "destructor joins");
+}
+
+static void measure(const char *what, uint32_t size) {
+    Worker worker(size);
+    uint64_t begin = nanos();
+
+    for (int i = 0; i < CYCLES; i++) {
+        worker.start();
+        worker.requestStop();
+        worker.join();
+    }
+    printf("start() and join() %s %.1f us\n", what, (nanos() - begin) / 1000.0 / CYCLES);
+}
+
+static void test_joined(void) {
+    TEST_ASSERT_MESSAGE(posixTasks.live == 0, "every thread joined");
+    TEST_ASSERT_MESSAGE(posixTasks.created == posixTasks.deleted, "every task deleted");
+}
+
+static void test_cost(void) {
+    measure("from the pool", SMALL_TASK);
+    measure("on the heap", BIG_TASK);
+    printf("%u tasks, %u on the heap\n", posixTasks.created, posixTasks.heap);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lifecycle);
+    RUN_TEST(test_timeout);
+    RUN_TEST(test_pool);
+    RUN_TEST(test_abandon);
+    RUN_TEST(test_destructor);
+    RUN_TEST(test_joined);
+    RUN_TEST(test_cost);
+
+    return UNITY_END();
+}
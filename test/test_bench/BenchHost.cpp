@@ -0,0 +1,184 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Host runner of the hot path benchmarks, see lib/Bench/BenchCases.h.
+//
+//   pio test -e native -f test_bench -v [-a -f -a filter] [-a -t -a tolerance %] [-a -b -a baseline]
+//
+// Compares with bench/baseline.txt by default and fails when a case got
+// slower by more than the tolerance (25 %) or allocates more. -u prints the
+// results as a new baseline instead. Allocations are counted in
+// operator new, as the firmware's own heap users are C++.
+//
+// The esp32_clock_bench firmware runs the same cases and the Arduino ones
+// on the device and prints the results on the serial port. Saved to
+// files, the run of a new firmware is compared with that of the last one
+// with -c:
+//
+//   pio test -e native -f test_bench -v -a -c -a new.txt -a -b -a last.txt
+
+#include <Bench.h>
+#include <BenchCases.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include <new>
+
+void *operator new(size_t size) {
+    Bench::allocated(size);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void output(const char *line) { puts(line); }
+
+// The whole file, NUL terminated, or NULL.
+static char *readFile(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *text = (char *)malloc(size + 1);
+    if (text && fread(text, 1, size, f) == (size_t)size) {
+        text[size] = '\0';
+    } else {
+        free(text);
+        text = NULL;
+    }
+    fclose(f);
+
+    return text;
+}
+
+static const char *baseline = "bench/baseline.txt";  // -b
+static const char *recorded = NULL;                  // -c
+static const char *filter   = NULL;                  // -f
+static int tolerance        = 25;                    // -t
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Runs the cases, or loads those of -c, and the results, which the caller
+// frees, or NULL when none were loaded.
+static char *measure(Bench &bench) {
+    if (recorded) {
+        char *results = readFile(recorded);
+        if (results && bench.load(results) == 0) {
+            free(results);
+            results = NULL;
+        }
+        TEST_ASSERT_MESSAGE(results != NULL, recorded);
+        return results;
+    }
+    addHotPaths(bench);
+    bench.run(filter);
+
+    return NULL;
+}
+
+static void test_update(void) {
+    Bench bench(nanos, output);
+    char *results = measure(bench);
+
+    bench.print();
+    free(results);
+}
+
+static void test_baseline(void) {
+    Bench bench(nanos, output);
+    char *results = measure(bench);
+    char *text    = readFile(baseline);
+
+    if (text == NULL) {
+        free(results);
+        TEST_FAIL_MESSAGE(baseline);
+    }
+    uint8_t regressions = bench.compare(text, tolerance);
+    free(text);
+    free(results);
+
+    char message[40];
+    snprintf(message, sizeof(message), "tolerance %d %%", tolerance);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, regressions, message);
+}
+
+int main(int argc, char **argv) {
+    bool update = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            recorded = argv[++i];
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tolerance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-u") == 0) {
+            update = true;
+        } else {
+            fprintf(stderr, "usage: %s [-f filter] [-t tolerance %%] [-b baseline] [-c results] [-u]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    UNITY_BEGIN();
+    if (update) {
+        RUN_TEST(test_update);
+    } else {
+        RUN_TEST(test_baseline);
+    }
+
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Checks lib/ComfortMetrics against the same formulas in double precision
+// over the BME280 range, and prints the largest error of each metric.
+//
+//   pio test -e native -f test_comfort -v
+//
+// A metric over its bound fails its test. The cost per sample is measured
+// by the comfort_derive bench case, beside comfort_libm, the formulas in
+// float with expf() and logf().
+
+#include <ComfortMetrics.h>
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+// Bounds, well under the sensor's own accuracy
+#define DEW_POINT_BOUND 0.05  // [degC]
+#define ABSOLUTE_BOUND  0.02  // [g/m3]
+#define HEAT_BOUND      0.10  // [degC]
+#define SEA_LEVEL_BOUND 2.0   // [Pa]
+#define HEAT_MAX        80.0  // [degC] the regression runs away in hot and wet air
+#define HEAT_EDGE       0.02  // [degF] around the switch to the regression
+
+static double magnus(double t) { return 611.2 * exp(17.62 * t / (243.12 + t)); }
+
+static double dewPoint(double t, double rh) {
+    double gamma = log(rh / 100.0) + 17.62 * t / (243.12 + t);
+
+    return 243.12 * gamma / (17.62 - gamma);
+}
+
+static double absoluteHumidity(double t, double rh) { return 2.16679 * magnus(t) * rh / 100.0 / (t + 273.15); }
+
+// edge is how far the switch to the regression is [degF]; the result
+// jumps there, and a rounding either side of it takes the other branch.
+static double heatIndex(double t, double rh, double &edge) {
+    double f  = t * 9.0 / 5.0 + 32.0;
+    double hi = 0.5 * (f + 61.0 + (f - 68.0) * 1.2 + rh * 0.094);
+
+    edge = (hi + f) / 2.0 - 80.0;
+    if (edge >= 0) {
+        hi = -42.379 + 2.04901523 * f + 10.14333127 * rh - 0.22475541 * f * rh - 0.00683783 * f * f -
+             0.05481717 * rh * rh + 0.00122874 * f * f * rh + 0.00085282 * f * rh * rh - 0.00000199 * f * f * rh * rh;
+        if (rh < 13.0 && 80.0 <= f && f <= 112.0) {
+            hi -= (13.0 - rh) / 4.0 * sqrt((17.0 - fabs(f - 95.0)) / 17.0);
+        } else if (rh > 85.0 && 80.0 <= f && f <= 87.0) {
+            hi += (rh - 85.0) / 10.0 * (87.0 - f) / 5.0;
+        }
+    }
+
+    return (hi - 32.0) * 5.0 / 9.0;
+}
+
+static double seaLevel(double p, double t, double h) { return p * exp(0.0341632 * h / (t + 273.15 + 0.00325 * h)); }
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    double bound;
+    double error;
+    double at[3];
+} Worst_t;
+
+static void check(Worst_t &worst, double error, double a, double b, double c) {
+    if (fabs(error) > fabs(worst.error)) {
+        worst.error = error;
+        worst.at[0] = a;
+        worst.at[1] = b;
+        worst.at[2] = c;
+    }
+}
+
+static Worst_t worst[] = {
+    {"dew point", "degC", DEW_POINT_BOUND, 0, {0}},
+    {"absolute humidity", "g/m3", ABSOLUTE_BOUND, 0, {0}},
+    {"heat index", "degC", HEAT_BOUND, 0, {0}},
+    {"sea-level pressure", "Pa", SEA_LEVEL_BOUND, 0, {0}},
+};
+
+static void sweep(void) {
+    uint32_t samples = 0;
+
+    for (int32_t t = COMFORT_MIN_TEMPERATURE; t <= COMFORT_MAX_TEMPERATURE; t += 7) {
+        for (uint32_t rh = 50; rh <= 10000; rh += 37) {
+            double dt = t / 100.0, drh = rh / 100.0;
+            double td = dewPoint(dt, drh);
+
+            if (td * 100 >= COMFORT_MIN_TEMPERATURE) {  // drier is the bottom of the range
+                check(worst[0], ComfortMetrics::dewPoint(t, rh) / 100.0 - td, dt, drh, 0);
+            }
+            check(worst[1], ComfortMetrics::absoluteHumidity(t, rh) / 100.0 - absoluteHumidity(dt, drh), dt, drh, 0);
+            double edge;
+            double hi = heatIndex(dt, drh, edge);
+            if (hi <= HEAT_MAX && fabs(edge) > HEAT_EDGE) {
+                check(worst[2], ComfortMetrics::heatIndex(t, rh) / 100.0 - hi, dt, drh, 0);
+            }
+            samples++;
+        }
+        for (int16_t h = COMFORT_MIN_ALTITUDE; h <= COMFORT_MAX_ALTITUDE; h += 50) {
+            for (uint32_t p = 30000; p <= 110000; p += 1000) {
+                check(worst[3], ComfortMetrics::seaLevel(p, t, h) - seaLevel(p, t / 100.0, h), t / 100.0, h, p / 100.0);
+            }
+        }
+    }
+
+    printf("%u samples of the BME280 range\n", samples);
+}
+
+static void bound(const Worst_t &w) {
+    char line[96];
+
+    snprintf(line, sizeof(line), "%s %+.4f %s at %.2f %.2f %.2f, bound %.2f", w.name, w.error, w.unit, w.at[0], w.at[1],
+             w.at[2], w.bound);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_MESSAGE(fabs(w.error) <= w.bound, line);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_dew_point(void) { bound(worst[0]); }
+
+static void test_absolute_humidity(void) { bound(worst[1]); }
+
+static void test_heat_index(void) { bound(worst[2]); }
+
+static void test_sea_level(void) { bound(worst[3]); }
+
+int main(void) {
+    sweep();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_dew_point);
+    RUN_TEST(test_absolute_humidity);
+    RUN_TEST(test_heat_index);
+    RUN_TEST(test_sea_level);
+
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Runs lib/ConfigStore on a file-backed stand-in for NVS and checks that
+// settings persist, that writes are coalesced and that a key is only
+// written when its value differs from the stored one. Prints the cost of
+// reads and writes and the flash writes of a slider drag.
+//
+//   pio test -e native -f test_config -v
+//
+// The stand-in appends one 32-byte entry per write to the file, as NVS
+// does to its pages, and a read scans for the newest entry of the key.
+
+#include <ConfigStore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <map>
+#include <string>
+
+#define NVS_ENTRY 32  // [bytes]
+#define DRAG_SETS 200
+#define DRAG_STEP 50  // [ms] between set() calls of a slider
+#define CALLS     1000000
+
+enum : uint8_t {
+    kTimezone = 0,
+    kUploadPeriod,
+    kTouchPress,
+    kDisplayDay,
+    kAltitude,
+    kKeys,
+};
+
+// A few keys of include/config.h.
+static const ConfigKey_t KEYS[kKeys] = {
+    {"timezone", 9, 0, 27},
+    {"upload", 60, 30, 3600},
+    {"touch_press", 10, 2, 50},
+    {"display_day", 255, 0, 255},
+    {"altitude", 0, -500, 5000},
+};
+
+class FileNvs : public ConfigBackend {
+   public:
+    FileNvs(const char *path) : reads(0), writes(0), failing(false), _path(path) {}
+
+    bool read(const char *name, int32_t &value) {
+        FILE *file = fopen(_path, "r");
+        char key[16];
+        long stored;
+        bool found = false;
+
+        reads++;
+        if (file == NULL) {
+            return false;
+        }
+        while (fscanf(file, "%15s %ld\n", key, &stored) == 2) {
+            if (strcmp(key, name) == 0) {
+                value = stored;
+                found = true;
+            }
+        }
+        fclose(file);
+
+        return found;
+    }
+
+    bool write(const char *name, int32_t value) {
+        if (failing) {
+            return false;
+        }
+
+        FILE *file = fopen(_path, "a");
+        if (file == NULL) {
+            return false;
+        }
+        fprintf(file, "%s %d\n", name, value);
+        fclose(file);
+        writes++;
+        written[name]++;
+
+        return true;
+    }
+
+    uint32_t reads;
+    uint32_t writes;
+    bool failing;
+    std::map<std::string, uint32_t> written;
+
+   private:
+    const char *_path;
+};
+
+static char path[] = "/tmp/configXXXXXX";
+static uint32_t observed[kKeys];
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void count(uint8_t key, int32_t value) { observed[key]++; }
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_persistence(void) {
+    {
+        FileNvs nvs(path);
+        ConfigStore config(KEYS, kKeys);
+
+        config.begin(nvs);
+        TEST_ASSERT_MESSAGE(config.get(kUploadPeriod) == 60 && config.get(kAltitude) == 0, "defaults on an empty NVS");
+        TEST_ASSERT_MESSAGE(nvs.reads == kKeys, "one read per key at begin()");
+
+        TEST_ASSERT_MESSAGE(!config.set(kUploadPeriod, 10, 0), "out of range refused");
+        TEST_ASSERT_MESSAGE(config.set(kUploadPeriod, 300, 0) && config.set(kAltitude, -20, 0), "in range taken");
+        TEST_ASSERT_MESSAGE(config.get(kUploadPeriod) == 300, "read back from the cache");
+        config.poll(0, true);
+        TEST_ASSERT_MESSAGE(nvs.writes == 2, "forced poll writes the changed keys");
+        TEST_ASSERT_MESSAGE(nvs.written.size() == 2, "no other key written");
+    }
+
+    FileNvs nvs(path);
+    ConfigStore config(KEYS, kKeys);
+
+    config.begin(nvs);
+    TEST_ASSERT_MESSAGE(config.get(kUploadPeriod) == 300 && config.get(kAltitude) == -20, "settings persist");
+    TEST_ASSERT_MESSAGE(config.get(kTimezone) == 9, "unset key keeps its default");
+}
+
+static void test_coalescing(void) {
+    FileNvs nvs(path);
+    ConfigStore config(KEYS, kKeys);
+    uint32_t now = 0;
+
+    config.begin(nvs);
+    config.observe(kDisplayDay, count);
+
+    // A slider dragged down and back up, polled as loop() does.
+    for (uint32_t i = 0; i < DRAG_SETS; i++, now += DRAG_STEP) {
+        config.set(kDisplayDay, 255 - (i < DRAG_SETS / 2 ? i : DRAG_SETS - i), now);
+        config.poll(now);
+    }
+    TEST_ASSERT_MESSAGE(nvs.writes == 0, "no write while the slider moves");
+    TEST_ASSERT_MESSAGE(observed[kDisplayDay] == DRAG_SETS - 1, "observer called per change");
+    for (; now < DRAG_SETS * DRAG_STEP + 2 * CONFIG_COALESCE; now += 100) {
+        config.poll(now);
+    }
+    TEST_ASSERT_MESSAGE(nvs.writes == 1 && config.getWrites() == 1, "one write once the slider rests");
+    printf("slider drag: %u set() calls, %u flash write (%u bytes), %u bytes written one by one\n", DRAG_SETS,
+           nvs.writes, nvs.writes * NVS_ENTRY, (DRAG_SETS - 1) * NVS_ENTRY);
+
+    // Changed and changed back before it was written.
+    config.set(kTouchPress, 20, now);
+    config.poll(now);
+    config.set(kTouchPress, 10, now + 1000);
+    for (uint32_t end = now + 2 * CONFIG_COALESCE; now < end; now += 100) {
+        config.poll(now);
+    }
+    TEST_ASSERT_MESSAGE(nvs.written["touch_press"] == 0, "a key changed back is not written");
+
+    // The stored value set again.
+    config.set(kUploadPeriod, 300, now);
+    config.poll(now, true);
+    TEST_ASSERT_MESSAGE(nvs.written["upload"] == 0, "the stored value is not rewritten");
+    TEST_ASSERT_MESSAGE(config.set(kDisplayDay, config.get(kDisplayDay), now), "same value taken");
+    config.poll(now, true);
+    TEST_ASSERT_MESSAGE(nvs.written["display_day"] == 1, "an unchanged key is not rewritten");
+}
+
+static void test_failing(void) {
+    FileNvs nvs(path);
+    ConfigStore config(KEYS, kKeys);
+
+    config.begin(nvs);
+    nvs.failing = true;
+    config.set(kTimezone, 1, 0);
+    config.poll(CONFIG_COALESCE);
+    TEST_ASSERT_MESSAGE(config.getFailures() == 1 && nvs.writes == 0, "failed write counted");
+    nvs.failing = false;
+    config.poll(CONFIG_COALESCE + 100);
+    TEST_ASSERT_MESSAGE(nvs.writes == 0, "retry waits for CONFIG_COALESCE");
+    config.poll(2 * CONFIG_COALESCE);
+    TEST_ASSERT_MESSAGE(nvs.writes == 1 && config.getWrites() == 1, "written on the retry");
+
+    FileNvs broken(path);
+    broken.write("timezone", 99);  // out of range, from an older table
+    ConfigStore reloaded(KEYS, kKeys);
+    reloaded.begin(broken);
+    TEST_ASSERT_MESSAGE(reloaded.get(kTimezone) == 9, "out of range value replaced by the default");
+}
+
+static void test_cost(void) {
+    FileNvs nvs(path);
+    ConfigStore config(KEYS, kKeys);
+    volatile int32_t sink = 0;
+    uint64_t begin;
+    int32_t value;
+
+    begin = nanos();
+    config.begin(nvs);
+    printf("begin() of %u keys %.1f us\n", kKeys, (nanos() - begin) / 1000.0);
+
+    begin = nanos();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        sink = sink + config.get(i % kKeys);
+    }
+    printf("get() %.2f ns\n", (nanos() - begin) / (double)CALLS);
+
+    begin = nanos();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        config.set(kAltitude, i % 5000, i);
+    }
+    printf("set() %.2f ns\n", (nanos() - begin) / (double)CALLS);
+
+    begin = nanos();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        config.poll(0);
+    }
+    printf("poll() with nothing to do %.2f ns\n", (nanos() - begin) / (double)CALLS);
+
+    begin = nanos();
+    for (uint32_t i = 0; i < 1000; i++) {
+        nvs.read("altitude", value);
+    }
+    printf("stand-in read %.1f us\n", (nanos() - begin) / 1000.0 / 1000);
+
+    begin = nanos();
+    for (uint32_t i = 0; i < 1000; i++) {
+        nvs.write("altitude", i);
+    }
+    printf("stand-in write %.1f us\n", (nanos() - begin) / 1000.0 / 1000);
+}
+
+int main(void) {
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_persistence);
+    RUN_TEST(test_coalescing);
+    RUN_TEST(test_failing);
+    RUN_TEST(test_cost);
+    unlink(path);
+
+    return UNITY_END();
+}
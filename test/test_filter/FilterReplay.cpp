@@ -0,0 +1,181 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Replays a noisy day at 1 Hz through lib/SensorFilter with the weather
+// station preset of BME280Class, and measures what it costs.
+//
+//   pio test -e native -f test_filter -v
+//
+// The clean readings drift slowly and step up once, as a heater coming
+// on. Sensor noise is added on top, with single and double spikes and
+// NaN or out of range glitches of the bus. Every glitch must be counted
+// as rejected and no spike may reach the output. The output must follow
+// the step, and must be nearer the clean readings than the raw ones are.
+
+#include <SensorFilter.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+
+#define REPLAY_SAMPLES 86400  // a day at 1 Hz
+#define REPLAY_STEP    40000  // [s] the heater comes on
+#define REPLAY_SETTLE  30     // [s] to follow the step
+#define REPLAY_REPEAT  20
+
+static const FilterPreset_t PRESET[SensorFilter::kChannels] = {
+    {true, -40.0f, 85.0f, true, 0.5f, 0.2f},
+    {true, 0.0f, 100.0f, true, 2.0f, 0.2f},
+    {true, 300.0f, 1100.0f, true, 0.5f, 0.2f},
+};
+
+typedef struct {
+    const char *name;
+    float base;
+    float swing;  // of the daily drift
+    float step;
+    float noise;  // standard deviation
+    float spike;
+    float bound;  // largest error of the output once settled
+} Channel_t;
+
+static const Channel_t CHANNEL[SensorFilter::kChannels] = {
+    {"temperature", 21.0f, 2.0f, 3.0f, 0.05f, 15.0f, 0.3f},
+    {"humidity", 45.0f, 5.0f, -8.0f, 0.5f, 30.0f, 2.0f},
+    {"pressure", 1008.0f, 3.0f, 0.0f, 0.05f, 50.0f, 0.3f},
+};
+
+static float clean[REPLAY_SAMPLES][SensorFilter::kChannels];
+static float raw[REPLAY_SAMPLES][SensorFilter::kChannels];
+static uint32_t glitches[SensorFilter::kChannels];
+
+static void check(bool ok, const char *what, const char *channel) {
+    char message[96];
+
+    snprintf(message, sizeof(message), "%s of %s", what, channel);
+    TEST_ASSERT_MESSAGE(ok, message);
+}
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static float gaussian(void) {
+    float u = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    float v = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+static void generate(void) {
+    srand(1);
+    for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+        for (uint8_t c = 0; c < SensorFilter::kChannels; c++) {
+            const Channel_t &ch = CHANNEL[c];
+            float x = ch.base + ch.swing * sinf(6.2831853f * k / REPLAY_SAMPLES) + (k >= REPLAY_STEP ? ch.step : 0);
+
+            clean[k][c] = x;
+            raw[k][c]   = x + ch.noise * gaussian();
+            if (k % 97 == 13 || k % 211 == 50 || k % 211 == 51) {  // single and double spikes
+                raw[k][c] += (k & 1) ? ch.spike : -ch.spike;
+            } else if (k % 331 == 7) {
+                raw[k][c] = (k & 2) ? NAN : -1000.0f;
+                glitches[c]++;
+            }
+        }
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_replay(void) {
+    SensorFilter filter;
+    double error[SensorFilter::kChannels]     = {0};
+    double noise[SensorFilter::kChannels]     = {0};
+    float worst[SensorFilter::kChannels]      = {0};
+    uint32_t counted[SensorFilter::kChannels] = {0};
+
+    filter.configure(PRESET);
+    for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+        float v[SensorFilter::kChannels] = {raw[k][0], raw[k][1], raw[k][2]};
+        filter.update(v[0], v[1], v[2]);
+        if (k < SENSOR_FILTER_WINDOW || (REPLAY_STEP <= k && k < REPLAY_STEP + REPLAY_SETTLE)) {
+            continue;
+        }
+        for (uint8_t c = 0; c < SensorFilter::kChannels; c++) {
+            float e = fabsf(v[c] - clean[k][c]);
+            worst[c] = e > worst[c] ? e : worst[c];
+            error[c] += e * e;
+            if (raw[k][c] == raw[k][c] && raw[k][c] > -1000.0f && fabsf(raw[k][c] - clean[k][c]) < 5 * CHANNEL[c].noise) {
+                noise[c] += (raw[k][c] - clean[k][c]) * (raw[k][c] - clean[k][c]);
+                counted[c]++;
+            }
+        }
+    }
+
+    for (uint8_t c = 0; c < SensorFilter::kChannels; c++) {
+        const char *name = CHANNEL[c].name;
+        double rms       = sqrt(error[c] / (REPLAY_SAMPLES - SENSOR_FILTER_WINDOW - REPLAY_SETTLE));
+        double rawRms    = sqrt(noise[c] / counted[c]);
+
+        printf("%-11s rejected %4u limited %5u, error rms %.3f max %.3f, raw noise rms %.3f\n", name,
+               filter.channel(c).getRejected(), filter.channel(c).getLimited(), rms, worst[c], rawRms);
+        check(filter.channel(c).getRejected() == glitches[c], "every glitch rejected", name);
+        check(worst[c] < CHANNEL[c].bound, "no spike in the output", name);
+        check(rms < rawRms / 2, "output nearer the clean readings than the raw ones", name);
+    }
+}
+
+static void test_cost(void) {
+    SensorFilter filter;
+    volatile float sink = 0;
+
+    filter.configure(PRESET);
+    uint64_t begin = nanos();
+    for (int r = 0; r < REPLAY_REPEAT; r++) {
+        for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+            float t = raw[k][0], h = raw[k][1], p = raw[k][2];
+            filter.update(t, h, p);
+            sink = sink + t;
+        }
+    }
+    printf("update of the three channels %.1f ns\n", (nanos() - begin) / (double)REPLAY_REPEAT / REPLAY_SAMPLES);
+}
+
+int main(void) {
+    generate();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replay);
+    RUN_TEST(test_cost);
+
+    return UNITY_END();
+}
@@ -0,0 +1,276 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A fleet of clocks on the loopback interface, one process per clock.
+//
+// Every node runs lib/Gossip over POSIX UDP multicast as the clocks do
+// over AsyncUDP, multicasting a made up reading every period. The lowest
+// node id is not a candidate, so the second lowest must be elected. Half
+// way through the parent plays back a frame it recorded and sends a
+// forged one. The fleet runs twice, the second time the parent kills the
+// leader, whose place the next candidate must take within the timeout.
+//
+//   pio test -e native -f test_gossip -v
+//   pio test -e native -f test_gossip -v -a -n -a 8 -a -d -a 8000
+//
+// -n nodes, -p period [ms] and -d duration [ms] change the fleet.
+// At the end every survivor reports its peers and leader. They must agree
+// on the leader, each one must hear all the other survivors, and each one
+// must have dropped the forged and the replayed frame.
+
+#include <Gossip.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <unity.h>
+
+#define FLEET_GROUP "239.255.42.42"
+#define FLEET_PORT  4243  // not the clocks' port, the test may share a LAN with them
+#define FLEET_NODES 16    // at most
+#define FLEET_BASE  0x1000
+#define FLEET_KEY   "0123456789abcdef"
+
+typedef struct {
+    uint32_t node;
+    uint32_t leader;
+    uint32_t peers;
+    uint32_t forged;
+    uint32_t replayed;
+} Report_t;
+
+static uint32_t millis(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// A socket in the group, sending and receiving on 127.0.0.1.
+static int openGroup(void) {
+    int fd             = socket(AF_INET, SOCK_DGRAM, 0);
+    int on             = 1;
+    unsigned char loop = 1;
+    struct sockaddr_in addr;
+    struct ip_mreq mreq;
+    struct in_addr lo;
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family           = AF_INET;
+    addr.sin_port             = htons(FLEET_PORT);
+    addr.sin_addr.s_addr      = htonl(INADDR_ANY);
+    lo.s_addr                 = htonl(INADDR_LOOPBACK);
+    mreq.imr_multiaddr.s_addr = inet_addr(FLEET_GROUP);
+    mreq.imr_interface        = lo;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        perror("multicast on loopback");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void sendGroup(int fd, const uint8_t *frame, size_t length) {
+    struct sockaddr_in to;
+
+    memset(&to, 0, sizeof(to));
+    to.sin_family      = AF_INET;
+    to.sin_port        = htons(FLEET_PORT);
+    to.sin_addr.s_addr = inet_addr(FLEET_GROUP);
+    sendto(fd, frame, length, 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+// One clock, reports to the parent through the pipe.
+static int runNode(uint8_t index, uint32_t period, uint32_t duration, int out) {
+    Gossip gossip;
+    uint32_t node   = FLEET_BASE + index;
+    bool candidate  = index != 0;
+    uint32_t start  = millis();
+    uint32_t sentAt = start - period;
+    uint8_t frame[GOSSIP_FRAME + 1];
+
+    int fd = openGroup();
+    if (fd < 0) {
+        return 1;
+    }
+    gossip.begin((const uint8_t *)FLEET_KEY, node, period * 3);
+
+    while (millis() - start < duration) {
+        uint32_t now = millis();
+
+        if (now - sentAt >= period) {
+            TelemetrySample_t sample = TelemetryCodec::toSample(time(NULL), 20.0f + index, 50.0f, 1013.0f, 0);
+            size_t length            = gossip.announce(sample, (candidate ? kGossipCandidate : 0) | kGossipValid, time(NULL), frame, sizeof(frame));
+            sendGroup(fd, frame, length);
+            sentAt = now;
+        }
+
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 10) > 0) {
+            ssize_t length = recv(fd, frame, sizeof(frame), 0);
+            if (length > 0) {
+                gossip.receive(frame, length, time(NULL), millis());
+            }
+        }
+    }
+
+    gossip.evict(millis());
+    Report_t report = {node, gossip.leader(candidate, millis()), gossip.count(),
+                       gossip.getCount(Gossip::kForged), gossip.getCount(Gossip::kReplayed)};
+    close(fd);
+
+    return write(out, &report, sizeof(report)) == sizeof(report) ? 0 : 1;
+}
+
+// Records a frame of the given node from the group.
+static bool record(int fd, uint32_t node, uint8_t *frame, uint32_t timeout) {
+    uint32_t start = millis();
+    Gossip reader;
+    GossipFrame_t f;
+
+    reader.begin((const uint8_t *)FLEET_KEY, 0, 0);
+    while (millis() - start < timeout) {
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 100) > 0 && recv(fd, frame, GOSSIP_FRAME, 0) == GOSSIP_FRAME &&
+            reader.decode(frame, GOSSIP_FRAME, f) && f.node == node) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint8_t nodes     = 4;
+static uint32_t period   = 200;   // [ms]
+static uint32_t duration = 4000;  // [ms]
+
+static void fleet(bool kill) {
+    pid_t pid[FLEET_NODES];
+    int pipes[2];
+
+    int fd = openGroup();
+    TEST_ASSERT_MESSAGE(fd >= 0 && pipe(pipes) == 0, "multicast group on the loopback interface");
+
+    for (uint8_t i = 0; i < nodes; i++) {
+        pid[i] = fork();
+        if (pid[i] == 0) {
+            close(pipes[0]);
+            _exit(runNode(i, period, duration, pipes[1]));
+        }
+    }
+    close(pipes[1]);
+
+    // Half way: a recorded frame of the first node again, then one with a
+    // reading changed under the old tag. The first node takes the replay
+    // for its own frame.
+    uint32_t start = millis();
+    uint8_t frame[GOSSIP_FRAME];
+    bool recorded = record(fd, FLEET_BASE, frame, duration / 2);
+    while (millis() - start < duration / 2) {
+        usleep(10000);
+    }
+    if (recorded) {
+        sendGroup(fd, frame, sizeof(frame));
+        frame[18] ^= 0x01;  // temperature
+        sendGroup(fd, frame, sizeof(frame));
+    }
+
+    uint32_t expected = FLEET_BASE + 1;
+    if (kill) {
+        ::kill(pid[1], SIGKILL);
+        waitpid(pid[1], NULL, 0);
+        expected = FLEET_BASE + 2;
+        printf("killed %04x\n", FLEET_BASE + 1);
+    }
+
+    uint8_t survivors = kill ? nodes - 1 : nodes;
+    uint8_t passed    = 0;
+    Report_t report;
+    while (read(pipes[0], &report, sizeof(report)) == sizeof(report)) {
+        bool ok = report.leader == expected && report.peers == survivors - 1u && report.forged >= 1 &&
+                  (report.replayed >= 1 || report.node == FLEET_BASE);
+        printf("node %04x: leader %04x, %u peers, %u forged, %u replayed %s\n", report.node, report.leader,
+               report.peers, report.forged, report.replayed, ok ? "ok" : "FAILED");
+        passed += ok;
+    }
+    while (wait(NULL) > 0) {
+    }
+    close(fd);
+
+    printf("%u/%u nodes agree on %04x\n", passed, survivors, expected);
+    TEST_ASSERT_MESSAGE(recorded, "a frame of the first node recorded");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(survivors, passed, "survivors that agree");
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_fleet(void) { fleet(false); }
+
+static void test_failover(void) { fleet(true); }
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            nodes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            period = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-n nodes] [-p period ms] [-d duration ms]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (nodes < 3 || nodes > FLEET_NODES) {
+        fprintf(stderr, "3 to %u nodes\n", FLEET_NODES);
+        return 2;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_fleet);
+    RUN_TEST(test_failover);
+
+    return UNITY_END();
+}
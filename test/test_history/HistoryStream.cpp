@@ -0,0 +1,292 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Streams 24 hours of 1-minute samples out of lib/History the way
+// /history does, one ChunkedWriter buffer at a time, and measures it.
+//
+//   pio test -e native -f test_history -v
+//
+// For every format the whole day and a range inside it are exported and
+// checked record by record: CSV and JSON by their records, binary by
+// decoding the frames. The ring then moves on between batches, as it does
+// while a response is being sent. The throughput of each format and the
+// peak heap while streaming are printed; streaming must not allocate at
+// all.
+
+#include <History.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include <new>
+
+#define STREAM_BUFFER 512  // CHUNKED_WRITER_BUFFER
+#define STREAM_EPOCH  1614801600
+#define STREAM_REPEAT 200
+
+// Heap in use, with the size kept in front of every block.
+static size_t heapUsed = 0;
+static size_t heapPeak = 0;
+
+void *operator new(size_t size) {
+    size_t *p = (size_t *)malloc(sizeof(size_t) + size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    *p = size;
+    heapUsed += size;
+    if (heapPeak < heapUsed) {
+        heapPeak = heapUsed;
+    }
+    return p + 1;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept {
+    if (p) {
+        size_t *block = (size_t *)p - 1;
+        heapUsed -= *block;
+        free(block);
+    }
+}
+
+void operator delete[](void *p) noexcept { operator delete(p); }
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+static const char *FORMAT[] = {"csv", "json", "bin"};
+static History history;  // 23 kB, as on the device
+static uint32_t oldest;
+static uint32_t newest;
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// A day with a slow swing, a few rooms' worth of motion, and a wrapped
+// ring: the first samples have been overwritten.
+static void fill(uint32_t start, uint16_t minutes) {
+    srand(1);
+    for (uint16_t m = 0; m < minutes; m++) {
+        TelemetrySample_t s;
+        s.time        = start + m * 60;
+        s.temperature = (int16_t)(2200 + (m % 720) - 360 - (m % 7 == 0 ? 2500 : 0));  // below zero now and then
+        s.humidity    = (uint16_t)(4000 + (m * 7) % 2000);
+        s.pressure    = (uint32_t)(100000 + (m * 13) % 3000);
+        s.motion      = (uint16_t)(rand() % 4 == 0 ? rand() % 61 : 0);
+        history.append(s);
+    }
+}
+
+static size_t stream(HistoryExport::Format format, uint32_t from, uint32_t to, char *out, size_t size) {
+    HistoryExport exporter(history, format, from, to);
+    uint8_t buffer[STREAM_BUFFER];
+    size_t total = 0;
+    size_t n;
+
+    while ((n = exporter.next(buffer, sizeof(buffer))) > 0) {
+        if (out && total + n <= size) {
+            memcpy(&out[total], buffer, n);
+        }
+        total += n;
+    }
+
+    return total;
+}
+
+// One past the last record at or before time.
+static uint16_t upperBound(uint32_t time) {
+    return time == UINT32_MAX ? history.count() : history.lowerBound(time + 1);
+}
+
+static bool sameRecord(const TelemetrySample_t &a, const TelemetrySample_t &b) {
+    return a.time == b.time && a.temperature == b.temperature && a.humidity == b.humidity &&
+           a.pressure == b.pressure && a.motion == b.motion;
+}
+
+// Parses the text records back and compares them with the ring.
+static void verifyText(HistoryExport::Format format, uint32_t from, uint32_t to, const char *text) {
+    uint16_t i      = history.lowerBound(from);
+    uint16_t end    = upperBound(to);
+    const char *p   = text;
+    uint16_t parsed = 0;
+
+    if (format == HistoryExport::kCsv) {
+        p = strchr(p, '\n') + 1;
+    } else {
+        TEST_ASSERT_MESSAGE(*p++ == '[', "json starts with [");
+    }
+
+    for (; i < end; i++, parsed++) {
+        const TelemetrySample_t &s = history.get(i);
+        unsigned t, h1, h2, p1, p2, occ;
+        int c1, c2, n = 0;
+        char sign[2] = "";
+        if (format == HistoryExport::kCsv) {
+            sscanf(p, "%u,%n", &t, &n);
+            p += n;
+            if (*p == '-') {
+                sign[0] = *p++;
+            }
+            sscanf(p, "%d.%d,%u.%u,%u.%u,%u\n%n", &c1, &c2, &h1, &h2, &p1, &p2, &occ, &n);
+        } else {
+            if (*p == ',') {
+                p++;
+            }
+            sscanf(p, "{\"t\":%u,\"temp\":%n", &t, &n);
+            p += n;
+            if (*p == '-') {
+                sign[0] = *p++;
+            }
+            sscanf(p, "%d.%d,\"humid\":%u.%u,\"press\":%u.%u,\"occ\":%u}%n", &c1, &c2, &h1, &h2, &p1, &p2, &occ, &n);
+        }
+        p += n;
+        int temperature = (c1 * 100 + c2) * (sign[0] ? -1 : 1);
+        TelemetrySample_t r = {t, (int16_t)temperature, (uint16_t)(h1 * 100 + h2), p1 * 100 + p2, (uint16_t)occ};
+        TEST_ASSERT_MESSAGE(sameRecord(r, s), "text record");
+    }
+    TEST_ASSERT_MESSAGE(format == HistoryExport::kCsv ? *p == '\0' : strcmp(p, "]") == 0, "text ends after the range");
+    TEST_ASSERT_MESSAGE(parsed == end - history.lowerBound(from), "text record count");
+}
+
+static void verifyBin(uint32_t from, uint32_t to, const uint8_t *data, size_t length) {
+    uint16_t i   = history.lowerBound(from);
+    uint16_t end = upperBound(to);
+    size_t pos   = 0;
+
+    while (pos < length) {
+        TelemetrySample_t batch[HISTORY_FRAME];
+        uint8_t count;
+        size_t n = TelemetryCodec::decode(&data[pos], length - pos, batch, HISTORY_FRAME, count);
+        TEST_ASSERT_MESSAGE(n != 0, "binary frame decodes");
+        for (uint8_t k = 0; k < count; k++) {
+            TEST_ASSERT_MESSAGE(i < end && sameRecord(batch[k], history.get(i++)), "binary record");
+        }
+        pos += n;
+    }
+    TEST_ASSERT_MESSAGE(i == end, "binary record count");
+}
+
+// The ring moves on between batches: the records must stay in time order,
+// in the range, without repeats.
+static void verifyMoving(uint32_t newest) {
+    HistoryExport exporter(history, HistoryExport::kBin, 0, UINT32_MAX);
+    uint8_t buffer[STREAM_BUFFER];
+    uint32_t last    = 0;
+    uint32_t reached = 0;
+    uint16_t batches = 0;
+    size_t n;
+    bool ordered = true;
+
+    while ((n = exporter.next(buffer, sizeof(buffer))) > 0) {
+        TelemetrySample_t batch[HISTORY_FRAME];
+        uint8_t count;
+        TelemetryCodec::decode(buffer, n, batch, HISTORY_FRAME, count);
+        for (uint8_t k = 0; k < count; k++) {
+            ordered = ordered && batch[k].time > last;
+            last    = batch[k].time;
+        }
+        reached = newest;
+        // A burst first that overwrites records the reader has not got to,
+        // then a few per batch.
+        for (uint8_t k = 0; k < (batches++ == 0 ? 100 : 4); k++) {
+            newest += 60;
+            TelemetrySample_t s = {newest, 2000, 5000, 101300, 0};
+            history.append(s);
+        }
+    }
+    TEST_ASSERT_MESSAGE(ordered, "records in order while the ring moves");
+    TEST_ASSERT_MESSAGE(last == reached, "export reaches the newest record of its last batch");
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_ring(void) {
+    TEST_ASSERT_MESSAGE(history.count() == HISTORY_DEPTH && oldest == STREAM_EPOCH, "ring holds the last 24 hours");
+}
+
+static void test_export(void) {
+    static char text[1 << 18];
+    const uint32_t RANGE[][2] = {
+        {0, UINT32_MAX},                         // everything
+        {oldest + 3600 + 30, oldest + 7200},     // 01:00:30 - 02:00:00, inclusive
+        {newest + 1, UINT32_MAX},                // nothing
+    };
+    for (uint8_t f = HistoryExport::kCsv; f <= HistoryExport::kBin; f++) {
+        for (const uint32_t *r : RANGE) {
+            size_t length = stream((HistoryExport::Format)f, r[0], r[1], text, sizeof(text) - 1);
+            text[length]  = '\0';
+            if (f == HistoryExport::kBin) {
+                verifyBin(r[0], r[1], (const uint8_t *)text, length);
+            } else {
+                verifyText((HistoryExport::Format)f, r[0], r[1], text);
+            }
+        }
+    }
+}
+
+static void test_heap(void) {
+    heapUsed = 0;
+    heapPeak = 0;
+    for (uint8_t f = HistoryExport::kCsv; f <= HistoryExport::kBin; f++) {
+        size_t bytes   = 0;
+        uint64_t begin = nanos();
+        for (int k = 0; k < STREAM_REPEAT; k++) {
+            bytes = stream((HistoryExport::Format)f, 0, UINT32_MAX, nullptr, 0);
+        }
+        double seconds = (nanos() - begin) / 1e9 / STREAM_REPEAT;
+        printf("%-4s %6u records %7zu bytes %8.1f us %7.1f MB/s %6.1f bytes/record\n", FORMAT[f], HISTORY_DEPTH, bytes,
+               seconds * 1e6, bytes / seconds / 1e6, (double)bytes / HISTORY_DEPTH);
+    }
+    printf("peak heap while streaming: %zu bytes, stack buffer %u bytes + %zu bytes of exporter\n", heapPeak,
+           STREAM_BUFFER, sizeof(HistoryExport));
+    TEST_ASSERT_MESSAGE(heapPeak == 0, "streaming does not allocate");
+}
+
+static void test_moving(void) { verifyMoving(newest); }
+
+int main(void) {
+    fill(STREAM_EPOCH - 300 * 60, HISTORY_DEPTH + 300);
+    oldest = history.get(0).time;
+    newest = history.get(history.count() - 1).time;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ring);
+    RUN_TEST(test_export);
+    RUN_TEST(test_heap);
+    RUN_TEST(test_moving);
+
+    return UNITY_END();
+}
@@ -0,0 +1,185 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Feeds 40 days of 1 Hz samples with gaps into lib/Rollup and checks
+// every bucket of every resolution against aggregates computed straight
+// from the samples, and that add() reports every 1-minute bucket it
+// closes. Prints the size of a Rollup and the cost of add().
+//
+//   pio test -e native -f test_rollup -v
+
+#include <Rollup.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#define CASCADE_EPOCH 1614556800  // a day boundary
+#define CASCADE_DAYS  40          // the daily ring wraps
+#define CASCADE_SPAN  (CASCADE_DAYS * 86400)
+
+static Rollup rollup;
+static RollupBucket_t *expected[Rollup::kResolutions];
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void mergeChannel(RollupChannel_t &channel, int32_t value, bool first) {
+    if (first || value < channel.min) {
+        channel.min = value;
+    }
+    if (first || channel.max < value) {
+        channel.max = value;
+    }
+    channel.sum = (first ? 0 : channel.sum) + value;
+}
+
+static void expect(const TelemetrySample_t &s) {
+    for (uint8_t r = 0; r < Rollup::kResolutions; r++) {
+        uint32_t period   = Rollup::period((Rollup::Resolution)r);
+        RollupBucket_t &b = expected[r][(s.time - CASCADE_EPOCH) / period];
+        bool first        = b.count == 0;
+
+        b.start    = s.time - s.time % period;
+        b.occupied = (first ? 0 : b.occupied) + s.motion;
+        b.count++;
+        mergeChannel(b.temperature, s.temperature, first);
+        mergeChannel(b.humidity, s.humidity, first);
+        mergeChannel(b.pressure, s.pressure, first);
+    }
+}
+
+static bool sameChannel(const RollupChannel_t &a, const RollupChannel_t &b) {
+    return a.min == b.min && a.max == b.max && a.sum == b.sum;
+}
+
+static bool sameBucket(const RollupBucket_t &a, const RollupBucket_t &b) {
+    return a.start == b.start && a.count == b.count && a.occupied == b.occupied &&
+           sameChannel(a.temperature, b.temperature) && sameChannel(a.humidity, b.humidity) &&
+           sameChannel(a.pressure, b.pressure);
+}
+
+// A bucket reaches the next resolution when it closes, so the open
+// bucket of a coarser resolution may still be the one before the last
+// sample's, and lacks the samples of the finer open buckets. The rings
+// hold the newest closed buckets that have samples, newest first.
+static void verify(uint32_t last) {
+    for (uint8_t r = 0; r < Rollup::kResolutions; r++) {
+        Rollup::Resolution res = (Rollup::Resolution)r;
+        int32_t newest         = (last - CASCADE_EPOCH) / Rollup::period(res);
+        RollupBucket_t bucket;
+
+        TEST_ASSERT_MESSAGE(rollup.getOpen(res, bucket), "open bucket");
+        int32_t slot = (bucket.start - CASCADE_EPOCH) / Rollup::period(res);
+        TEST_ASSERT_MESSAGE(slot == newest || (r > 0 && slot < newest), "open bucket is the newest one reached");
+        TEST_ASSERT_MESSAGE(r > 0 || sameBucket(bucket, expected[r][slot]), "open 1-minute bucket");
+
+        uint16_t index = 0;
+        for (slot--; slot >= 0 && index < Rollup::depth(res); slot--) {
+            if (expected[r][slot].count == 0) {
+                continue;
+            }
+            if (!rollup.get(res, index++, bucket) || !sameBucket(bucket, expected[r][slot])) {
+                char message[48];
+                snprintf(message, sizeof(message), "resolution %u bucket %u", r, index - 1);
+                TEST_FAIL_MESSAGE(message);
+            }
+        }
+        TEST_ASSERT_MESSAGE(rollup.available(res) == index, "buckets available");
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_cascade(void) {
+    // Slow swings around 22 degC, 45 %RH and 1008 hPa with noise, motion
+    // in bursts, and gaps: a sample lost now and then, a minute or two
+    // lost every few hours, a whole day missing in the second week.
+    srand(1);
+    uint64_t elapsed  = 0;
+    uint32_t added    = 0;
+    uint32_t last     = 0;
+    uint32_t closes   = 0;  // minutes add() reported closed
+    uint32_t reported = 0;  // of them, the minute of the sample before
+    uint32_t wrong    = 0;  // samples add() reported wrongly
+    for (uint32_t k = 0; k < CASCADE_SPAN; k++) {
+        if (rand() % 100 == 0 || (k % 10000) < 90 || (k / 86400) == 9) {
+            continue;
+        }
+        TelemetrySample_t s;
+        s.time        = CASCADE_EPOCH + k;
+        s.temperature = (int16_t)(2200 + (k % 3600) / 10 - 180 + rand() % 11 - 5 - ((k / 86400) % 7 == 3 ? 3000 : 0));
+        s.humidity    = (uint16_t)(4500 + (k % 7200) / 20 + rand() % 21);
+        s.pressure    = (uint32_t)(100800 + (k % 86400) / 100 + rand() % 5);
+        s.motion      = (k % 1800) < 300 ? 1 : 0;
+        expect(s);
+
+        uint64_t begin = nanos();
+        bool closed    = rollup.add(s);
+        elapsed += nanos() - begin;
+
+        // add() reports a minute exactly when the sample starts the next one
+        RollupBucket_t b;
+        bool next = added && s.time / 60 != last / 60;
+        closes += closed;
+        reported += closed && rollup.get(Rollup::k1Min, 0, b) && b.start == last - last % 60;
+        wrong += closed != next;
+        added++;
+        last = s.time;
+
+        if (k % 86400 == 43200 || k == CASCADE_SPAN - 1) {
+            verify(last);
+        }
+    }
+
+    TEST_ASSERT_MESSAGE(wrong == 0 && reported == closes, "add() reports each minute it closes, once");
+    printf("%u samples, add() %.1f ns/sample with the clock read around it\n", added, (double)elapsed / added);
+}
+
+static void test_size(void) {
+    size_t buckets = ROLLUP_DEPTH_1MIN + ROLLUP_DEPTH_15MIN + ROLLUP_DEPTH_1HOUR + ROLLUP_DEPTH_1DAY + Rollup::kResolutions;
+    printf("sizeof(Rollup) %zu bytes, %zu buckets of %zu bytes\n", sizeof(Rollup), buckets, sizeof(RollupBucket_t));
+    TEST_ASSERT_MESSAGE(sizeof(Rollup) < buckets * sizeof(RollupBucket_t) + 64, "Rollup is its buckets");
+}
+
+int main(void) {
+    for (uint8_t r = 0; r < Rollup::kResolutions; r++) {
+        size_t slots = CASCADE_SPAN / Rollup::period((Rollup::Resolution)r);
+        expected[r]  = (RollupBucket_t *)calloc(slots, sizeof(RollupBucket_t));
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_cascade);
+    RUN_TEST(test_size);
+
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Sweeps lib/SegmentFont over the ranges of the environment pages and
+// checks every value against a reference made with text, the way the
+// pages were formatted before. Prints the cost of one format() call.
+//
+//   pio test -e native -f test_segment -v
+//
+// Every centi-unit is rendered, as printEnvLED() passes them: -99.50 to
+// 999.50 degC, 0 to 100 %RH, 300 to 9999 hPa, and a margin beyond each
+// for Hi and Lo. The ends that round to -100 and 1000 show Lo and Hi. The segments are read back into text, one character per
+// digit and '.' for a lit decimal point.
+
+#include <SegmentFont.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include <string>
+
+#define SCALE  2  // printEnvLED() passes hundredths
+#define REPEAT 20
+
+typedef struct {
+    const char *name;
+    const SegmentUnit_t *unit;
+    const char *glyphs;  // the unit read back
+    uint8_t decimals;
+    int32_t lower;  // [1/100]
+    int32_t upper;
+    int32_t margin;  // swept beyond both ends
+} Page_t;
+
+static const Page_t PAGES[] = {
+    {"temperature", &UNIT_CELSIUS, "^C", 1, -9950, 99950, 1000},
+    {"humidity", &UNIT_PERCENT, "^o", 0, 0, 10000, 1000},
+    {"pressure", &UNIT_HECTOPASCAL, "P", 0, 30000, 999900, 10000},
+    {"dew point", &UNIT_DEW_POINT, "^d", 1, -9950, 99950, 1000},
+    {"heat index", &UNIT_HEAT_INDEX, "^H", 1, -9950, 99950, 1000},
+};
+
+static void check(bool ok, const char *what, const char *page) {
+    char message[96];
+
+    snprintf(message, sizeof(message), "%s of %s", what, page);
+    TEST_ASSERT_MESSAGE(ok, message);
+}
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static char glyph(uint8_t segments) {
+    static const struct {
+        uint8_t segments;
+        char c;
+    } GLYPHS[] = {
+        {GLYPH_BLANK, ' '},   {GLYPH_MINUS, '-'},   {GLYPH_DEGREE, '^'},  {GLYPH_UPPER_C, 'C'},
+        {GLYPH_UPPER_H, 'H'}, {GLYPH_UPPER_L, 'L'}, {GLYPH_UPPER_P, 'P'}, {GLYPH_LOWER_D, 'd'},
+        {GLYPH_LOWER_I, 'i'}, {GLYPH_LOWER_O, 'o'},
+    };
+
+    for (uint8_t d = 0; d < 10; d++) {
+        if (GLYPH_DIGIT[d] == segments) {
+            return '0' + d;
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(GLYPHS) / sizeof(GLYPHS[0]); i++) {
+        if (GLYPHS[i].segments == segments) {
+            return GLYPHS[i].c;
+        }
+    }
+
+    return '?';
+}
+
+static std::string readBack(const uint8_t segments[SEGMENT_DIGITS]) {
+    std::string text;
+
+    for (uint8_t i = 0; i < SEGMENT_DIGITS; i++) {
+        text += glyph(segments[i] & ~GLYPH_DOT);
+        if (segments[i] & GLYPH_DOT) {
+            text += '.';
+        }
+    }
+
+    return text;
+}
+
+// The value as text with d decimals, halves away from zero.
+static std::string text(int32_t value, uint8_t d) {
+    long rounded    = lround(value / pow(10, SCALE - d));
+    long magnitude  = labs(rounded);
+    long fraction   = lround(pow(10, d));
+    std::string out = rounded < 0 ? "-" : "";
+    char buffer[24];
+
+    snprintf(buffer, sizeof(buffer), "%ld", magnitude / fraction);
+    out += buffer;
+    if (d != 0) {
+        snprintf(buffer, sizeof(buffer), "%ld", fraction + magnitude % fraction);  // with the leading zeros
+        out += '.';
+        out += buffer + 1;
+    }
+
+    return out;
+}
+
+// Decimals dropped first, then the unit shortened, then Hi or Lo.
+static std::string reference(int32_t value, const Page_t &page) {
+    const SegmentUnit_t &unit = *page.unit;
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        uint8_t length = pass == 0 ? unit.length : unit.shortLength;
+        uint8_t width  = SEGMENT_DIGITS - length;
+
+        for (int8_t d = page.decimals; 0 <= d; d--) {
+            std::string number = text(value, d);
+            size_t digits      = number.size() - (d ? 1 : 0);
+            if (digits <= width) {
+                return std::string(width - digits, ' ') + number + std::string(page.glyphs, length);
+            }
+        }
+    }
+
+    uint8_t width = SEGMENT_DIGITS - unit.shortLength;
+    return std::string(width - 2, ' ') + (value < 0 ? "Lo" : "Hi") + std::string(page.glyphs, unit.shortLength);
+}
+
+static void sweep(const Page_t &page) {
+    uint32_t values = 0, wrong = 0, fitted = 0, overrun = 0, flagged = 0;
+    int32_t shown[2] = {INT32_MAX, INT32_MIN};  // the range shown as a number
+
+    for (int32_t value = page.lower - page.margin; value <= page.upper + page.margin; value++) {
+        uint8_t segments[SEGMENT_DIGITS + 2];
+        memset(segments, 0xA5, sizeof(segments));
+
+        bool fits            = SegmentFont::format(value, SCALE, page.decimals, *page.unit, segments);
+        std::string expected = reference(value, page);
+        std::string actual   = readBack(segments);
+
+        values++;
+        overrun += segments[SEGMENT_DIGITS] != 0xA5 || segments[SEGMENT_DIGITS + 1] != 0xA5;
+        flagged += fits == (expected.find("Hi") != std::string::npos || expected.find("Lo") != std::string::npos);
+        if (actual != expected) {
+            if (wrong++ < 5) {
+                printf("%s %d: \"%s\", expected \"%s\"\n", page.name, value, actual.c_str(), expected.c_str());
+            }
+        }
+        if (fits) {
+            fitted++;
+            shown[0] = value < shown[0] ? value : shown[0];
+            shown[1] = value > shown[1] ? value : shown[1];
+        }
+    }
+
+    printf("%-11s %7u values, %7u shown as numbers from %.2f to %.2f, %u wrong\n", page.name, values, fitted,
+           shown[0] / 100.0, shown[1] / 100.0, wrong);
+    check(wrong == 0, "every value as the text reference", page.name);
+    check(shown[0] < page.lower + 50 && page.upper - 50 < shown[1], "the range shown as numbers", page.name);
+    check(overrun == 0, "nothing written past the display", page.name);
+    check(flagged == 0, "false exactly for Hi and Lo", page.name);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_temperature(void) { sweep(PAGES[0]); }
+
+static void test_humidity(void) { sweep(PAGES[1]); }
+
+static void test_pressure(void) { sweep(PAGES[2]); }
+
+static void test_dew_point(void) { sweep(PAGES[3]); }
+
+static void test_heat_index(void) { sweep(PAGES[4]); }
+
+static void test_cost(void) {
+    volatile uint8_t sink = 0;
+    uint8_t segments[SEGMENT_DIGITS];
+    uint32_t calls = 0;
+    uint64_t begin = nanos();
+
+    for (int r = 0; r < REPEAT; r++) {
+        for (int32_t value = -9950; value <= 99950; value++, calls++) {
+            SegmentFont::format(value, SCALE, 1, UNIT_CELSIUS, segments);
+            sink = sink + segments[0];
+        }
+    }
+    printf("format() %.1f ns per call\n", (nanos() - begin) / (double)calls);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_temperature);
+    RUN_TEST(test_humidity);
+    RUN_TEST(test_pressure);
+    RUN_TEST(test_dew_point);
+    RUN_TEST(test_heat_index);
+    RUN_TEST(test_cost);
+
+    return UNITY_END();
+}
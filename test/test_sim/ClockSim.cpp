@@ -0,0 +1,1228 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Discrete-event simulator of the clock's loop() in virtual time.
+//
+// It runs the decisions of loop() in ClockLoop on the same UploadScheduler,
+// MotionLedger, SensorFilter, TouchClassifier, DisplayIntensity,
+// TimeService, Connectivity and OccupancyModel as src/main.cpp, with the
+// defaults of include/config.h, and models the rest of loop() by its
+// cost in time. The Tickers and touch
+// sampling run beside loop(), as they do on the device. The display
+// current is integrated on the render clock and compared with a fixed
+// full brightness. The trace starts at midnight in Tokyo.
+//
+//   pio test -e native -f test_sim -v
+//   pio test -e native -f test_sim -v -a sim/traces/sample.trace
+//
+// Without arguments every trace in sim/traces is run quietly, one test
+// each. A trace given is logged event by event, unless -q comes first.
+//
+// A week with every other upload failing and a few network outages a day
+// must report no lost motion, and every PIR wake must stay within
+// WAKE_BUDGET while uploads stall loop(); the test of a trace fails when
+// one does not:
+//
+//   python3 sim/gen_trace.py --days 7 --fail 0.5 --outages 3 > /tmp/stress.trace
+//   pio test -e native -f test_sim -v -a -q -a /tmp/stress.trace
+//
+// Upload attempts made while the network is out, the time from its return
+// to the first upload that gets through and the radio charge are compared
+// with the code before Connectivity, which let the driver scan without a
+// pause and tried every upload that was due.
+//
+// The trace is run a second time without the OccupancyModel (prewarm and
+// motion_defer 0: no pre-warm, no held motion reports) to compare the arrivals that found the display
+// dimmed and the writes in busy hours, the hours with BUSY_MINUTES of
+// presence in the trace. The model learns for a week before it predicts:
+//
+//   python3 sim/gen_trace.py --days 14 --fail 0.1 --outages 1 > /tmp/2weeks.trace
+//
+// Trace lines are "<time ms> <event> <args>", '#' starts a comment:
+//   <t> bme   <temperature> <humidity> <pressure>
+//   <t> pir   <0|1>
+//   <t> touch <raw>
+//   <t> http  <code> <latency ms>   applies to the following uploads;
+//                                   -304 is a timeout after ThingSpeak
+//                                   stored the write
+//   <t> ap    <0|1>                 the access point goes and comes back
+//   <t> net   <0|1> [latency ms]    DNS or TLS stop working behind the AP,
+//                                   a connect fails after the latency
+//   <t> load  <requests/s> <ms>     HTTP clients from now on, each request
+//                                   served for ms; 0 stops them
+//   <t> role  <0|1|2>               alone, gossip leader (writes the fleet
+//                                   channel, 202 is a success) or follower
+//                                   (hears the leader, writes no sensor data)
+//   <t> end                         stops the simulation
+//
+// With HTTP load in the trace, it is run a third time with the server
+// polled by loop() as without HTTP_SERVER_TASK: one request per
+// iteration, in line with everything else. The request latency and the
+// loop() latency of the two are compared. The cost of a /metrics scrape
+// on the device is the metrics_page bench case of esp32_clock_bench.
+//
+// The run starts on a new OTA image, judged by OtaProbe as on the device:
+// if it is rolled back, the test fails. The deadline only runs while the
+// clock is online, so an outage after the reboot keeps the image pending,
+// see sim/traces/outage.trace.
+//
+// The probe is compared with counting ThingSpeak writes only, which rolls
+// back a leader and never passes a follower, see sim/traces/follower.trace.
+//
+// The loop() latency is compared with the lines of dlog_x() logged by
+// log_d() instead, which waits for room in the UART FIFO, and with the
+// logging compiled out (CORE_DEBUG_LEVEL=0). A deferred record costs loop()
+// nothing at the resolution of the model, dlog_record in the bench has its
+// cost.
+//
+// With -t the first upload that stalls loop() for STALL_TRACE or longer is
+// written out as Chrome trace JSON, with the spans and wakes recorded
+// before it, as /trace would show it on the device:
+//
+//   pio test -e native -f test_sim -v -a -q -a -t -a stall.json -a /tmp/stress.trace
+
+#include <ClockLoop.h>
+#include <ConfigStore.h>
+#include <Connectivity.h>
+#include <DisplayIntensity.h>
+#include <LatencyHistogram.h>
+#include <MotionLedger.h>
+#include <OccupancyModel.h>
+#include <OtaProbe.h>
+#include <SensorFilter.h>
+#include <TimeService.h>
+#include <TouchClassifier.h>
+#include <Trace.h>
+#include <UploadScheduler.h>
+#include <config.h>
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Mirrors of src/main.cpp, the settings are those of include/config.h
+#define TOUCH_SAMPLE_PERIOD 20
+#define TOUCH_QUEUE_LENGTH  4
+#define DIM_FADE            3000
+#define PAGE_FADE           750
+#define RENDER_PERIOD       20  // runs with the touch sampling
+#define LIT_SEGMENTS        20
+#define LED_BRIGHTNESS      60  // led.setBrightness()
+#define LED_MAX_BRIGHTNESS  40
+#define WAKE_BUDGET         100  // [ms]
+#define CLOCK_PERIOD        500  // [ms] displayClock()
+#define TRACE_EPOCH         1609426800  // 2021-01-01 00:00:00+09:00
+#define JOIN_LATENCY        3000  // [ms] association, WPA2 and DHCP
+#define NET_LATENCY         5000  // [ms] default of a failing connect
+#define LINK_STEP           1000  // [ms] idle step while the link is down
+#define BUSY_MINUTES        6     // of presence in an hour of the trace
+#define STALL_TRACE         3000  // [ms] an upload this long is traced with -t
+#define UART_CHAR           87    // [us] a character at 115200 baud, 8N1
+#define UART_FIFO           128   // [bytes] log_d() waits for room in it
+#define LOG_PREFIX          40    // [bytes] "[D][main.cpp:896] writeThingSpeak(): ", CR LF
+
+// Cost model of loop() [ms]
+#define COST_LOOP   1
+#define COST_SENSOR 10
+#define COST_WAKE   1  // TM1637 brightness command and the WS2812 frame
+
+enum Role : uint8_t {
+    kAlone = 0,
+    kLeader,
+    kFollower,
+};
+
+enum Logging : uint8_t {
+    kLogOff = 0,
+    kLogDeferred,  // dlog_x(), the debug build
+    kLogSerial,    // the same lines with log_d()
+};
+
+typedef struct {
+    uint32_t time;
+    char type[8];
+    float arg[3];
+} TraceEvent_t;
+
+class ClockSim {
+   public:
+    ClockSim(bool verbose, bool learning);
+
+    bool load(const char *path);
+    void run(void);
+    void report(void);
+    void benchmarkTime(void);
+    void reportConnectivity(void);
+    void compare(const ClockSim &base);
+    bool isWithinBudget(void) const;
+    bool isProbed(void) const;
+    void setServerInLoop(bool inLoop) { _serverInLoop = inLoop; }
+    void setLogging(Logging logging) { _logging = logging; }
+    void compareLogging(const ClockSim &off, const ClockSim &serial);
+    bool hasLoad(void) const;
+    void compareServer(const ClockSim &inLoop);
+    void setTrace(Trace *trace, const char *path);
+
+   private:
+    void log(const char *format, ...);
+    void dlog(const char *format, ...);
+    void changed(Connectivity::State previous);
+    void cost(uint32_t ms);
+    bool background(uint32_t limit, bool stopOnWork);
+    bool hasWork(void) const;
+    void loopOnce(void);
+    int upload(const char *what);
+    void connect(void);
+    bool isReachable(void) const { return _apUp && _netUp; }
+    void network(bool ap, bool net);
+    void reached(void);
+    bool isBusy(void) const;
+    void deliver(const MotionReport_t &report);
+    void render(uint32_t now);
+    void motion(void);
+    void request(uint32_t now);
+    void probe(void);
+    void serve(void);
+    void span(const char *name, uint32_t start);
+    void instant(const char *name, uint32_t now);
+    void writeTrace(void);
+
+    bool _verbose;
+    std::vector<TraceEvent_t> _trace;
+    size_t _cursor;
+    uint32_t _now;
+    uint32_t _end;
+
+    UploadScheduler _scheduler;
+    MotionLedger _ledger;
+    SensorFilter _filter;
+    TouchClassifier _touch;
+    DisplayIntensity _intensity;
+    LatencyHistogram _loopLatency;
+    LatencyHistogram _wakeLatency;
+    TimeService _time;
+    Connectivity _link;
+    OccupancyModel _occupancy;
+    ConfigStore _config;
+    ClockLoop _loop;
+    Trace *_tracer;  // loop() on core 1, the Tickers on core 0
+    const char *_tracePath;
+    bool _stalled;
+
+    // inputs
+    float _bme[3];
+    bool _pir;
+    uint32_t _pirSince;
+    uint16_t _touchRaw;
+    int _httpCode;
+    uint32_t _httpLatency;
+    bool _apUp;
+    bool _netUp;
+    uint32_t _netLatency;
+    uint32_t _loadPeriod;  // [ms] between requests, 0 without load
+    uint32_t _loadCost;    // [ms] of one request
+    Role _role;
+
+    // device state
+    uint32_t _nextSample;
+    uint32_t _nextTouch;
+    bool _sampleflag;
+    std::deque<MotionEdge_t> _edges;  // from the PIR interrupt
+    bool _pirRendered;
+    bool _clockDisplaying;
+    std::deque<TouchClassifier::Gesture> _gestures;
+    bool _associated;
+    bool _joining;
+    uint32_t _joinAt;
+    bool _serverInLoop;
+    uint32_t _nextRequest;
+    uint32_t _serverFree;            // the HTTP task is busy until then
+    std::deque<uint32_t> _requests;  // waiting for handleClient() in loop()
+
+    // results
+    uint64_t _motionTrue;
+    std::map<uint32_t, uint64_t> _sink;  // ThingSpeak's view: report seq -> occupied [us]
+    uint32_t _duplicates;
+    uint32_t _uploads[2][2];  // [sensor, motion][ok, failed]
+    uint32_t _gesturesDropped;
+    uint32_t _wakeLate;
+    uint32_t _legacyConversions;  // localtime() calls of the code before TimeService
+    double _charge[2];  // [mAh] auto dimmed, fixed brightness
+    uint32_t _outages;
+    uint32_t _restoredAt;
+    bool _recovering[2];                // [Connectivity, before]
+    std::vector<uint32_t> _recovery[2];  // [ms] network back to an upload through
+    uint32_t _wasted[2];                 // upload attempts while the network was out
+    uint64_t _apDown;                    // [ms]
+    uint32_t _apSince;
+    uint64_t _legacyActive;  // [ms] in upload attempts, before Connectivity
+    std::vector<bool> _busy;  // per hour of the trace
+    uint32_t _arrivals[2];  // [all, to a dimmed display]
+    uint32_t _writes[2];    // in busy hours [sensor, motion]
+    LatencyHistogram _requestLatency;
+    uint32_t _served;
+    uint64_t _loadTime;  // [ms] with clients
+    uint32_t _loadSince;
+    uint32_t _written;       // ThingSpeak writes that got a 200
+    uint32_t _fleetWritten;  // fleet channel writes that got a 200 or 202
+    OtaProbe::Verdict _probe[2];  // [now, ThingSpeak writes only]
+    uint32_t _probedAt[2];        // [ms] of the verdict
+    Logging _logging;
+    uint32_t _logLines;
+    uint64_t _uartIdle;  // [us] the FIFO is empty from then
+    uint32_t _logWait;   // [us] not charged to loop() yet
+    uint64_t _logStall;  // [us] loop() waited for the UART
+    uint32_t _logLongest;
+};
+
+ClockSim::ClockSim(bool verbose, bool learning)
+    : _config(CONFIG_TABLE, kConfigKeys), _loop(_ledger, _scheduler, _link, _intensity, _occupancy, _time) {
+    _verbose   = verbose;
+    _tracer    = NULL;
+    _tracePath = NULL;
+    _stalled   = false;
+    _cursor  = 0;
+    _now     = 0;
+    _end     = 0;
+
+    static const FilterPreset_t presets[SensorFilter::kChannels] = {
+        {true, -40.0f, 85.0f, true, 0.5f, 0.2f},
+        {true, 0.0f, 100.0f, true, 2.0f, 0.2f},
+        {true, 300.0f, 1100.0f, true, 0.5f, 0.2f},
+    };
+    _filter.configure(presets);
+    if (!learning) {
+        _config.set(kPrewarm, 0, 0);
+        _config.set(kMotionDefer, 0, 0);
+    }
+    _scheduler.configure(_config.get(kUploadPeriod) * 1000, _config.get(kBlockOff) * 1000, _config.get(kBlockOn) * 1000);
+    _loop.configure(_config.get(kPirDebounce), _config.get(kPrewarm), _config.get(kMotionDefer));
+
+    _bme[0]      = 25.0f;
+    _bme[1]      = 50.0f;
+    _bme[2]      = 1013.0f;
+    _pir         = false;
+    _pirSince    = 0;
+    _touchRaw    = 100;
+    _httpCode    = 200;
+    _httpLatency = 800;
+    _apUp        = true;
+    _netUp       = true;
+    _netLatency  = NET_LATENCY;
+    _loadPeriod  = 0;
+    _loadCost    = 0;
+    _role        = kAlone;
+
+    _nextSample      = _config.get(kSamplingPeriod) * 1000;
+    _nextTouch       = TOUCH_SAMPLE_PERIOD;
+    _sampleflag      = false;
+    _pirRendered     = false;
+    _clockDisplaying = true;
+    _associated      = true;  // Portal.begin() joined
+    _joining         = false;
+    _joinAt          = 0;
+    _serverInLoop    = false;
+    _nextRequest     = UINT32_MAX;
+    _serverFree      = 0;
+
+    _motionTrue      = 0;
+    _duplicates      = 0;
+    _gesturesDropped = 0;
+    _wakeLate          = 0;
+    _legacyConversions = 0;
+    _charge[0]       = 0;
+    _charge[1]       = 0;
+    memset(_uploads, 0, sizeof(_uploads));
+    _outages       = 0;
+    _restoredAt    = 0;
+    _recovering[0] = false;
+    _recovering[1] = false;
+    _wasted[0]     = 0;
+    _wasted[1]     = 0;
+    _apDown        = 0;
+    _apSince       = 0;
+    _legacyActive  = 0;
+    memset(_arrivals, 0, sizeof(_arrivals));
+    memset(_writes, 0, sizeof(_writes));
+    _served    = 0;
+    _loadTime  = 0;
+    _loadSince = 0;
+    _written      = 0;
+    _fleetWritten = 0;
+    _probe[0]     = OtaProbe::kPending;
+    _probe[1]     = OtaProbe::kPending;
+    _probedAt[0]  = 0;
+    _probedAt[1]  = 0;
+    _logging      = kLogDeferred;
+    _logLines     = 0;
+    _uartIdle     = 0;
+    _logWait      = 0;
+    _logStall     = 0;
+    _logLongest   = 0;
+}
+
+bool ClockSim::load(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    uint32_t number = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        number++;
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        TraceEvent_t event;
+        memset(&event, 0, sizeof(event));
+        int n = sscanf(line, "%u %7s %f %f %f", &event.time, event.type, &event.arg[0], &event.arg[1], &event.arg[2]);
+        if (n <= 0) {
+            continue;
+        }
+        if (n < 2) {
+            fprintf(stderr, "%s:%u: malformed line\n", path, number);
+            fclose(fp);
+            return false;
+        }
+        _trace.push_back(event);
+    }
+    fclose(fp);
+
+    std::stable_sort(_trace.begin(), _trace.end(), [](const TraceEvent_t &a, const TraceEvent_t &b) { return a.time < b.time; });
+    _end = _trace.empty() ? 0 : _trace.back().time;
+
+    // Busy hours of the trace: count the minutes with presence.
+    std::vector<bool> minutes(_end / 60000 + 1, false);
+    uint32_t rise = 0;
+    bool level    = false;
+    for (size_t i = 0; i < _trace.size(); i++) {
+        const TraceEvent_t &e = _trace[i];
+        if (strcmp(e.type, "pir") != 0 || (e.arg[0] != 0) == level) {
+            continue;
+        }
+        level = e.arg[0] != 0;
+        if (level) {
+            rise = e.time;
+        } else {
+            std::fill(minutes.begin() + rise / 60000, minutes.begin() + e.time / 60000 + 1, true);
+        }
+    }
+    _busy.assign(_end / 3600000 + 1, false);
+    for (size_t hour = 0; hour < _busy.size(); hour++) {
+        size_t from = hour * 60, to = std::min(from + 60, minutes.size());
+        _busy[hour] = from < to && BUSY_MINUTES <= std::count(minutes.begin() + from, minutes.begin() + to, true);
+    }
+
+    return true;
+}
+
+void ClockSim::log(const char *format, ...) {
+    if (!_verbose) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    printf("%02u:%02u:%02u.%03u ", _now / 3600000, _now / 60000 % 60, _now / 1000 % 60, _now % 1000);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+// A dlog_x() of src/main.cpp, with the cost to loop() of the build.
+void ClockSim::dlog(const char *format, ...) {
+    if (_logging == kLogOff) {
+        return;
+    }
+    _logLines++;
+    if (_logging == kLogDeferred) {
+        return;
+    }
+
+    char line[160];
+    va_list args;
+    va_start(args, format);
+    uint32_t n = vsnprintf(line, sizeof(line), format, args) + LOG_PREFIX;
+    va_end(args);
+
+    uint64_t now    = (uint64_t)_now * 1000;
+    uint64_t idle   = std::max(_uartIdle, now);
+    uint32_t queued = (idle - now) / UART_CHAR;
+    uint32_t wait   = queued + n > UART_FIFO ? (queued + n - UART_FIFO) * UART_CHAR : 0;
+
+    _uartIdle   = idle + n * UART_CHAR;
+    _logStall  += wait;
+    _logLongest = std::max(_logLongest, wait);
+    _logWait   += wait;
+    cost(_logWait / 1000);
+    _logWait %= 1000;
+}
+
+// connectivityChanged()
+void ClockSim::changed(Connectivity::State previous) {
+    if (_link.getState() != previous) {
+        dlog("connectivity %s -> %s", Connectivity::name(previous), Connectivity::name(_link.getState()));
+    }
+}
+
+void ClockSim::setTrace(Trace *trace, const char *path) {
+    _tracer    = trace;
+    _tracePath = path;
+}
+
+// A span of loop() since start, if TRACE_SCOPE() would record it.
+void ClockSim::span(const char *name, uint32_t start) {
+    if (_tracer && (_now - start) * 1000 >= TRACE_MIN_SPAN) {
+        _tracer->record('X', name, start * 1000, (_now - start) * 1000, 1, "loopTask");
+    }
+}
+
+void ClockSim::instant(const char *name, uint32_t now) {
+    if (_tracer) {
+        _tracer->record('i', name, now * 1000, 0, 0, "esp_timer");
+    }
+}
+
+// Once, the rings as they are after the loop() of the first stalled upload.
+void ClockSim::writeTrace(void) {
+    FILE *fp = fopen(_tracePath, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "cannot open %s\n", _tracePath);
+    } else {
+        TraceExport exporter(*_tracer);
+        char buffer[512];
+        size_t n;
+        while ((n = exporter.next(buffer, sizeof(buffer))) > 0) {
+            fwrite(buffer, 1, n, fp);
+        }
+        fclose(fp);
+        printf("trace of a stalled upload at %02u:%02u:%02u written to %s\n", _now / 3600000, _now / 60000 % 60,
+               _now / 1000 % 60, _tracePath);
+    }
+    _tracer = NULL;
+}
+
+// Runs whatever happens beside loop() up to limit: trace inputs, the
+// sampling Ticker and the touch sampling timer. With stopOnWork it stops
+// at the first event that gives loop() something to do.
+bool ClockSim::background(uint32_t limit, bool stopOnWork) {
+    while (true) {
+        uint32_t next = std::min(std::min(_nextSample, _nextTouch), _nextRequest);
+        if (_cursor < _trace.size()) {
+            next = std::min(next, _trace[_cursor].time);
+        }
+        if (limit < next) {
+            return false;
+        }
+
+        uint32_t saved = _now;
+        _now           = next;
+
+        if (_cursor < _trace.size() && _trace[_cursor].time == next) {
+            const TraceEvent_t &e = _trace[_cursor++];
+            if (strcmp(e.type, "bme") == 0) {
+                memcpy(_bme, e.arg, sizeof(_bme));
+            } else if (strcmp(e.type, "pir") == 0) {
+                bool level = e.arg[0] != 0;
+                if (_pir && !level) {
+                    _motionTrue += next - _pirSince;
+                } else if (!_pir && level) {
+                    _pirSince = next;
+                }
+                if (_pir != level) {
+                    _edges.push_back({(uint64_t)next * 1000, level});
+                }
+                _pir = level;
+            } else if (strcmp(e.type, "touch") == 0) {
+                _touchRaw = (uint16_t)e.arg[0];
+            } else if (strcmp(e.type, "http") == 0) {
+                _httpCode    = (int)e.arg[0];
+                _httpLatency = (uint32_t)e.arg[1];
+            } else if (strcmp(e.type, "ap") == 0) {
+                network(e.arg[0] != 0, _netUp);
+            } else if (strcmp(e.type, "net") == 0) {
+                _netLatency = e.arg[1] > 0 ? (uint32_t)e.arg[1] : NET_LATENCY;
+                network(_apUp, e.arg[0] != 0);
+            } else if (strcmp(e.type, "load") == 0) {
+                if (_loadPeriod) {
+                    _loadTime += next - _loadSince;
+                }
+                _loadPeriod  = e.arg[0] > 0 ? std::max((uint32_t)(1000 / e.arg[0]), (uint32_t)1) : 0;
+                _loadCost    = (uint32_t)e.arg[1];
+                _loadSince   = next;
+                _nextRequest = _loadPeriod ? next : UINT32_MAX;
+            } else if (strcmp(e.type, "role") == 0) {
+                _role = (Role)e.arg[0];
+            }
+        } else if (_nextRequest == next) {
+            request(next);
+            _nextRequest += _loadPeriod;
+        } else if (_nextSample == next) {
+            _sampleflag = true;
+            _nextSample += _config.get(kSamplingPeriod) * 1000;
+        } else {
+            TouchClassifier::Gesture gesture = _touch.update(_touchRaw, next);
+            if (gesture != TouchClassifier::kNone) {
+                if (_gestures.size() < TOUCH_QUEUE_LENGTH) {
+                    _gestures.push_back(gesture);
+                } else {
+                    _gesturesDropped++;
+                }
+            }
+            render(next);
+            _nextTouch += TOUCH_SAMPLE_PERIOD;
+        }
+
+        if (!stopOnWork) {
+            _now = saved;
+        } else if (hasWork()) {
+            return true;
+        }
+    }
+}
+
+bool ClockSim::hasWork(void) const {
+    return _sampleflag || (_serverInLoop && !_requests.empty()) || !_gestures.empty() || !_edges.empty() ||
+           _loop.pollMotion(_now, false);
+}
+
+// loop() is busy for ms, everything beside it keeps running.
+void ClockSim::cost(uint32_t ms) {
+    background(_now + ms, false);
+    _now += ms;
+}
+
+// writeThingSpeak(). Without the network the connect fails with -301,
+// at once without a route, after the latency when DNS or TLS time out.
+int ClockSim::upload(const char *what) {
+    uint32_t start = _now;
+    int code       = _httpCode;
+
+    if (!isReachable()) {
+        _wasted[0]++;
+        cost(_apUp ? _netLatency : COST_LOOP);
+        code = -301;
+    } else {
+        cost(_httpLatency);
+        _legacyActive += _httpLatency;
+        reached();
+    }
+    log("upload %s code=%d latency=%u", what, code, _now - start);
+    span("thingspeak_write", start);
+    _stalled = _stalled || _now - start >= STALL_TRACE;
+
+    Connectivity::Outcome outcome = Connectivity::kRejected;
+    if (code == 200) {
+        outcome = Connectivity::kSucceeded;
+    } else if (code == -301) {
+        outcome = Connectivity::kFailed;
+    }
+    Connectivity::State previous = _link.getState();
+    _link.attempted(outcome, start, _now);
+    changed(previous);
+
+    if (strcmp(what, "fleet") == 0) {
+        (code == 200 || code == 202) ? dlog("Fleet update successful.") : dlog("Problem updating the fleet channel. HTTP error code %d", code);
+    } else {
+        code == 200 ? dlog("Channel update successful.") : dlog("Problem updating channel. HTTP error code %d", code);
+    }
+
+    return code;
+}
+
+// handleConnectivity() and connectivityChanged(). The driver joins
+// JOIN_LATENCY after it is asked, if the AP is there by then.
+void ClockSim::connect(void) {
+    if (_joining && _apUp && (int32_t)(_now - _joinAt) >= 0) {
+        _associated = true;
+        _joining    = false;
+    }
+
+    Connectivity::State previous = _link.getState();
+    _link.link(_associated, _associated, _now);
+    if (_link.getState() == Connectivity::kIp && previous != Connectivity::kIp) {
+        _scheduler.expedite(_now);
+    }
+    Connectivity::Action action = _link.poll(_now);
+    changed(previous);
+    switch (action) {
+        case Connectivity::kAssociate:
+            log("connectivity: join");
+            instant("associating", _now);
+            _joining = true;
+            _joinAt  = _now + JOIN_LATENCY;
+            break;
+        case Connectivity::kAbandon:
+            log("connectivity: join abandoned");
+            _joining = false;
+            break;
+        default:
+            break;
+    }
+}
+
+// Ground truth of the trace. An outage ends when both are back.
+void ClockSim::network(bool ap, bool net) {
+    bool before = isReachable();
+
+    if (_apUp && !ap) {
+        _associated = false;
+        _apSince    = _now;
+    } else if (!_apUp && ap) {
+        _apDown += _now - _apSince;
+    }
+    _apUp  = ap;
+    _netUp = net;
+
+    if (before && !isReachable()) {
+        _outages++;
+        _recovering[0] = false;
+        _recovering[1] = false;
+        log("network out (ap %d, net %d)", ap, net);
+    } else if (!before && isReachable()) {
+        _restoredAt    = _now;
+        _recovering[0] = true;
+        _recovering[1] = true;
+        log("network back");
+    }
+}
+
+// An upload got through to ThingSpeak.
+void ClockSim::reached(void) {
+    if (_recovering[0]) {
+        _recovery[0].push_back(_now - _restoredAt);
+        _recovering[0] = false;
+    }
+}
+
+// A client connects. The HTTP task serves it as soon as it is done with
+// the ones before; without it, the request waits for loop().
+void ClockSim::request(uint32_t now) {
+    if (_serverInLoop) {
+        _requests.push_back(now);
+        return;
+    }
+
+    _serverFree = std::max(now, _serverFree) + _loadCost;
+    _requestLatency.record((_serverFree - now) * 1000);
+    _served++;
+}
+
+// Portal.handleClient(), one client per call.
+void ClockSim::serve(void) {
+    if (!_serverInLoop || _requests.empty()) {
+        return;
+    }
+
+    uint32_t arrived = _requests.front();
+    uint32_t start   = _now;
+    _requests.pop_front();
+    cost(_loadCost);
+    span("portal", start);
+    _requestLatency.record((_now - arrived) * 1000);
+    _served++;
+}
+
+void ClockSim::loopOnce(void) {
+    uint32_t start = _now;
+
+    serve();
+    connect();
+    motion();
+    _loop.occupancy(_now);
+    cost(COST_LOOP);
+
+    // handleTouch()
+    if (!_gestures.empty()) {
+        TouchClassifier::Gesture gesture = _gestures.front();
+        _gestures.pop_front();
+        log("touch gesture %d", gesture);
+
+        // The environment data pages fade on the render clock and cost
+        // loop() nothing, only on and off is modelled.
+        if (gesture == TouchClassifier::kTap) {
+            dlog("Toggling Clock LED");
+            instant("env_data", _now);
+            _clockDisplaying = !_clockDisplaying;
+            _intensity.setScene(_clockDisplaying ? 255 : 0, PAGE_FADE, _now);
+        }
+        _intensity.activity(_now);
+    }
+
+    if (_sampleflag) {
+        float t = _bme[0], h = _bme[1], p = _bme[2];
+        uint32_t sampled = _now;
+        cost(COST_SENSOR);
+        span("sample", sampled);
+        _filter.update(t, h, p);
+        probe();
+        _sampleflag = false;
+    }
+
+    ClockLoop::Upload sensor = _loop.pollSensor(_now, false);
+    if (sensor != ClockLoop::kNotDue) {
+        // Before, this upload was tried whatever the network and the
+        // backoff, and a motion report followed in its window when one was
+        // pending.
+        uint32_t tries = _ledger.hasPending() ? 2 : 1;
+        if (!isReachable()) {
+            _wasted[1] += tries;
+            _legacyActive += _apUp ? tries * _netLatency : 0;
+        } else {
+            if (!_link.canAttempt(_now)) {
+                _legacyActive += tries * _httpLatency;
+            }
+            if (_recovering[1]) {
+                _recovery[1].push_back(_now + _httpLatency - _restoredAt);
+                _recovering[1] = false;
+            }
+        }
+
+        // uploadSensors(): a follower leaves it to the leader.
+        if (sensor == ClockLoop::kSend && _role == kFollower) {
+            dlog("%08x sends the sensor data.", 0x1u);
+            _scheduler.sensorSent(_now);
+        } else if (sensor == ClockLoop::kSend) {
+            _role == kLeader ? dlog("Clock send the fleet data.") : dlog("Clock send BME280 Data.");
+            int code = upload(_role == kLeader ? "fleet" : "sensor");
+            bool ok  = code == 200 || (_role == kLeader && code == 202);
+            _writes[0] += isBusy();
+            _uploads[0][ok ? 0 : 1]++;
+            if (ok) {
+                (_role == kLeader ? _fleetWritten : _written)++;
+            }
+            _scheduler.sensorSent(_now);
+        }
+    }
+
+    if (_loop.pollMotion(_now, false)) {
+        MotionReport_t report;
+        dlog("Clock can send motion data.");
+        if (_ledger.cut((uint64_t)_now * 1000) && _ledger.peek(report)) {
+            _writes[1] += isBusy();
+            int code = upload("motion");
+            if (code == 200 || code == -304) {
+                deliver(report);
+            }
+            _ledger.sent(report.seq, code == 200);
+            dlog("motion report #%u: %llu us, attempt %u, HTTP %d", report.seq, (unsigned long long)report.occupied, report.attempts + 1, code);
+            _uploads[1][code == 200 ? 0 : 1]++;
+            _written += code == 200;
+        }
+        _loop.motionSent(_now);
+    }
+
+    span("loop", start);
+    if (_tracer && _stalled) {
+        writeTrace();
+    }
+    _loopLatency.record((_now - start) * 1000);
+}
+
+// ota.probe() with uploadAcknowledged(). A sample was taken by now, a
+// follower hears the leader once it has an address.
+void ClockSim::probe(void) {
+    bool heard      = _role == kFollower && _link.getState() >= Connectivity::kIp;
+    bool upload[2]  = {_written || _fleetWritten || heard, _written != 0};
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (_probe[i] != OtaProbe::kPending) {
+            continue;
+        }
+        _probe[i]    = _loop.probe(_now, true, upload[i]);
+        _probedAt[i] = _now;
+        if (i == 0 && _probe[i] != OtaProbe::kPending) {
+            log("ota probe %s", _probe[i] == OtaProbe::kPassed ? "passed" : "failed, rolling back");
+        }
+    }
+}
+
+// handleMotion(): the ledger gets the interrupt's edge times.
+void ClockSim::motion(void) {
+    while (!_edges.empty()) {
+        MotionEdge_t edge = _edges.front();
+        _edges.pop_front();
+
+        switch (_loop.edge(edge)) {
+            case ClockLoop::kGlitch:
+                dlog("--- glitch: %u us", (uint32_t)(edge.time - _loop.getRise().time));
+                break;
+            case ClockLoop::kReleased:
+                dlog("--- released.");
+                log("pir released at %u", (uint32_t)(edge.time / 1000));
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (_loop.settle((uint64_t)_now * 1000)) {
+        dlog("--- detected.");
+        log("pir detected at %u", (uint32_t)(_loop.getRise().time / 1000));
+    }
+}
+
+bool ClockSim::isBusy(void) const { return _busy[_now / 3600000]; }
+
+// ThingSpeak keeps one entry per sequence number.
+void ClockSim::deliver(const MotionReport_t &report) {
+    std::map<uint32_t, uint64_t>::iterator it = _sink.find(report.seq);
+
+    if (it == _sink.end()) {
+        _sink[report.seq] = report.occupied;
+    } else {
+        _duplicates++;
+        if (it->second != report.occupied) {
+            log("report #%u changed on retransmission", report.seq);
+        }
+    }
+}
+
+// renderDisplay(). PIR edges are taken on the render clock, beside loop().
+void ClockSim::render(uint32_t now) {
+    if (now % CLOCK_PERIOD == 0) {
+        _legacyConversions++;  // getLEDTime()
+    }
+    if (now % 60000 == 0) {
+        _legacyConversions++;  // the hour of the auto dimming
+    }
+
+    if (_pir != _pirRendered) {
+        _pirRendered = _pir;
+        if (_pir) {
+            _arrivals[0]++;
+            _arrivals[1] += _intensity.isIdle(now);
+        }
+        _intensity.motion(_pir, now);
+        if (_pir) {
+            instant("wake", now);
+            uint32_t latency = now - _pirSince + COST_WAKE;
+            _wakeLatency.record(latency * 1000);
+            if (latency > WAKE_BUDGET) {
+                _wakeLate++;
+            }
+        }
+    }
+
+    uint8_t level = _loop.render(now, TRACE_EPOCH + now / 1000, (int64_t)now * 1000);
+    uint8_t fixed = _clockDisplaying ? 255 : 0;
+
+    uint8_t led  = LED_MAX_BRIGHTNESS * DisplayIntensity::ws2812((uint16_t)(255 * LED_BRIGHTNESS / 100) * level / 255) / 255;
+    float dimmed = DisplayIntensity::tm1637Current(level, LIT_SEGMENTS) + DisplayIntensity::ws2812Current(led, 255, 1);
+    float full   = DisplayIntensity::tm1637Current(fixed, LIT_SEGMENTS) + DisplayIntensity::ws2812Current(12, 255, 1);
+
+    _charge[0] += dimmed * RENDER_PERIOD / 3600000.0;
+    _charge[1] += full * RENDER_PERIOD / 3600000.0;
+}
+
+void ClockSim::run(void) {
+    _link.begin(1, _now);
+    _scheduler.begin(_now);
+    _ledger.begin(0, 0);
+    _intensity.configure(_config.get(kDisplayDay), _config.get(kDisplayNight), _config.get(kDisplayIdle),
+                         _config.get(kNightStart), _config.get(kNightEnd), _config.get(kIdleTimeout) * 60 * 1000,
+                         _config.get(kBlankTimeout) * 60 * 1000, DIM_FADE);
+
+    while (_now < _end) {
+        loopOnce();
+
+        if (hasWork()) {
+            continue;
+        }
+
+        // Nothing to do until the next input, tick or scheduler deadline.
+        // The idle loop() iterations in between cost COST_LOOP each.
+        uint32_t target = std::min(_scheduler.nextDeadline(_now), _end);
+        target          = std::min(target, _now - _now % 60000 + 60000);  // handleOccupancy()
+        if (_link.getState() == Connectivity::kDown || _link.getState() == Connectivity::kAssociating) {
+            target = std::min(target, _now + LINK_STEP);
+        }
+        uint32_t from   = _now;
+        target          = std::max(target, _now + COST_LOOP);
+        if (!background(target, true)) {
+            _now = target;
+        }
+        if (COST_LOOP <= _now - from) {
+            _loopLatency.record(COST_LOOP * 1000, (_now - from) / COST_LOOP);
+        }
+    }
+}
+
+void ClockSim::report(void) {
+    uint64_t observed = _ledger.getTotal((uint64_t)_now * 1000);
+    uint64_t pending  = observed - _ledger.getAcknowledged();
+    uint8_t queued    = _ledger.getDepth();
+
+    // The network comes back: drain what is left as the device eventually would.
+    MotionReport_t last;
+    _ledger.cut((uint64_t)_now * 1000);
+    while (_ledger.peek(last)) {
+        deliver(last);
+        _ledger.sent(last.seq, true);
+    }
+
+    uint64_t stored = 0;
+    for (std::map<uint32_t, uint64_t>::const_iterator it = _sink.begin(); it != _sink.end(); ++it) {
+        stored += it->second;
+    }
+
+    printf("--- summary (%.1f h simulated)\n", _end / 3600000.0);
+    printf("sensor uploads      : %u ok, %u failed\n", _uploads[0][0], _uploads[0][1]);
+    printf("motion uploads      : %u ok, %u failed\n", _uploads[1][0], _uploads[1][1]);
+    printf("motion true         : %.1f s\n", _motionTrue / 1000.0);
+    printf("motion observed     : %.3f s\n", observed / 1000000.0);
+    printf("motion pending      : %.3f s in %u reports at the end\n", pending / 1000000.0, queued);
+    printf("motion stored       : %.3f s in %u reports, %u duplicates ignored\n", stored / 1000000.0, (unsigned)_sink.size(), _duplicates);
+    printf("motion lost         : %.3f s\n", ((int64_t)observed - (int64_t)stored) / 1000000.0);
+    printf("motion retransmits  : %u\n", _ledger.getRetransmissions());
+    printf("touch gestures      : tap %u, double %u, long %u, dropped %u\n",
+           _touch.getCount(TouchClassifier::kTap), _touch.getCount(TouchClassifier::kDoubleTap),
+           _touch.getCount(TouchClassifier::kLongPress), _gesturesDropped);
+    printf("display charge      : %.1f mAh, %.1f mAh at fixed brightness (%.0f %% saved)\n",
+           _charge[0], _charge[1], _charge[1] > 0 ? 100.0 * (1.0 - _charge[0] / _charge[1]) : 0.0);
+    printf("loop latency        : p50 <%u us, p99 <%u us, max %u us, %u iterations\n",
+           _loopLatency.percentile(50), _loopLatency.percentile(99), _loopLatency.getMax(), _loopLatency.getCount());
+    printf("wake latency        : p99 <%u us, max %u us, %u wakes, %u over %u ms\n",
+           _wakeLatency.percentile(99), _wakeLatency.getMax(), _wakeLatency.getCount(), _wakeLate, WAKE_BUDGET);
+
+    double hours = _end / 3600000.0;
+    printf("time conversions    : %.0f localtime per hour, %.0f before TimeService\n",
+           _time.getConversions() / hours, _legacyConversions / hours);
+    reportConnectivity();
+
+    const char *roles[] = {"alone", "leader", "follower"};
+    char probed[2][32];
+    for (uint8_t i = 0; i < 2; i++) {
+        if (_probe[i] == OtaProbe::kPassed) {
+            snprintf(probed[i], sizeof(probed[i]), "passed after %u s", _probedAt[i] / 1000);
+        } else if (_probe[i] == OtaProbe::kFailed) {
+            snprintf(probed[i], sizeof(probed[i]), "rolled back after %u s", _probedAt[i] / 1000);
+        } else {
+            snprintf(probed[i], sizeof(probed[i]), "pending");
+        }
+    }
+    printf("ota probe           : %s %s, %s with ThingSpeak writes only\n", roles[_role], probed[0], probed[1]);
+    benchmarkTime();
+}
+
+void ClockSim::reportConnectivity(void) {
+    uint64_t apDown = _apDown + (_apUp ? 0 : _end - _apSince);
+    double legacy   = ((double)apDown * CONNECTIVITY_SCAN_MA + (double)(_end - apDown) * CONNECTIVITY_LINK_MA +
+                     (double)_legacyActive * (CONNECTIVITY_ACTIVE_MA - CONNECTIVITY_LINK_MA)) / 3600000.0;
+    uint32_t recovery[2][2];  // [Connectivity, before][median, max] [ms]
+
+    for (uint8_t i = 0; i < 2; i++) {
+        std::vector<uint32_t> &samples = _recovery[i];
+        std::sort(samples.begin(), samples.end());
+        recovery[i][0] = samples.empty() ? 0 : samples[samples.size() / 2];
+        recovery[i][1] = samples.empty() ? 0 : samples.back();
+    }
+
+    printf("network outages     : %u, %.1f min without the AP\n", _outages, apDown / 60000.0);
+    printf("wasted attempts     : %u, %u before Connectivity\n", _wasted[0], _wasted[1]);
+    printf("recovery            : median %.1f s, max %.1f s; %.1f s, %.1f s before Connectivity\n",
+           recovery[0][0] / 1000.0, recovery[0][1] / 1000.0, recovery[1][0] / 1000.0, recovery[1][1] / 1000.0);
+    printf("link states         : down %.0f s, associating %.0f s, ip %.0f s, online %.0f s, degraded %.0f s\n",
+           _link.getTime(Connectivity::kDown, _now) / 1000.0, _link.getTime(Connectivity::kAssociating, _now) / 1000.0,
+           _link.getTime(Connectivity::kIp, _now) / 1000.0, _link.getTime(Connectivity::kOnline, _now) / 1000.0,
+           _link.getTime(Connectivity::kDegraded, _now) / 1000.0);
+    printf("radio charge        : %.1f mAh, %.1f mAh before Connectivity; %u joins, %u attempts, %u failed\n",
+           _link.getCharge(_now), legacy, _link.getAssociations(), _link.getAttempts(), _link.getFailed());
+}
+
+void ClockSim::compare(const ClockSim &base) {
+    uint8_t expected = 0, idle = 0;
+    for (uint8_t s = 0; s < OCCUPANCY_SLOTS; s++) {
+        expected += _occupancy.isExpected(s);
+        idle += _occupancy.getWeeks(s) && _occupancy.isIdle(s);
+    }
+
+    printf("occupancy model     : %u hours learned, %u slots expected, %u idle\n", _occupancy.getHours(), expected, idle);
+    printf("arrivals            : %u, %u to a dimmed display, %u without the model\n",
+           _arrivals[0], _arrivals[1], base._arrivals[1]);
+    printf("busy hour writes    : %u sensor, %u motion; %u, %u without the model\n",
+           _writes[0], _writes[1], base._writes[0], base._writes[1]);
+    printf("display charge      : %+.1f mAh for the pre-warm\n", _charge[0] - base._charge[0]);
+}
+
+// Host speed of a reader: a snapshot copy against what getLEDTime() did.
+void ClockSim::benchmarkTime(void) {
+    const uint32_t CALLS = 1000000;
+    TimeSnapshot_t snapshot;
+    volatile uint32_t sink;  // keeps the loops
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        _time.read(snapshot);
+        sink = snapshot.clock;
+    }
+    double service = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        time_t t = TRACE_EPOCH + i;
+        struct tm tm;
+        char buffer[16];
+        localtime_r(&t, &tm);
+        snprintf(buffer, sizeof(buffer), "%02d%02d", tm.tm_hour, tm.tm_min);
+        sink = atoi(buffer);
+    }
+    double legacy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    (void)sink;
+
+    printf("time reads          : %.1f M/s from the snapshot, %.1f M/s with localtime\n",
+           CALLS / service / 1e6, CALLS / legacy / 1e6);
+}
+
+bool ClockSim::isWithinBudget(void) const { return _wakeLate == 0; }
+
+bool ClockSim::isProbed(void) const { return _probe[0] != OtaProbe::kFailed; }
+
+bool ClockSim::hasLoad(void) const {
+    for (size_t i = 0; i < _trace.size(); i++) {
+        if (strcmp(_trace[i].type, "load") == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ClockSim::compareServer(const ClockSim &inLoop) {
+    uint64_t loaded = _loadTime + (_loadPeriod ? _end - _loadSince : 0);
+
+    printf("http requests       : %u served, %.1f/s under load, latency p99 <%u us, max %u us\n", _served,
+           loaded ? _served * 1000.0 / loaded : 0.0, _requestLatency.percentile(99), _requestLatency.getMax());
+    printf("server in loop()    : latency p99 <%u us, max %u us; loop latency p99 <%u us, max %u us\n",
+           inLoop._requestLatency.percentile(99), inLoop._requestLatency.getMax(), inLoop._loopLatency.percentile(99),
+           inLoop._loopLatency.getMax());
+}
+
+void ClockSim::compareLogging(const ClockSim &off, const ClockSim &serial) {
+    double hours = _end / 3600000.0;
+
+    printf("logging             : %.0f lines per hour, log_d() waits %.1f ms per hour for the UART, %u us at most\n",
+           _logLines / hours, serial._logStall / 1000.0 / hours, serial._logLongest);
+    printf("loop latency by log : p99 <%u us, max %u us with dlog, p99 <%u us, max %u us with log_d, "
+           "p99 <%u us, max %u us without\n",
+           _loopLatency.percentile(99), _loopLatency.getMax(), serial._loopLatency.percentile(99),
+           serial._loopLatency.getMax(), off._loopLatency.percentile(99), off._loopLatency.getMax());
+}
+
+static const char *tracePath = NULL;
+static const char *jsonPath  = NULL;  // -t
+static bool verbose          = false;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_trace(void) {
+    ClockSim base(false, false);
+    ClockSim sim(verbose, true);
+    static Trace trace;
+
+    TEST_ASSERT_MESSAGE(base.load(tracePath) && sim.load(tracePath), tracePath);
+    if (jsonPath) {
+        sim.setTrace(&trace, jsonPath);
+    }
+    base.run();
+    sim.run();
+    sim.report();
+    sim.compare(base);
+
+    ClockSim off(false, true), serial(false, true);
+    off.load(tracePath);
+    off.setLogging(kLogOff);
+    off.run();
+    serial.load(tracePath);
+    serial.setLogging(kLogSerial);
+    serial.run();
+    sim.compareLogging(off, serial);
+
+    if (sim.hasLoad()) {
+        ClockSim inLoop(false, true);
+        inLoop.load(tracePath);
+        inLoop.setServerInLoop(true);
+        inLoop.run();
+        sim.compareServer(inLoop);
+    }
+
+    TEST_ASSERT_MESSAGE(sim.isWithinBudget(), "a PIR wake over WAKE_BUDGET");
+    TEST_ASSERT_MESSAGE(sim.isProbed(), "the OTA image rolled back");
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> paths;
+
+    verbose = true;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            verbose = false;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        DIR *dir = opendir("sim/traces");
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            size_t length = strlen(entry->d_name);
+            if (length > 6 && strcmp(entry->d_name + length - 6, ".trace") == 0) {
+                paths.push_back(std::string("sim/traces/") + entry->d_name);
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        std::sort(paths.begin(), paths.end());
+        verbose = false;
+    }
+
+    setenv("TZ", "JST-9", 1);
+    tzset();
+
+    UNITY_BEGIN();
+    for (size_t i = 0; i < paths.size(); i++) {
+        tracePath = paths[i].c_str();
+        UnityDefaultTestRun(test_trace, tracePath, __LINE__);
+    }
+
+    return UNITY_END();
+}
@@ -0,0 +1,202 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Encodes a day of minute samples with lib/TelemetryCodec, decodes it
+// again and compares the size and speed with the text line of each
+// sample, an ISO-8601 time and the %2.1f readings.
+//
+//   pio test -e native -f test_telemetry -v
+//
+// The day and a set of edge values must survive the round trip, and a
+// flipped bit, a truncated frame or a short output buffer must be
+// rejected.
+
+#include <TelemetryCodec.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#define FRAME_RECORDS    16  // HISTORY_FRAME
+#define TELEMETRY_DAY    1440
+#define TELEMETRY_EPOCH  1614801600
+#define TELEMETRY_LINE   64  // [bytes] longest text line
+#define TELEMETRY_REPEAT 200
+
+static TelemetrySample_t day[TELEMETRY_DAY];
+static uint8_t frames[TELEMETRY_DAY / FRAME_RECORDS * (TELEMETRY_HEADER_SIZE + FRAME_RECORDS * TELEMETRY_RECORD_MAX + TELEMETRY_CRC_SIZE)];
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static bool sameRecord(const TelemetrySample_t &a, const TelemetrySample_t &b) {
+    return a.time == b.time && a.temperature == b.temperature && a.humidity == b.humidity &&
+           a.pressure == b.pressure && a.motion == b.motion;
+}
+
+// Typical indoor readings as the filter hands them over: slow drifts with
+// a little noise, and motion in a few minutes of the hour.
+static void fill(void) {
+    srand(1);
+    float t = 22.0f, h = 45.0f, p = 1008.0f;
+    for (uint16_t m = 0; m < TELEMETRY_DAY; m++) {
+        t += (rand() % 21 - 10) / 100.0f;
+        h += (rand() % 21 - 10) / 50.0f;
+        p += (rand() % 21 - 10) / 100.0f;
+        day[m] = TelemetryCodec::toSample(TELEMETRY_EPOCH + m * 60, t, h, p, rand() % 4 == 0 ? rand() % 61 : 0);
+    }
+}
+
+static size_t encodeDay(void) {
+    size_t length = 0;
+
+    for (uint16_t m = 0; m < TELEMETRY_DAY; m += FRAME_RECORDS) {
+        length += TelemetryCodec::encode(&day[m], FRAME_RECORDS, &frames[length], sizeof(frames) - length);
+    }
+
+    return length;
+}
+
+static uint16_t decodeDay(size_t length, TelemetrySample_t *out) {
+    size_t pos     = 0;
+    uint16_t total = 0;
+
+    while (pos < length) {
+        uint8_t count;
+        size_t n = TelemetryCodec::decode(&frames[pos], length - pos, &out[total], FRAME_RECORDS, count);
+        if (n == 0) {
+            break;
+        }
+        pos += n;
+        total += count;
+    }
+
+    return total;
+}
+
+static size_t textLine(const TelemetrySample_t &s, char *line, size_t size) {
+    time_t t = s.time;
+    struct tm utc;
+    char iso[24];
+
+    gmtime_r(&t, &utc);
+    strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    return snprintf(line, size, "%s,%2.1f,%2.1f,%4.1f,%u\n", iso, TelemetryCodec::temperature(s),
+                    TelemetryCodec::humidity(s), TelemetryCodec::pressure(s), s.motion);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_day(void) {
+    static TelemetrySample_t decoded[TELEMETRY_DAY];
+    size_t length = encodeDay();
+
+    TEST_ASSERT_MESSAGE(decodeDay(length, decoded) == TELEMETRY_DAY, "every record of the day decodes");
+    for (uint16_t m = 0; m < TELEMETRY_DAY; m++) {
+        TEST_ASSERT_MESSAGE(sameRecord(day[m], decoded[m]), "day round trip");
+    }
+}
+
+// The ends of every field, and deltas that wrap them.
+static void test_edges(void) {
+    const TelemetrySample_t EDGE[] = {
+        {0, INT16_MIN, 0, 0, 0},
+        {UINT32_MAX, INT16_MAX, 10000, 200000, UINT16_MAX},
+        {0, INT16_MIN, 0, 0, 0},
+        {1, -1, 1, 1, 1},
+    };
+    const uint8_t count = sizeof(EDGE) / sizeof(EDGE[0]);
+    uint8_t buffer[TELEMETRY_HEADER_SIZE + 4 * TELEMETRY_RECORD_MAX + TELEMETRY_CRC_SIZE];
+    TelemetrySample_t out[4];
+    uint8_t decoded;
+
+    TEST_ASSERT_MESSAGE(sizeof(buffer) == TelemetryCodec::maxFrameSize(count), "maxFrameSize");
+    size_t length = TelemetryCodec::encode(EDGE, count, buffer, sizeof(buffer));
+    TEST_ASSERT_MESSAGE(length > 0 && TelemetryCodec::decode(buffer, length, out, count, decoded) == length && decoded == count,
+          "edge values encode and decode");
+    for (uint8_t i = 0; i < decoded; i++) {
+        TEST_ASSERT_MESSAGE(sameRecord(EDGE[i], out[i]), "edge value round trip");
+    }
+
+    TEST_ASSERT_MESSAGE(TelemetryCodec::encode(EDGE, count, buffer, length - 1) == 0, "short buffer is refused");
+    TEST_ASSERT_MESSAGE(TelemetryCodec::decode(buffer, length - 1, out, count, decoded) == 0 && decoded == 0, "truncated frame");
+    TEST_ASSERT_MESSAGE(TelemetryCodec::decode(buffer, length, out, count - 1, decoded) == 0, "frame over the capacity");
+    for (size_t bit = 0; bit < length * 8; bit++) {
+        buffer[bit / 8] ^= 1 << (bit % 8);
+        TEST_ASSERT_MESSAGE(TelemetryCodec::decode(buffer, length, out, count, decoded) == 0, "flipped bit");
+        buffer[bit / 8] ^= 1 << (bit % 8);
+    }
+}
+
+static void test_size(void) {
+    static TelemetrySample_t decoded[TELEMETRY_DAY];
+    char line[TELEMETRY_LINE];
+    size_t binary = 0;
+    size_t text   = 0;
+
+    uint64_t begin = nanos();
+    for (int k = 0; k < TELEMETRY_REPEAT; k++) {
+        binary = encodeDay();
+    }
+    double encode = (nanos() - begin) / (double)TELEMETRY_REPEAT / TELEMETRY_DAY;
+
+    begin = nanos();
+    for (int k = 0; k < TELEMETRY_REPEAT; k++) {
+        decodeDay(binary, decoded);
+    }
+    double decode = (nanos() - begin) / (double)TELEMETRY_REPEAT / TELEMETRY_DAY;
+
+    begin = nanos();
+    for (int k = 0; k < TELEMETRY_REPEAT; k++) {
+        text = 0;
+        for (uint16_t m = 0; m < TELEMETRY_DAY; m++) {
+            text += textLine(day[m], line, sizeof(line));
+        }
+    }
+    double format = (nanos() - begin) / (double)TELEMETRY_REPEAT / TELEMETRY_DAY;
+
+    printf("binary %6zu bytes %5.2f bytes/sample, encode %6.1f ns/sample, decode %6.1f ns/sample\n", binary,
+           (double)binary / TELEMETRY_DAY, encode, decode);
+    printf("text   %6zu bytes %5.2f bytes/sample, format %6.1f ns/sample\n", text, (double)text / TELEMETRY_DAY, format);
+    TEST_ASSERT_MESSAGE(binary * 4 < text, "binary is under a quarter of the text");
+}
+
+int main(void) {
+    fill();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_day);
+    RUN_TEST(test_edges);
+    RUN_TEST(test_size);
+
+    return UNITY_END();
+}
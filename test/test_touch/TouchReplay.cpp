@@ -0,0 +1,292 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2020-2021 riraosan.github.io
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Replays a day of touch pad readings through lib/TouchClassifier at the
+// 20 ms rate of TouchEngine and measures the false trigger rate and how
+// long each gesture takes to be reported.
+//
+//   pio test -e native -f test_touch -v [-a trace]
+//
+// The untouched level drifts with the humidity over the day and drops by
+// 12 % within two minutes for a shower. Noise and single sample dips of
+// interference are added on top. A tap, a double tap or a long press is
+// made every few minutes. Every touch must be reported as its gesture,
+// nothing else may be reported, and the gestures must come within the
+// bounds below. The fixed threshold of 92 used before is run along for
+// comparison.
+//
+// A trace recorded on the clock, one "<ms> <raw>" line per reading, is
+// replayed instead when given. It is only classified, as nobody knows
+// which touches were meant.
+
+#include <TouchClassifier.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+
+#define REPLAY_PERIOD    20        // [ms] TOUCH_SAMPLE_PERIOD
+#define REPLAY_LENGTH    86400000  // [ms] a day
+#define REPLAY_SAMPLES   (REPLAY_LENGTH / REPLAY_PERIOD)
+#define REPLAY_TOUCHES   (REPLAY_LENGTH / 240000)  // one every 4 minutes
+#define REPLAY_SHOWER    30000000  // [ms]
+#define REPLAY_THRESHOLD 92        // the former fixed threshold
+#define REPLAY_REPEAT    5
+
+// Latest report after the touch has ended, for a long press after it began.
+#define BOUND_TAP        (TOUCH_DOUBLE_TAP + 3 * REPLAY_PERIOD)
+#define BOUND_DOUBLE_TAP (3 * REPLAY_PERIOD)
+#define BOUND_LONG_PRESS (TOUCH_LONG_PRESS + 3 * REPLAY_PERIOD)
+
+typedef struct {
+    uint32_t start;  // [ms]
+    uint32_t end;    // [ms] of the last release
+    uint32_t press;  // [ms] a tap, or each press of a double tap
+    uint32_t gap;    // [ms] between the presses of a double tap
+    TouchClassifier::Gesture gesture;
+    TouchClassifier::Gesture reported;
+} Touch_t;
+
+static const char *NAME[] = {"none", "tap", "double tap", "long press"};
+
+static uint16_t raw[REPLAY_SAMPLES];
+static Touch_t touches[REPLAY_TOUCHES];
+static const char *tracePath = NULL;
+
+static uint64_t nanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static float gaussian(void) {
+    float u = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    float v = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+
+    return sqrtf(-2.0f * logf(u)) * cosf(6.2831853f * v);
+}
+
+// Untouched level of the pad at a time of the day.
+static float untouched(uint32_t t) {
+    float level = 100.0f + 6.0f * sinf(6.2831853f * t / REPLAY_LENGTH);
+
+    if (REPLAY_SHOWER <= t && t < REPLAY_SHOWER + 1800000) {
+        float into = (t - REPLAY_SHOWER) / 120000.0f;
+        level -= 12.0f * (into < 1.0f ? into : 1.0f);
+    }
+
+    return level;
+}
+
+// Share of the untouched level a finger takes away, ramping in and out
+// over a reading.
+static float pressed(const Touch_t &touch, uint32_t t) {
+    uint32_t offsets[2] = {0, touch.press + touch.gap};
+    uint32_t lengths[2] = {touch.press, touch.press};
+    uint8_t presses     = touch.gesture == TouchClassifier::kDoubleTap ? 2 : 1;
+    float depth         = 0;
+
+    for (uint8_t p = 0; p < presses; p++) {
+        uint32_t begin = touch.start + offsets[p];
+        uint32_t end   = begin + lengths[p];
+        if (begin <= t && t < end + REPLAY_PERIOD) {
+            float in  = (t - begin) / (float)REPLAY_PERIOD;
+            float out = t < end ? 1.0f : 1.0f - (t - end) / (float)REPLAY_PERIOD;
+            depth     = 0.4f * (in < out ? (in < 1.0f ? in : 1.0f) : out);
+        }
+    }
+
+    return depth;
+}
+
+static void generate(void) {
+    srand(1);
+    for (uint32_t n = 0; n < REPLAY_TOUCHES; n++) {
+        Touch_t &touch = touches[n];
+
+        touch.start    = n * 240000 + 60000 + rand() % 120000;
+        touch.gesture  = (TouchClassifier::Gesture)(1 + n % 3);
+        touch.reported = TouchClassifier::kNone;
+        touch.gap      = 0;
+        switch (touch.gesture) {
+            case TouchClassifier::kTap:
+                touch.press = 80 + rand() % 200;
+                break;
+            case TouchClassifier::kDoubleTap:
+                touch.press = 60 + rand() % 80;
+                touch.gap   = 80 + rand() % 140;
+                break;
+            default:
+                touch.press = 1000 + rand() % 2000;
+                break;
+        }
+        touch.end = touch.start + touch.press + (touch.gap ? touch.gap + touch.press : 0);
+    }
+
+    uint32_t next = 0;
+    for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+        uint32_t t  = k * REPLAY_PERIOD;
+        float level = untouched(t);
+
+        while (next < REPLAY_TOUCHES && touches[next].end + 1000 < t) {
+            next++;
+        }
+        if (next < REPLAY_TOUCHES) {
+            level *= 1.0f - pressed(touches[next], t);
+        }
+        level += 0.8f * gaussian();
+        if (k % 2677 == 11) {  // interference, a single reading
+            level -= 20.0f;
+        }
+        raw[k] = (uint16_t)lroundf(level);
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_replay(void) {
+    TouchClassifier classifier;
+    uint32_t worst[4] = {0};
+    uint32_t wrong    = 0;
+    uint32_t spurious = 0;
+    uint32_t fixed    = 0;
+    bool below        = false;
+    uint32_t next     = 0;
+
+    classifier.configure(raw[0], 10, 5);
+    for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+        uint32_t t                       = k * REPLAY_PERIOD;
+        TouchClassifier::Gesture gesture = classifier.update(raw[k], t);
+
+        while (next < REPLAY_TOUCHES && touches[next].end + 1000 < t) {
+            next++;
+        }
+        bool touching = next < REPLAY_TOUCHES && touches[next].start <= t;
+
+        // The former callback fired on every fall below the threshold.
+        if (raw[k] < REPLAY_THRESHOLD && !below && !touching) {
+            fixed++;
+        }
+        below = raw[k] < REPLAY_THRESHOLD;
+
+        if (gesture == TouchClassifier::kNone) {
+            continue;
+        }
+        if (!touching || touches[next].reported != TouchClassifier::kNone) {
+            spurious++;
+            continue;
+        }
+
+        Touch_t &touch = touches[next];
+        uint32_t since = gesture == TouchClassifier::kLongPress ? t - touch.start : t - touch.end;
+        touch.reported = gesture;
+        if (gesture != touch.gesture) {
+            wrong++;
+        } else if (worst[gesture] < since) {
+            worst[gesture] = since;
+        }
+    }
+
+    uint32_t missed = 0;
+    for (uint32_t n = 0; n < REPLAY_TOUCHES; n++) {
+        missed += touches[n].reported == TouchClassifier::kNone;
+    }
+
+    printf("touches %u, missed %u, wrong gesture %u, false triggers %u (%.2f per hour)\n", REPLAY_TOUCHES, missed,
+           wrong, spurious, spurious / 24.0);
+    printf("fixed threshold of %u: %u false triggers (%.2f per hour)\n", REPLAY_THRESHOLD, fixed, fixed / 24.0);
+    printf("latest report: tap %u ms after the release, double tap %u ms, long press %u ms after the press\n",
+           worst[TouchClassifier::kTap], worst[TouchClassifier::kDoubleTap], worst[TouchClassifier::kLongPress]);
+
+    TEST_ASSERT_MESSAGE(missed == 0, "every touch reported");
+    TEST_ASSERT_MESSAGE(wrong == 0, "every touch reported as its gesture");
+    TEST_ASSERT_MESSAGE(spurious == 0, "no false trigger");
+    TEST_ASSERT_MESSAGE(worst[TouchClassifier::kTap] <= BOUND_TAP, "tap within its bound");
+    TEST_ASSERT_MESSAGE(worst[TouchClassifier::kDoubleTap] <= BOUND_DOUBLE_TAP, "double tap within its bound");
+    TEST_ASSERT_MESSAGE(worst[TouchClassifier::kLongPress] <= BOUND_LONG_PRESS, "long press within its bound");
+}
+
+static void test_cost(void) {
+    TouchClassifier classifier;
+    volatile uint32_t sink = 0;
+
+    classifier.configure(raw[0], 10, 5);
+    uint64_t begin = nanos();
+    for (int r = 0; r < REPLAY_REPEAT; r++) {
+        for (uint32_t k = 0; k < REPLAY_SAMPLES; k++) {
+            sink = sink + classifier.update(raw[k], (r * REPLAY_SAMPLES + k) * REPLAY_PERIOD);
+        }
+    }
+    printf("update %.1f ns\n", (nanos() - begin) / (double)REPLAY_REPEAT / REPLAY_SAMPLES);
+}
+
+static void test_trace(void) {
+    TouchClassifier classifier;
+    FILE *file     = fopen(tracePath, "r");
+    char line[64];
+    uint32_t first = 0, t = 0, readings = 0;
+    unsigned long ms, value;
+
+    TEST_ASSERT_MESSAGE(file != NULL, tracePath);
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%lu %lu", &ms, &value) != 2) {
+            continue;
+        }
+        t = ms;
+        if (readings++ == 0) {
+            first = t;
+            classifier.configure(value, 10, 5);
+        }
+        TouchClassifier::Gesture gesture = classifier.update(value, t);
+        if (gesture != TouchClassifier::kNone) {
+            printf("%10u ms %s\n", t, NAME[gesture]);
+        }
+    }
+    fclose(file);
+
+    double hours = (t - first) / 3600000.0;
+    printf("%u readings over %.2f h: %u taps, %u double taps, %u long presses, baseline %u\n", readings, hours,
+           classifier.getCount(TouchClassifier::kTap), classifier.getCount(TouchClassifier::kDoubleTap),
+           classifier.getCount(TouchClassifier::kLongPress), classifier.getBaseline());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    if (argc > 1) {
+        tracePath = argv[1];
+        RUN_TEST(test_trace);
+    } else {
+        generate();
+        RUN_TEST(test_replay);
+        RUN_TEST(test_cost);
+    }
+
+    return UNITY_END();
+}
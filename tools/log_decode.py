@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Decodes the clock's deferred log (/log?fmt=bin) with the firmware ELF.
+
+    curl -s http://atom_clock.local/log?fmt=bin > /tmp/log.bin
+    python3 tools/log_decode.py .pio/build/esp32_clock_debug/firmware.elf /tmp/log.bin
+
+A record holds the address of its format string and the raw arguments
+(see lib/DeferredLog/DeferredLog.h); the strings are read from the ELF,
+so it must be the image the clock runs.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x474F4C44  # "DLOG"
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z)?([diuxXocfFeEgGsp%])")
+
+
+class Elf:
+    """Reads NUL terminated strings at load addresses of an ELF32 image."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1:
+            raise ValueError("%s is not an ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, kind, _, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            if addr and kind == 1:  # SHT_PROGBITS
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.index(b"\0", start)
+                return self.data[start:end].decode("utf-8", "replace")
+        return "<0x%08x>" % address
+
+
+def format_record(elf, fmt, words):
+    out = []
+    pos = 0
+    word = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        wide = length == "ll" and conv in "diuxXo"
+        need = 2 if wide else 1
+        if word + need > len(words):
+            out.append("?")
+            continue
+        raw = words[word] | (words[word + 1] << 32 if wide else 0)
+        word += need
+        if conv in "di":
+            bits = 64 if wide else 32
+            value = raw - (1 << bits) if raw >> (bits - 1) else raw
+            out.append(("%" + flags + "d") % value)
+        elif conv in "uxXo":
+            out.append(("%" + flags + ("d" if conv == "u" else conv)) % raw)
+        elif conv == "c":
+            out.append(("%" + flags + "c") % chr(raw & 0xFF))
+        elif conv in "fFeEgG":
+            value, = struct.unpack("<f", struct.pack("<I", raw))
+            out.append(("%" + flags + conv) % value)
+        elif conv == "s":
+            out.append(("%" + flags + "s") % elf.string(raw))
+        elif conv == "p":
+            out.append("0x%08x" % raw)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("elf")
+    parser.add_argument("dump")
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    with open(args.dump, "rb") as f:
+        data = f.read()
+
+    magic, words = struct.unpack_from("<II", data, 0)
+    if magic != MAGIC:
+        sys.exit("%s is not a deferred log dump" % args.dump)
+    record = struct.Struct("<IIcBBB%dI" % words)
+
+    for offset in range(8, len(data) - record.size + 1, record.size):
+        fields = record.unpack_from(data, offset)
+        time, fmt, level, core, count = fields[:5]
+        text = format_record(elf, elf.string(fmt), fields[6:6 + count])
+        print("[%5u.%06u][%s][c%u] %s" % (time // 1000000, time % 1000000, level.decode(), core, text))
+
+
+if __name__ == "__main__":
+    main()
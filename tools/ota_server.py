@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Serves a firmware image for the clock's /update route.
+
+    pio run -e esp32_clock_release
+    python3 tools/ota_server.py .pio/build/esp32_clock_release/firmware.bin
+
+It prints the request that starts the update (a POST to /update with the
+image's SHA-256, as the portal user) and the transfer rate of every
+download, to compare with the clock's own figure in /metrics.
+"""
+
+import argparse
+import hashlib
+import http.server
+import os
+import socket
+import time
+
+
+def local_address():
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect(("192.0.2.1", 9))  # no packet is sent
+        return s.getsockname()[0]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("image")
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--host", default="atom_clock.local")
+    parser.add_argument("--user", default="admin")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    digest = hashlib.sha256(image).hexdigest()
+    name = os.path.basename(args.image)
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            if self.path != "/" + name:
+                self.send_error(404)
+                return
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(image)))
+            self.end_headers()
+            start = time.monotonic()
+            self.wfile.write(image)
+            elapsed = time.monotonic() - start
+            print("%s: %d bytes in %.1f s, %.1f kB/s" % (self.client_address[0], len(image), elapsed,
+                                                       len(image) / elapsed / 1000 if elapsed else 0))
+
+    url = "http://%s:%d/%s" % (local_address(), args.port, name)
+    print("image  : %s, %d bytes" % (args.image, len(image)))
+    print("sha256 : %s" % digest)
+    print("start  : curl --digest -u %s -d url=%s -d sha256=%s http://%s/update" % (args.user, url, digest, args.host))
+
+    http.server.HTTPServer(("", args.port), Handler).serve_forever()
+
+
+if __name__ == "__main__":
+    main()